@@ -0,0 +1,401 @@
+#include "AffineMath.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+#define AFFINE_MATH_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AFFINE_MATH_SSE 1
+#endif
+
+#if defined(AFFINE_MATH_SSE) || defined(AFFINE_MATH_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    //Rotation and scale rows of T * Rx * Ry * Rz * S, shared by the scalar and SIMD paths
+    template <typename F>
+    void composeRows(F sx, F cx, F sy, F cy, F sz, F cz, F scaleX, F scaleY, F scaleZ, F px, F py, F pz, F zero, F out[12])
+    {
+        F cxsy = cx * sy;
+        F sxsy = sx * sy;
+
+        out[0] = cy * cz * scaleX;
+        out[1] = (zero - cy * sz) * scaleY;
+        out[2] = sy * scaleZ;
+        out[3] = px;
+
+        out[4] = (cx * sz + sxsy * cz) * scaleX;
+        out[5] = (cx * cz - sxsy * sz) * scaleY;
+        out[6] = (zero - sx * cy) * scaleZ;
+        out[7] = py;
+
+        out[8] = (sx * sz - cxsy * cz) * scaleX;
+        out[9] = (sx * cz + cxsy * sz) * scaleY;
+        out[10] = cx * cy * scaleZ;
+        out[11] = pz;
+    }
+
+    void composeScalar(const TRSArrays& in, size_t i, Affine& out)
+    {
+        float values[12];
+        composeRows(std::sin(in.rx[i]), std::cos(in.rx[i]), std::sin(in.ry[i]), std::cos(in.ry[i]),
+            std::sin(in.rz[i]), std::cos(in.rz[i]), in.sx[i], in.sy[i], in.sz[i],
+            in.px[i], in.py[i], in.pz[i], 0.0f, values);
+        for (int k = 0; k < 12; ++k)
+            out.m[k / 4][k % 4] = values[k];
+    }
+
+#if !defined(AFFINE_MATH_SSE)
+    void multiplyScalar(const Affine& a, const Affine& b, Affine& out)
+    {
+        Affine r;
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int col = 0; col < 4; ++col)
+            {
+                r.m[row][col] = a.m[row][0] * b.m[0][col] + a.m[row][1] * b.m[1][col] + a.m[row][2] * b.m[2][col];
+            }
+            r.m[row][3] += a.m[row][3];
+        }
+        out = r;
+    }
+#endif
+
+    //Cephes single precision sine/cosine constants
+    const float kFourOverPi = 1.27323954473516f;
+    const float kDP1 = -0.78515625f;
+    const float kDP2 = -2.4187564849853515625e-4f;
+    const float kDP3 = -3.77489497744594108e-8f;
+    const float kSinP0 = -1.9515295891e-4f;
+    const float kSinP1 = 8.3321608736e-3f;
+    const float kSinP2 = -1.6666654611e-1f;
+    const float kCosP0 = 2.443315711809948e-5f;
+    const float kCosP1 = -1.388731625493765e-3f;
+    const float kCosP2 = 4.166664568298827e-2f;
+
+#if defined(AFFINE_MATH_SSE)
+    struct Float4
+    {
+        __m128 v;
+
+        static Float4 load(const float* p) { return { _mm_loadu_ps(p) }; }
+        static Float4 set1(float f) { return { _mm_set1_ps(f) }; }
+    };
+
+    inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+    inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+    inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+
+    //Evaluates sine and cosine of four angles with one shared range reduction
+    void sincos(Float4 angle, Float4& s, Float4& c)
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 signSin = _mm_and_ps(angle.v, signMask);
+        __m128 x = _mm_andnot_ps(signMask, angle.v);
+
+        //Octant index rounded up to even
+        __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(kFourOverPi)));
+        j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        __m128 y = _mm_cvtepi32_ps(j);
+
+        __m128 swapSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+        __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+        __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+        signSin = _mm_xor_ps(signSin, swapSin);
+
+        //Extended precision x - y * pi / 4
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP1)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP2)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP3)));
+        __m128 z = _mm_mul_ps(x, x);
+
+        __m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kCosP0), z), _mm_set1_ps(kCosP1));
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(kCosP2));
+        cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+        cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+        __m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kSinP0), z), _mm_set1_ps(kSinP1));
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(kSinP2));
+        sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+        __m128 sinValue = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+        __m128 cosValue = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+        s.v = _mm_xor_ps(sinValue, signSin);
+        c.v = _mm_xor_ps(cosValue, signCos);
+    }
+
+    //Rows are component registers, the transpose turns them into per-object rows
+    void storeTransposed(const Float4 rows[12], Affine* out)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            __m128 a = rows[r * 4 + 0].v;
+            __m128 b = rows[r * 4 + 1].v;
+            __m128 c = rows[r * 4 + 2].v;
+            __m128 d = rows[r * 4 + 3].v;
+            _MM_TRANSPOSE4_PS(a, b, c, d);
+            _mm_storeu_ps(out[0].m[r], a);
+            _mm_storeu_ps(out[1].m[r], b);
+            _mm_storeu_ps(out[2].m[r], c);
+            _mm_storeu_ps(out[3].m[r], d);
+        }
+    }
+
+    void multiplySse(const Affine& a, const Affine& b, Affine& out)
+    {
+        __m128 b0 = _mm_loadu_ps(b.m[0]);
+        __m128 b1 = _mm_loadu_ps(b.m[1]);
+        __m128 b2 = _mm_loadu_ps(b.m[2]);
+        __m128 rows[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            __m128 row = _mm_mul_ps(_mm_set1_ps(a.m[r][0]), b0);
+            row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[r][1]), b1));
+            row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[r][2]), b2));
+            rows[r] = _mm_add_ps(row, _mm_setr_ps(0.0f, 0.0f, 0.0f, a.m[r][3]));
+        }
+        _mm_storeu_ps(out.m[0], rows[0]);
+        _mm_storeu_ps(out.m[1], rows[1]);
+        _mm_storeu_ps(out.m[2], rows[2]);
+    }
+#endif
+
+#if defined(AFFINE_MATH_AVX2)
+    struct Float8
+    {
+        __m256 v;
+
+        static Float8 load(const float* p) { return { _mm256_loadu_ps(p) }; }
+        static Float8 set1(float f) { return { _mm256_set1_ps(f) }; }
+    };
+
+    inline Float8 operator+(Float8 a, Float8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+    inline Float8 operator-(Float8 a, Float8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline Float8 operator*(Float8 a, Float8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+
+    inline __m256 madd(__m256 a, __m256 b, __m256 c)
+    {
+#if defined(__FMA__)
+        return _mm256_fmadd_ps(a, b, c);
+#else
+        return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+    }
+
+    //Eight-wide version of the SSE sincos
+    void sincos(Float8 angle, Float8& s, Float8& c)
+    {
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        __m256 signSin = _mm256_and_ps(angle.v, signMask);
+        __m256 x = _mm256_andnot_ps(signMask, angle.v);
+
+        __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(kFourOverPi)));
+        j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+        __m256 y = _mm256_cvtepi32_ps(j);
+
+        __m256 swapSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29));
+        __m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+        __m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+        signSin = _mm256_xor_ps(signSin, swapSin);
+
+        x = madd(y, _mm256_set1_ps(kDP1), x);
+        x = madd(y, _mm256_set1_ps(kDP2), x);
+        x = madd(y, _mm256_set1_ps(kDP3), x);
+        __m256 z = _mm256_mul_ps(x, x);
+
+        __m256 cosPoly = madd(_mm256_set1_ps(kCosP0), z, _mm256_set1_ps(kCosP1));
+        cosPoly = madd(cosPoly, z, _mm256_set1_ps(kCosP2));
+        cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+        cosPoly = _mm256_add_ps(_mm256_sub_ps(cosPoly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+        __m256 sinPoly = madd(_mm256_set1_ps(kSinP0), z, _mm256_set1_ps(kSinP1));
+        sinPoly = madd(sinPoly, z, _mm256_set1_ps(kSinP2));
+        sinPoly = madd(_mm256_mul_ps(sinPoly, z), x, x);
+
+        s.v = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, polyMask), signSin);
+        c.v = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, polyMask), signCos);
+    }
+
+    //4x4 transposes inside each 128-bit lane, the low lane holds objects 0-3 and the high lane 4-7
+    void storeTransposed(const Float8 rows[12], Affine* out)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            __m256 t0 = _mm256_unpacklo_ps(rows[r * 4 + 0].v, rows[r * 4 + 1].v);
+            __m256 t1 = _mm256_unpackhi_ps(rows[r * 4 + 0].v, rows[r * 4 + 1].v);
+            __m256 t2 = _mm256_unpacklo_ps(rows[r * 4 + 2].v, rows[r * 4 + 3].v);
+            __m256 t3 = _mm256_unpackhi_ps(rows[r * 4 + 2].v, rows[r * 4 + 3].v);
+            __m256 objects[4] = {
+                _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+                _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+                _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+                _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)) };
+            for (int k = 0; k < 4; ++k)
+            {
+                _mm_storeu_ps(out[k].m[r], _mm256_castps256_ps128(objects[k]));
+                _mm_storeu_ps(out[k + 4].m[r], _mm256_extractf128_ps(objects[k], 1));
+            }
+        }
+    }
+#endif
+
+    //Loads one SIMD block of objects starting at i and writes their transforms
+    template <typename F>
+    void composeBlock(const TRSArrays& in, size_t i, Affine* out)
+    {
+        F sx, cx, sy, cy, sz, cz;
+        sincos(F::load(in.rx + i), sx, cx);
+        sincos(F::load(in.ry + i), sy, cy);
+        sincos(F::load(in.rz + i), sz, cz);
+
+        F rows[12];
+        composeRows(sx, cx, sy, cy, sz, cz, F::load(in.sx + i), F::load(in.sy + i), F::load(in.sz + i),
+            F::load(in.px + i), F::load(in.py + i), F::load(in.pz + i), F::set1(0.0f), rows);
+        storeTransposed(rows, out + i);
+    }
+}
+
+Affine affineIdentity()
+{
+    return affineTranslation(glm::vec3(0.0f));
+}
+
+Affine affineTranslation(const glm::vec3& translation)
+{
+    Affine a = { {
+        { 1.0f, 0.0f, 0.0f, translation.x },
+        { 0.0f, 1.0f, 0.0f, translation.y },
+        { 0.0f, 0.0f, 1.0f, translation.z } } };
+    return a;
+}
+
+Affine composeTRS(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    TRSArrays in = { &position.x, &position.y, &position.z, &rotation.x, &rotation.y, &rotation.z, &scale.x, &scale.y, &scale.z };
+    Affine out;
+    composeScalar(in, 0, out);
+    return out;
+}
+
+Affine affineMultiply(const Affine& a, const Affine& b)
+{
+    Affine out;
+#if defined(AFFINE_MATH_SSE)
+    multiplySse(a, b, out);
+#else
+    multiplyScalar(a, b, out);
+#endif
+    return out;
+}
+
+Affine affineInverse(const Affine& a)
+{
+    //Cofactor inverse of the 3x3 part, the translation is then -R^-1 * t
+    const float (*m)[4] = a.m;
+    float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    float invDet = 1.0f / (m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02);
+
+    Affine r;
+    r.m[0][0] = c00 * invDet;
+    r.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+    r.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+    r.m[1][0] = c01 * invDet;
+    r.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+    r.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+    r.m[2][0] = c02 * invDet;
+    r.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+    r.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+    for (int row = 0; row < 3; ++row)
+        r.m[row][3] = -(r.m[row][0] * m[0][3] + r.m[row][1] * m[1][3] + r.m[row][2] * m[2][3]);
+    return r;
+}
+
+glm::mat4 affineToMat4(const Affine& a)
+{
+    //glm is column-major
+    return glm::mat4(
+        a.m[0][0], a.m[1][0], a.m[2][0], 0.0f,
+        a.m[0][1], a.m[1][1], a.m[2][1], 0.0f,
+        a.m[0][2], a.m[1][2], a.m[2][2], 0.0f,
+        a.m[0][3], a.m[1][3], a.m[2][3], 1.0f);
+}
+
+Affine affineFromMat4(const glm::mat4& m)
+{
+    Affine a;
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+            a.m[row][col] = m[col][row];
+    }
+    return a;
+}
+
+void composeTRSBatch(const TRSArrays& in, Affine* out, size_t count)
+{
+    size_t i = 0;
+#if defined(AFFINE_MATH_AVX2)
+    for (; i + 8 <= count; i += 8)
+        composeBlock<Float8>(in, i, out);
+#endif
+#if defined(AFFINE_MATH_SSE)
+    for (; i + 4 <= count; i += 4)
+        composeBlock<Float4>(in, i, out);
+#endif
+    for (; i < count; ++i)
+        composeScalar(in, i, out[i]);
+}
+
+void affineMultiplyBatch(const Affine& parent, const Affine* in, Affine* out, size_t count)
+{
+    size_t i = 0;
+#if defined(AFFINE_MATH_AVX2)
+    //Two objects per iteration, one per 128-bit lane
+    __m256 p[3][3];
+    __m256 translation[3];
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int k = 0; k < 3; ++k)
+            p[r][k] = _mm256_set1_ps(parent.m[r][k]);
+        translation[r] = _mm256_setr_ps(0.0f, 0.0f, 0.0f, parent.m[r][3], 0.0f, 0.0f, 0.0f, parent.m[r][3]);
+    }
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 b0 = _mm256_loadu2_m128(in[i + 1].m[0], in[i].m[0]);
+        __m256 b1 = _mm256_loadu2_m128(in[i + 1].m[1], in[i].m[1]);
+        __m256 b2 = _mm256_loadu2_m128(in[i + 1].m[2], in[i].m[2]);
+        for (int r = 0; r < 3; ++r)
+        {
+            __m256 row = madd(p[r][0], b0, translation[r]);
+            row = madd(p[r][1], b1, row);
+            row = madd(p[r][2], b2, row);
+            _mm256_storeu2_m128(out[i + 1].m[r], out[i].m[r], row);
+        }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+#if defined(AFFINE_MATH_SSE)
+        multiplySse(parent, in[i], out[i]);
+#else
+        multiplyScalar(parent, in[i], out[i]);
+#endif
+    }
+}
+
+const char* affineMathPath()
+{
+#if defined(AFFINE_MATH_AVX2)
+    return "avx2";
+#elif defined(AFFINE_MATH_SSE)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
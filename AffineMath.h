@@ -0,0 +1,61 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+
+/**
+ * Affine transforms stored as the top three rows of a 4x4 matrix.
+ *
+ * The implicit fourth row is (0, 0, 0, 1), so a multiply is 36 mul/adds
+ * instead of the 64 of a full glm::mat4 product. Batched functions use
+ * AVX2 (8 objects per step) or SSE2 (4 per step) when the compiler targets
+ * them and fall back to scalar code otherwise; build with /arch:AVX2 or
+ * -mavx2 -mfma to enable the AVX2 path.
+ *
+ * Rotations follow glm::rotate: positive angles turn counter-clockwise when
+ * looking down the axis towards the origin.
+ */
+struct alignas(16) Affine
+{
+    //Row-major rows, the fourth column holds the translation
+    float m[3][4];
+};
+
+//Structure-of-arrays input of composeTRSBatch, rotations are XYZ Euler angles in radians
+struct TRSArrays
+{
+    const float* px;
+    const float* py;
+    const float* pz;
+    const float* rx;
+    const float* ry;
+    const float* rz;
+    const float* sx;
+    const float* sy;
+    const float* sz;
+};
+
+Affine affineIdentity();
+
+Affine affineTranslation(const glm::vec3& translation);
+
+//Builds T * Rx * Ry * Rz * S with a single sine/cosine evaluation per axis
+Affine composeTRS(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+//Returns a * b
+Affine affineMultiply(const Affine& a, const Affine& b);
+
+//Inverse of a transform with an invertible 3x3 part
+Affine affineInverse(const Affine& a);
+
+glm::mat4 affineToMat4(const Affine& a);
+
+Affine affineFromMat4(const glm::mat4& m);
+
+//composeTRS for count objects, angles beyond +-8192 radians lose precision on the SIMD paths
+void composeTRSBatch(const TRSArrays& in, Affine* out, size_t count);
+
+//out[i] = parent * in[i], in and out may alias
+void affineMultiplyBatch(const Affine& parent, const Affine* in, Affine* out, size_t count);
+
+//Name of the instruction set the batched functions were compiled for
+const char* affineMathPath();
@@ -0,0 +1,154 @@
+#include "BenchmarkCommon.h"
+#include "AffineMath.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+using namespace bench;
+
+namespace
+{
+    //The matrix builders render() used before AffineMath, kept as the reference path
+    glm::mat4 buildRotateX(float rad)
+    {
+        return glm::mat4(1.0, 0.0, 0.0, 0.0,
+            0.0, cos(rad), -sin(rad), 0.0,
+            0.0, sin(rad), cos(rad), 0.0,
+            0.0, 0.0, 0.0, 1.0);
+    }
+
+    glm::mat4 buildRotateY(float rad)
+    {
+        return glm::mat4(cos(rad), 0.0, sin(rad), 0.0,
+            0.0, 1.0, 0.0, 0.0,
+            -sin(rad), 0.0, cos(rad), 0.0,
+            0.0, 0.0, 0.0, 1.0);
+    }
+
+    glm::mat4 buildRotateZ(float rad)
+    {
+        return glm::mat4(cos(rad), -sin(rad), 0.0, 0.0,
+            sin(rad), cos(rad), 0.0, 0.0,
+            0.0, 0.0, 1.0, 0.0,
+            0.0, 0.0, 0.0, 1.0);
+    }
+
+    struct Scene
+    {
+        std::vector<float> values[9];
+
+        TRSArrays arrays() const
+        {
+            return { values[0].data(), values[1].data(), values[2].data(), values[3].data(), values[4].data(),
+                values[5].data(), values[6].data(), values[7].data(), values[8].data() };
+        }
+    };
+
+    Scene makeScene(size_t count)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+        std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+        Scene scene;
+        for (std::vector<float>& v : scene.values)
+            v.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                scene.values[k][i] = position(rng);
+                scene.values[k + 3][i] = angle(rng);
+                scene.values[k + 6][i] = scale(rng);
+            }
+        }
+        return scene;
+    }
+
+    //buildRotate* turn clockwise, so the reference negates the angles to match composeTRS
+    void runGlm(const Scene& scene, const glm::mat4& view, std::vector<glm::mat4>& out)
+    {
+        const std::vector<float>* v = scene.values;
+        for (size_t i = 0; i < out.size(); ++i)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(v[0][i], v[1][i], v[2][i]))
+                * buildRotateX(-v[3][i]) * buildRotateY(-v[4][i]) * buildRotateZ(-v[5][i])
+                * glm::scale(glm::mat4(1.0f), glm::vec3(v[6][i], v[7][i], v[8][i]));
+            out[i] = view * model;
+        }
+    }
+
+    void runAffine(const Scene& scene, const Affine& view, std::vector<Affine>& out)
+    {
+        composeTRSBatch(scene.arrays(), out.data(), out.size());
+        affineMultiplyBatch(view, out.data(), out.data(), out.size());
+    }
+
+    //Best-of-trials nanoseconds per object
+    template <typename Fn>
+    double timeNsPerObject(size_t count, int repetitions, Fn&& fn)
+    {
+        double best = 1e300;
+        for (int trial = 0; trial < 5; ++trial)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int r = 0; r < repetitions; ++r)
+                fn();
+            double ms = elapsedMs(start, SDL_GetPerformanceCounter());
+            best = std::min(best, ms * 1e6 / ((double)count * repetitions));
+        }
+        return best;
+    }
+}
+
+int runAffineMathBenchmark(int argc, char* args[])
+{
+    //Objects processed per trial, small batches are repeated to reach it
+    const double workPerTrial = (double)std::max(1, intArg(argc, args, "--work", 4000000));
+    const char* outPath = findArg(argc, args, "--out");
+    const size_t sizes[] = { 1, 1000, 1000000 };
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        return 1;
+    }
+
+    const glm::vec3 camera(0.0f, 0.0f, 8.0f);
+    const glm::mat4 viewMat = glm::translate(glm::mat4(1.0f), -camera);
+    const Affine view = affineTranslation(-camera);
+
+    fprintf(out, "{\n  \"benchmark\": \"affine_math\",\n  \"path\": \"%s\",\n  \"results\": [\n", affineMathPath());
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        const size_t count = sizes[s];
+        const int repetitions = std::max(1, (int)(workPerTrial / (double)count));
+        Scene scene = makeScene(count);
+        std::vector<glm::mat4> glmOut(count);
+        std::vector<Affine> affineOut(count);
+
+        double glmNs = timeNsPerObject(count, repetitions, [&] { runGlm(scene, viewMat, glmOut); });
+        double affineNs = timeNsPerObject(count, repetitions, [&] { runAffine(scene, view, affineOut); });
+
+        //Both paths must produce the same model-view matrices
+        float maxError = 0.0f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            glm::mat4 converted = affineToMat4(affineOut[i]);
+            for (int c = 0; c < 4; ++c)
+            {
+                for (int r = 0; r < 4; ++r)
+                    maxError = std::max(maxError, std::fabs(converted[c][r] - glmOut[i][c][r]));
+            }
+        }
+
+        fprintf(out, "    {\"objects\": %zu, \"glm_ns_per_object\": %.3f, \"affine_ns_per_object\": %.3f, \"speedup\": %.2f, \"max_abs_error\": %g}%s\n",
+            count, glmNs, affineNs, glmNs / std::max(affineNs, 1e-9), maxError, s + 1 < sizeof(sizes) / sizeof(sizes[0]) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,349 @@
+#include "AssetArchive.h"
+#include "LZCodec.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+AssetArchive gAssets;
+
+namespace
+{
+    const Uint32 kMagic = 0x4B415041; // "APAK"
+    const Uint32 kVersion = 1;
+
+    struct ArchiveHeader
+    {
+        Uint32 magic;
+        Uint32 version;
+        Uint32 entryCount;
+        Uint32 slotCount;
+        Uint64 entriesOffset;
+        Uint64 slotsOffset;
+        Uint64 namesOffset;
+        Uint64 namesSize;
+        Uint64 fileSize;
+    };
+
+    static_assert(sizeof(ArchiveEntry) == 48, "ArchiveEntry is written to disk as is");
+    static_assert(sizeof(ArchiveHeader) == 56, "ArchiveHeader is written to disk as is");
+
+    Uint64 hashName(std::string_view name)
+    {
+        Uint64 hash = 0xCBF29CE484222325ull;
+        for (char c : name)
+        {
+            hash ^= (Uint8)c;
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    Uint32 checksum(const Uint8* data, size_t size)
+    {
+        Uint32 hash = 0x811C9DC5u;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 0x01000193u;
+        }
+        return hash;
+    }
+
+    Uint64 alignUp(Uint64 value, Uint64 alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    std::string archiveName(const std::string& path)
+    {
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    }
+}
+
+bool AssetArchive::open(const char* path)
+{
+    close();
+    MemoryTagScope memoryTag(MemoryTag::Assets);
+    if (!mFile.open(path))
+        return false;
+
+    ArchiveHeader header;
+    bool valid = mFile.size() >= sizeof(header);
+    if (valid)
+    {
+        memcpy(&header, mFile.data(), sizeof(header));
+        Uint64 size = mFile.size();
+        valid = header.magic == kMagic && header.version == kVersion && header.fileSize == size
+            && header.slotCount > 0 && (header.slotCount & (header.slotCount - 1)) == 0 && header.entryCount < header.slotCount
+            && header.entriesOffset % alignof(ArchiveEntry) == 0 && header.slotsOffset % alignof(Uint32) == 0
+            && header.entriesOffset + (Uint64)header.entryCount * sizeof(ArchiveEntry) <= size
+            && header.slotsOffset + (Uint64)header.slotCount * sizeof(Uint32) <= size
+            && header.namesOffset + header.namesSize <= size;
+    }
+    if (!valid)
+    {
+        SDL_Log("%s is not a valid asset archive.\n", path);
+        close();
+        return false;
+    }
+
+    mEntries = (const ArchiveEntry*)(mFile.data() + header.entriesOffset);
+    mSlots = (const Uint32*)(mFile.data() + header.slotsOffset);
+    mNames = (const char*)(mFile.data() + header.namesOffset);
+    mEntryCount = header.entryCount;
+    mSlotCount = header.slotCount;
+    mNamesSize = (size_t)header.namesSize;
+    return true;
+}
+
+void AssetArchive::close()
+{
+    mFile.close();
+    mEntries = nullptr;
+    mSlots = nullptr;
+    mNames = nullptr;
+    mEntryCount = 0;
+    mSlotCount = 0;
+    mNamesSize = 0;
+}
+
+std::string_view AssetArchive::name(const ArchiveEntry& entry) const
+{
+    if ((Uint64)entry.nameOffset + entry.nameLength > mNamesSize)
+        return std::string_view();
+    return std::string_view(mNames + entry.nameOffset, entry.nameLength);
+}
+
+const ArchiveEntry* AssetArchive::find(std::string_view name) const
+{
+    if (!mSlotCount)
+        return nullptr;
+
+    Uint64 hash = hashName(name);
+    size_t mask = mSlotCount - 1;
+    for (size_t slot = (size_t)hash & mask, probes = 0; probes < mSlotCount; slot = (slot + 1) & mask, ++probes)
+    {
+        Uint32 index = mSlots[slot];
+        if (index == 0 || index > mEntryCount)
+            return nullptr;
+
+        const ArchiveEntry& entry = mEntries[index - 1];
+        if (entry.nameHash == hash && this->name(entry) == name)
+            return &entry;
+    }
+    return nullptr;
+}
+
+bool AssetArchive::read(const ArchiveEntry& entry, std::span<const Uint8>& contents, std::vector<Uint8>& scratch) const
+{
+    if (entry.offset + entry.storedSize > mFile.size())
+        return false;
+
+    const Uint8* stored = mFile.data() + entry.offset;
+    if (entry.compression == ArchiveCompression::None)
+    {
+        contents = std::span<const Uint8>(stored, (size_t)entry.storedSize);
+        return entry.storedSize == entry.size;
+    }
+
+    if (entry.compression != ArchiveCompression::LZ)
+        return false;
+
+    PROFILE_ZONE("AssetArchive::decompress");
+    scratch.resize((size_t)entry.size);
+    if (!lzDecompress(stored, (size_t)entry.storedSize, scratch.data(), scratch.size()))
+        return false;
+    contents = std::span<const Uint8>(scratch.data(), scratch.size());
+    return true;
+}
+
+bool AssetArchive::verify(const ArchiveEntry& entry) const
+{
+    if (entry.offset + entry.storedSize > mFile.size())
+        return false;
+    return checksum(mFile.data() + entry.offset, (size_t)entry.storedSize) == entry.checksum;
+}
+
+bool packArchive(const char* outputPath, const std::vector<std::string>& files, bool compress)
+{
+    // Sorted names give a deterministic layout and load order whatever order the files came in
+    std::vector<std::string> names;
+    for (const std::string& file : files)
+        names.push_back(archiveName(file));
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    ArchiveHeader header = {};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.entryCount = (Uint32)names.size();
+    header.slotCount = 16;
+    while (header.slotCount < 2 * header.entryCount)
+        header.slotCount *= 2;
+
+    std::vector<ArchiveEntry> entries(names.size());
+    std::vector<Uint32> slots(header.slotCount, 0);
+    std::string nameBlock;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        ArchiveEntry& entry = entries[i];
+        entry = ArchiveEntry();
+        entry.nameHash = hashName(names[i]);
+        entry.nameOffset = (Uint32)nameBlock.size();
+        entry.nameLength = (Uint32)names[i].size();
+        nameBlock += names[i];
+
+        size_t slot = (size_t)entry.nameHash & (header.slotCount - 1);
+        while (slots[slot])
+            slot = (slot + 1) & (header.slotCount - 1);
+        slots[slot] = (Uint32)(i + 1);
+    }
+
+    header.entriesOffset = sizeof(ArchiveHeader);
+    header.slotsOffset = header.entriesOffset + entries.size() * sizeof(ArchiveEntry);
+    header.namesOffset = header.slotsOffset + slots.size() * sizeof(Uint32);
+    header.namesSize = nameBlock.size();
+
+    // Blobs are compressed and laid out first, the table of contents is written once their offsets are known
+    std::vector<std::vector<Uint8>> blobs(names.size());
+    Uint64 offset = alignUp(header.namesOffset + header.namesSize, kArchiveBlobAlignment);
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        MappedFile file;
+        if (!file.open(names[i].c_str()))
+        {
+            SDL_Log("Unable to read %s\n", names[i].c_str());
+            return false;
+        }
+
+        ArchiveEntry& entry = entries[i];
+        entry.size = file.size();
+        entry.compression = ArchiveCompression::None;
+        if (compress && file.size() > 0)
+        {
+            lzCompress(file.data(), file.size(), blobs[i]);
+            if (blobs[i].size() <= file.size() - file.size() / 8)
+                entry.compression = ArchiveCompression::LZ;
+        }
+        if (entry.compression == ArchiveCompression::None)
+            blobs[i].assign(file.data(), file.data() + file.size());
+
+        entry.offset = offset;
+        entry.storedSize = blobs[i].size();
+        entry.checksum = checksum(blobs[i].data(), blobs[i].size());
+        offset = alignUp(offset + entry.storedSize, kArchiveBlobAlignment);
+    }
+    header.fileSize = entries.empty() ? header.namesOffset + header.namesSize : entries.back().offset + entries.back().storedSize;
+
+    // Written under a temporary name so a running app never maps a half-written archive
+    std::string tempPath = std::string(outputPath) + ".tmp";
+    FILE* out = fopen(tempPath.c_str(), "wb");
+    if (!out)
+    {
+        SDL_Log("Unable to open archive output %s\n", tempPath.c_str());
+        return false;
+    }
+
+    static const Uint8 padding[kArchiveBlobAlignment] = {};
+    Uint64 position = 0;
+    auto write = [&](const void* data, size_t size)
+    {
+        position += size;
+        return size == 0 || fwrite(data, 1, size, out) == size;
+    };
+    bool ok = write(&header, sizeof(header))
+        && write(entries.data(), entries.size() * sizeof(ArchiveEntry))
+        && write(slots.data(), slots.size() * sizeof(Uint32))
+        && write(nameBlock.data(), nameBlock.size());
+    for (size_t i = 0; i < blobs.size() && ok; ++i)
+    {
+        ok = write(padding, (size_t)(entries[i].offset - position)) && write(blobs[i].data(), blobs[i].size());
+    }
+    ok = fclose(out) == 0 && ok;
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(tempPath, outputPath, error);
+    if (!ok || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        SDL_Log("Unable to write archive %s\n", outputPath);
+        return false;
+    }
+    return true;
+}
+
+bool runPackerFromArgs(int argc, char* args[], int& exitCode)
+{
+    int packIndex = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(args[i], "--pack") == 0)
+            packIndex = i;
+    }
+    if (!packIndex)
+        return false;
+
+    exitCode = 1;
+    if (packIndex + 1 >= argc)
+    {
+        SDL_Log("--pack needs an output file\n");
+        return true;
+    }
+    const char* outputPath = args[packIndex + 1];
+
+    bool compress = true;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i == packIndex || i == packIndex + 1)
+            continue;
+        if (strcmp(args[i], "--no-compress") == 0)
+            compress = false;
+        else if (args[i][0] != '-')
+            files.push_back(args[i]);
+    }
+
+    if (files.empty())
+    {
+        std::error_code error;
+        for (const auto& item : std::filesystem::directory_iterator(".", error))
+        {
+            std::string extension = item.path().extension().string();
+            if (item.is_regular_file() && (extension == ".glsl" || extension == ".bmp" || extension == ".png" || extension == ".btex"))
+                files.push_back(item.path().filename().string());
+        }
+    }
+
+    if (!packArchive(outputPath, files, compress))
+        return true;
+
+    // Read the result back so a broken archive never ships
+    AssetArchive archive;
+    if (!archive.open(outputPath))
+        return true;
+
+    Uint64 totalSize = 0, storedSize = 0;
+    std::vector<Uint8> scratch;
+    for (size_t i = 0; i < archive.count(); ++i)
+    {
+        const ArchiveEntry& entry = archive.entry(i);
+        std::span<const Uint8> contents;
+        if (!archive.verify(entry) || !archive.read(entry, contents, scratch) || archive.find(archive.name(entry)) != &entry)
+        {
+            SDL_Log("Archive entry %.*s failed verification\n", (int)archive.name(entry).size(), archive.name(entry).data());
+            return true;
+        }
+        printf("%-32.*s %10llu -> %10llu%s\n", (int)archive.name(entry).size(), archive.name(entry).data(),
+            (unsigned long long)entry.size, (unsigned long long)entry.storedSize, entry.compression == ArchiveCompression::LZ ? " lz" : "");
+        totalSize += entry.size;
+        storedSize += entry.storedSize;
+    }
+    printf("%zu files, %llu -> %llu bytes in %s\n", archive.count(), (unsigned long long)totalSize, (unsigned long long)storedSize, outputPath);
+
+    exitCode = 0;
+    return true;
+}
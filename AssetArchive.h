@@ -0,0 +1,90 @@
+#pragma once
+#include "MappedFile.h"
+#include <SDL3/SDL.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ArchiveCompression : Uint32
+{
+    None,
+    LZ
+};
+
+//One file in the table of contents, entries are sorted by name
+struct ArchiveEntry
+{
+    Uint64 nameHash;
+    Uint32 nameOffset;
+    Uint32 nameLength;
+
+    //Blob position in the archive, aligned to kArchiveBlobAlignment
+    Uint64 offset;
+    Uint64 storedSize;
+    Uint64 size;
+    ArchiveCompression compression;
+
+    //FNV-1a of the stored bytes
+    Uint32 checksum;
+};
+
+const Uint64 kArchiveBlobAlignment = 64;
+
+/**
+ * Read side of a packed asset archive.
+ *
+ * The archive is one file: a header, the entries sorted by name, an
+ * open-addressed hash table of entry indices, the names, then every blob
+ * at a 64-byte aligned offset in entry order. open() maps it once and only
+ * checks the header and table bounds; find() hashes the name and probes the
+ * table, so a lookup costs the same for ten assets or ten thousand and
+ * never touches the file system. Uncompressed entries are served as views
+ * into the mapping.
+ */
+class AssetArchive
+{
+public:
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return mFile.isOpen(); }
+
+    //nullptr when the archive has no such file, names use forward slashes
+    const ArchiveEntry* find(std::string_view name) const;
+
+    size_t count() const { return mEntryCount; }
+    const ArchiveEntry& entry(size_t index) const { return mEntries[index]; }
+    std::string_view name(const ArchiveEntry& entry) const;
+
+    //Contents of an entry, a view into the mapping unless it has to be decompressed into scratch
+    bool read(const ArchiveEntry& entry, std::span<const Uint8>& contents, std::vector<Uint8>& scratch) const;
+
+    //Recomputes the checksum of an entry's stored bytes
+    bool verify(const ArchiveEntry& entry) const;
+
+private:
+    MappedFile mFile;
+    const ArchiveEntry* mEntries = nullptr;
+    const Uint32* mSlots = nullptr;
+    const char* mNames = nullptr;
+    size_t mEntryCount = 0;
+    size_t mSlotCount = 0;
+    size_t mNamesSize = 0;
+};
+
+//Writes files into an archive, compressing the ones that shrink by at least an eighth when compress is set
+bool packArchive(const char* outputPath, const std::vector<std::string>& files, bool compress);
+
+/**
+ * Runs the packer when the command line asks for it.
+ *
+ *   --pack out.pak [--no-compress] [file ...]
+ *
+ * Without files, packs the shaders, images and .btex textures next to the
+ * executable. Returns false when no packing was requested, otherwise stores
+ * the process exit code in exitCode.
+ */
+bool runPackerFromArgs(int argc, char* args[], int& exitCode);
+
+//The archive assets are read from before falling back to loose files
+extern AssetArchive gAssets;
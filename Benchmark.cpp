@@ -0,0 +1,291 @@
+#include "Benchmark.h"
+#include "SDLEngine.h"
+#include "BenchmarkCommon.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include "ProgramBinaryCache.h"
+
+using namespace bench;
+
+namespace
+{
+    const char* renderModeName(RenderMode mode)
+    {
+        switch (mode)
+        {
+        case RenderMode::PerObject:
+            return "per-object";
+        case RenderMode::Instanced:
+            return "instanced";
+        default:
+            return "scene";
+        }
+    }
+
+    RenderMode parseRenderMode(const char* name)
+    {
+        if (name && strcmp(name, "per-object") == 0)
+            return RenderMode::PerObject;
+        if (name && strcmp(name, "instanced") == 0)
+            return RenderMode::Instanced;
+        return RenderMode::Scene;
+    }
+
+    int runFrameBenchmark(int argc, char* args[])
+    {
+        const int frames = std::max(1, intArg(argc, args, "--frames", 1000));
+        const int warmup = std::max(0, intArg(argc, args, "--warmup", 60));
+        const bool finish = hasArg(argc, args, "--finish");
+        const char* outPath = findArg(argc, args, "--out");
+        const char* tracePath = findArg(argc, args, "--trace");
+        const bool renderThread = hasArg(argc, args, "--render-thread");
+        const int framePackets = std::clamp(intArg(argc, args, "--frame-packets", 2), 2, 3);
+        const int inputEvery = std::max(1, intArg(argc, args, "--input-every", 10));
+        const bool assertNoAlloc = hasArg(argc, args, "--assert-no-alloc");
+
+        InitOptions options;
+        options.headless = true;
+        options.swapInterval = intArg(argc, args, "--swap-interval", 0);
+        options.renderMode = parseRenderMode(findArg(argc, args, "--mode"));
+        options.objectCount = std::max(1, intArg(argc, args, "--objects", options.objectCount));
+        options.animateObjects = hasArg(argc, args, "--animate");
+        options.shaderCache = !hasArg(argc, args, "--no-shader-cache");
+        options.jobThreads = std::max(0, intArg(argc, args, "--job-threads", 0));
+        options.finishFrames = finish;
+        const char* tickRate = findArg(argc, args, "--tick-rate");
+        options.tickRate = tickRate ? std::max(1.0, atof(tickRate)) : options.tickRate;
+        options.maxTicksPerFrame = std::max(1, intArg(argc, args, "--max-ticks", options.maxTicksPerFrame));
+        options.interpolate = !hasArg(argc, args, "--no-interpolation");
+        const char* pacing = findArg(argc, args, "--pacing");
+        if (pacing && !parsePacingMode(pacing, options.pacing))
+        {
+            SDL_Log("Unknown pacing mode %s, expected off, limit or jit.\n", pacing);
+            return 1;
+        }
+        const char* targetFps = findArg(argc, args, "--target-fps");
+        options.targetFps = targetFps ? atof(targetFps) : options.targetFps;
+        const char* pacingMargin = findArg(argc, args, "--pacing-margin");
+        options.pacingMarginMs = pacingMargin ? atof(pacingMargin) : options.pacingMarginMs;
+        options.textureBudgetMB = std::max(0, intArg(argc, args, "--texture-budget", 0));
+
+        Uint64 initStart = SDL_GetPerformanceCounter();
+        if (!init(options))
+        {
+            SDL_Log("Failed to initialize benchmark!\n");
+            return 1;
+        }
+        const double initMs = elapsedMs(initStart, SDL_GetPerformanceCounter());
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        const char* version = (const char*)glGetString(GL_VERSION);
+        if (renderThread && !startRenderThread(framePackets))
+        {
+            close();
+            return 1;
+        }
+
+        //Fixed step so every run simulates the same scene
+        const Uint64 frameNs = SDL_NS_PER_SECOND / 60;
+        const float deltaTime = (float)((double)frameNs / 1e9);
+        const double msPerTick = 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+        // cpu_ms is what the simulating thread spends per frame, everything else comes from when frames were presented
+        std::vector<double> cpuMs;
+        std::vector<double> pacingLatencyMs;
+        std::vector<FrameTiming> timings;
+        FramePacingStats warmupPacing;
+        HeapCounters warmupHeap;
+        cpuMs.reserve(frames);
+        pacingLatencyMs.reserve(frames);
+        timings.reserve(warmup + frames);
+        for (int i = 0; i < warmup + frames; ++i)
+        {
+            if (i == warmup)
+            {
+                warmupPacing = gFramePacer.stats();
+                warmupHeap = heapCounters();
+            }
+            waitForNextFrame();
+            Uint64 frameStart = SDL_GetPerformanceCounter();
+
+            // A synthetic key press every inputEvery frames, its latency runs until the frame that saw it is presented
+            if (i % inputEvery == 0)
+                noteInput(SDL_GetTicksNS());
+
+            PROFILE_ZONE("Frame");
+            update(frameNs);
+            render(deltaTime);
+            Uint64 submitEnd = SDL_GetPerformanceCounter();
+            present();
+
+            if (i >= warmup)
+            {
+                cpuMs.push_back((double)(submitEnd - frameStart) * msPerTick);
+                pacingLatencyMs.push_back(gFramePacer.stats().lastLatencyMs);
+            }
+            takeFrameTimings(timings);
+        }
+
+        // Steady-state frames should not touch the heap once the arenas and lists have grown
+        HeapCounters frameHeap = heapCounters();
+        const Uint64 heapAllocations = frameHeap.allocations - warmupHeap.allocations;
+        const Uint64 heapBytes = frameHeap.bytes - warmupHeap.bytes;
+        stopRenderThread();
+        takeFrameTimings(timings);
+
+        // Time to first frame counts from before init() to the first presented frame
+        double firstFrameMs = timings.empty() ? 0.0 : (double)(timings.front().presented - initStart) * msPerTick;
+
+        std::vector<double> frameMs;
+        std::vector<double> latencyMs;
+        std::vector<Uint32> drawCalls;
+        Uint64 totalDraws = 0;
+        Uint64 totalInstances = 0;
+        Uint64 totalVertices = 0;
+        Uint64 totalStateIssued = 0;
+        Uint64 totalStateFiltered = 0;
+        double totalFrameMs = 0.0;
+        for (size_t i = std::max<size_t>(warmup, 1); i < timings.size(); ++i)
+        {
+            const FrameTiming& timing = timings[i];
+            frameMs.push_back((double)(timing.presented - timings[i - 1].presented) * msPerTick);
+            if (timing.input != 0)
+                latencyMs.push_back((double)(timing.presented - timing.input) * msPerTick);
+            drawCalls.push_back(timing.counters.drawCalls);
+            totalDraws += timing.counters.drawCalls;
+            totalInstances += timing.counters.instances;
+            totalFrameMs += frameMs.back();
+            totalVertices += timing.counters.vertices;
+            totalStateIssued += timing.counters.stateCallsIssued;
+            totalStateFiltered += timing.counters.stateCallsFiltered;
+        }
+
+        FILE* out = outPath ? fopen(outPath, "w") : stdout;
+        if (!out)
+        {
+            SDL_Log("Unable to open benchmark output %s\n", outPath);
+            close();
+            return 1;
+        }
+
+        fprintf(out, "{\n  \"benchmark\": \"frame\",\n  \"renderer\": ");
+        writeJsonString(out, renderer);
+        fprintf(out, ",\n  \"gl_version\": ");
+        writeJsonString(out, version);
+        fprintf(out, ",\n  \"video_driver\": ");
+        writeJsonString(out, SDL_GetCurrentVideoDriver());
+        fprintf(out, ",\n  \"mode\": \"%s\",\n  \"objects\": %d", renderModeName(options.renderMode), options.objectCount);
+        fprintf(out, ",\n  \"render_thread\": %s,\n  \"frame_packets\": %d", renderThread ? "true" : "false", renderThread ? framePackets : 1);
+        fprintf(out, ",\n  \"tick_rate\": %.2f,\n  \"interpolate\": %s,\n  \"ticks\": %llu,\n  \"dropped_ticks\": %llu", options.tickRate,
+            options.interpolate ? "true" : "false", (unsigned long long)gSimulationClock.ticks(), (unsigned long long)gSimulationClock.droppedTicks());
+        const FramePacingStats& pacingStats = gFramePacer.stats();
+        fprintf(out, ",\n  \"pacing\": {\"mode\": \"%s\", \"frame_rate\": %.2f, \"swap_interval\": %d, \"missed_deadlines\": %llu, "
+            "\"sleep_ms\": %.3f, \"spin_ms\": %.3f, \"max_oversleep_ms\": %.3f}", pacingModeName(gFramePacer.mode()), gFramePacer.frameRate(), gSwapInterval,
+            (unsigned long long)(pacingStats.missedDeadlines - warmupPacing.missedDeadlines), pacingStats.sleepMs - warmupPacing.sleepMs,
+            pacingStats.spinMs - warmupPacing.spinMs, pacingStats.maxOversleepMs);
+        const ProgramCacheCounters& shaderCache = gProgramCache.counters();
+        fprintf(out, ",\n  \"init_ms\": %.3f,\n  \"first_frame_ms\": %.3f", initMs, firstFrameMs);
+        fprintf(out, ",\n  \"shader_cache\": {\"enabled\": %s, \"hits\": %u, \"misses\": %u, \"rejected\": %u, \"stored\": %u}",
+            gProgramCache.enabled() ? "true" : "false", shaderCache.hits, shaderCache.misses, shaderCache.rejected, shaderCache.stored);
+        fprintf(out, ",\n  \"heap_allocations\": {\"total\": %llu, \"per_frame\": %.3f, \"bytes\": %llu}",
+            (unsigned long long)heapAllocations, (double)heapAllocations / frames, (unsigned long long)heapBytes);
+        fprintf(out, ",\n  \"memory\": {");
+        for (int t = 0; t < (int)MemoryTag::Count; ++t)
+        {
+            fprintf(out, "%s\n    \"%s\": {", t > 0 ? "," : "", memoryTagName((MemoryTag)t));
+            for (int d = 0; d < (int)MemoryDomain::Count; ++d)
+            {
+                MemoryUsage usage = memoryUsage((MemoryTag)t, (MemoryDomain)d);
+                fprintf(out, "%s\"%s\": {\"bytes\": %llu, \"peak_bytes\": %llu, \"blocks\": %llu}", d > 0 ? ", " : "", memoryDomainName((MemoryDomain)d),
+                    (unsigned long long)usage.bytes, (unsigned long long)usage.peakBytes, (unsigned long long)usage.blocks);
+            }
+            fprintf(out, "}");
+        }
+        fprintf(out, "\n  },\n  \"memory_budgets\": {\"overruns\": %llu, \"evictions\": %llu}",
+            (unsigned long long)memoryBudgetOverruns(), (unsigned long long)memoryEvictions());
+        fprintf(out, ",\n  \"frames\": %d,\n  \"warmup\": %d,\n  \"finish\": %s,\n", frames, warmup, finish ? "true" : "false");
+        writeStats(out, "cpu_ms", computeStats(cpuMs));
+        writeStats(out, "frame_ms", computeStats(frameMs));
+        writeStats(out, "input_latency_ms", computeStats(latencyMs));
+        writeStats(out, "pacing_latency_ms", computeStats(pacingLatencyMs));
+        fprintf(out, "  \"draw_calls\": {\"total\": %llu, \"per_frame\": %.2f},\n",
+            (unsigned long long)totalDraws, (double)totalDraws / frames);
+        fprintf(out, "  \"instances_per_frame\": %.2f,\n", (double)totalInstances / frames);
+        fprintf(out, "  \"vertices_per_frame\": %.2f,\n", (double)totalVertices / frames);
+        fprintf(out, "  \"state_calls_per_frame\": {\"issued\": %.2f, \"filtered\": %.2f},\n",
+            (double)totalStateIssued / frames, (double)totalStateFiltered / frames);
+        double seconds = std::max(totalFrameMs, 1e-6) / 1000.0;
+        fprintf(out, "  \"draws_per_sec\": %.1f,\n", (double)totalDraws / seconds);
+        fprintf(out, "  \"instances_per_sec\": %.1f,\n", (double)totalInstances / seconds);
+        fprintf(out, "  \"samples\": {\n");
+        writeSamples(out, "cpu_ms", cpuMs, false);
+        writeSamples(out, "frame_ms", frameMs, false);
+        writeSamples(out, "input_latency_ms", latencyMs, false);
+        writeSamples(out, "pacing_latency_ms", pacingLatencyMs, false);
+        writeSamples(out, "draw_calls", drawCalls, true);
+        fprintf(out, "  }\n}\n");
+
+        if (out != stdout)
+            fclose(out);
+
+        if (tracePath)
+            profilerWriteChromeTrace(tracePath);
+
+        close();
+        if (assertNoAlloc && heapAllocations > 0)
+        {
+            SDL_Log("%llu heap allocations in %d steady-state frames!\n", (unsigned long long)heapAllocations, frames);
+            return 1;
+        }
+        return 0;
+    }
+}
+
+bool runBenchmarkFromArgs(int argc, char* args[], int& exitCode)
+{
+    if (hasArg(argc, args, "--bench"))
+    {
+        exitCode = runFrameBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-math"))
+    {
+        exitCode = runAffineMathBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-queue"))
+    {
+        exitCode = runRenderQueueBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-mesh"))
+    {
+        exitCode = runMeshBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-io"))
+    {
+        exitCode = runFileIOBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-textures"))
+    {
+        exitCode = runTextureBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-mips"))
+    {
+        exitCode = runMipBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-bc"))
+    {
+        exitCode = runBlockCompressionBenchmark(argc, args);
+        return true;
+    }
+    if (hasArg(argc, args, "--bench-jobs"))
+    {
+        exitCode = runJobBenchmark(argc, args);
+        return true;
+    }
+    return false;
+}
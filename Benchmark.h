@@ -0,0 +1,96 @@
+#pragma once
+
+/**
+ * Runs a benchmark when the command line asks for one.
+ *
+ *   --bench [--frames N] [--warmup N] [--finish] [--out file.json] [--trace trace.json]
+ *           [--mode scene|per-object|instanced] [--objects N] [--animate] [--no-shader-cache]
+ *           [--job-threads N] [--render-thread] [--frame-packets 2|3] [--input-every N]
+ *           [--tick-rate Hz] [--max-ticks N] [--no-interpolation]
+ *           [--pacing off|limit|jit] [--target-fps N] [--pacing-margin ms] [--swap-interval N]
+ *           [--assert-no-alloc] [--texture-budget MB]
+ *
+ * Drives init()/update()/render() headless with vsync off and writes the
+ * per-frame timings and draw counts as JSON (stdout unless --out is given).
+ * --trace also writes the profiler zones as Chrome trace JSON. --mode picks
+ * how the cube grid of --objects cubes is submitted, draws_per_sec and
+ * instances_per_sec in the output compare the modes. --animate moves every
+ * cube each frame so all world matrices are rebuilt and re-uploaded.
+ * init_ms and first_frame_ms time startup, --no-shader-cache compiles
+ * every program from source to compare against the program binary cache.
+ * --job-threads sizes gJobs, which rebuilds and multiplies the matrices.
+ * --render-thread draws and presents on a render thread fed with frame
+ * packets. frame_ms is the time between presents and input_latency_ms the
+ * time from a synthetic input, noted every --input-every frames, to the
+ * present of the first frame that saw it; cpu_ms is update() plus render()
+ * on the calling thread. Frames advance by 1/60 s; --tick-rate sets how
+ * often the scene is simulated in that time (60 by default) and ticks and
+ * dropped_ticks report what ran. --pacing runs every frame through the
+ * frame pacer at --target-fps (the refresh rate by default, vsync stays off
+ * unless --swap-interval asks for it); pacing reports missed deadlines and
+ * the time spent sleeping and spinning, pacing_latency_ms the time from
+ * the start of a frame to its present. heap_allocations counts operator
+ * new calls on every thread during the measured frames; --assert-no-alloc
+ * fails the run unless there were none. memory reports what each tag holds
+ * on the CPU and in GL buffers and textures after the last frame, with its
+ * peak; --texture-budget sets the texture budget and memory_budgets counts
+ * overruns and evictions.
+ *
+ *   --bench-math [--work N] [--out file.json]
+ *
+ * Compares the old glm matrix chain with the AffineMath batch functions at
+ * 1, 1k and 1M objects.
+ *
+ *   --bench-queue [--work N] [--out file.json]
+ *
+ * Times RenderQueue push, radix sort (next to std::sort of the same keys)
+ * and submission to a backend that issues no GL calls, from 100 to 1M draws.
+ *
+ *   --bench-mesh [--out file.json]
+ *
+ * Builds shuffled UV sphere triangle soups into indexed meshes and reports
+ * vertex counts, ACMR/ATVR before and after optimization and build time.
+ *
+ *   --bench-io [--file path] [--size MB] [--runs N] [--out file.json]
+ *
+ * Reads a file (a generated --size MB file unless --file is given) through
+ * the old ifstream/stringstream path, a single fread and MappedFile, and
+ * reports time, throughput and the number of copies each makes.
+ *
+ *   --bench-textures [--count N] [--size N] [--threads N] [--budget MB] [--out file.json]
+ *
+ * Writes --count noise BMPs of --size pixels square, loads them through a
+ * TextureManager with --threads decode workers and a --budget MB upload
+ * ring, and reports decode and upload throughput, time until all are
+ * resident and the per-frame cost of TextureManager::update().
+ *
+ *   --bench-mips [--image path] [--size N] [--runs N] [--dump prefix] [--out file.json]
+ *
+ * Builds box and Kaiser mip chains of an image (a generated --size square
+ * unless --image is given) with the scalar reference and the SIMD path,
+ * reports both times and the largest difference between their outputs,
+ * and checks known answers for sRGB averaging and alpha handling. Fails
+ * when a check fails or the paths differ by more than one step. --dump
+ * writes every SIMD level as prefix_filter_level.bmp.
+ *
+ *   --bench-bc [--image path] [--size N] [--threads N] [--runs N] [--out file.json]
+ *
+ * Compresses the mip chain of an image to every block format at both
+ * qualities and reports single-threaded and threaded encode time, PSNR of
+ * level 0 and the size against RGBA8, then times uploading the chain
+ * compressed and as RGBA8 and reads back the size the driver reports.
+ * Every format also encodes a 4x4 ramp twice, green rising with red and
+ * against it; fails when the opposed ramp is more than 1 dB worse.
+ *
+ *   --bench-jobs [--objects N] [--max-threads N] [--runs N] [--out file.json]
+ *
+ * Transforms and frustum-culls --objects objects (1M by default) through
+ * gJobs at 1, 2, 4 ... --max-threads threads (64 by default), the cull jobs
+ * waiting on the transform counter, and reports time, speedup over one
+ * thread and stolen jobs. Fails unless every thread count produces the
+ * same matrices and visibility as plain loops.
+ *
+ * Returns false when no benchmark was requested, otherwise stores the
+ * process exit code in exitCode.
+ */
+bool runBenchmarkFromArgs(int argc, char* args[], int& exitCode);
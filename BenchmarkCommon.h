@@ -0,0 +1,137 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//Helpers shared by the benchmark runners
+namespace bench
+{
+    struct Stats
+    {
+        double mean = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    //Nearest-rank percentile of an already sorted sample set
+    inline double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = (size_t)std::ceil(p / 100.0 * (double)sorted.size());
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    inline Stats computeStats(std::vector<double> samples)
+    {
+        Stats stats;
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for (double s : samples)
+            sum += s;
+
+        stats.mean = sum / (double)samples.size();
+        stats.min = samples.front();
+        stats.max = samples.back();
+        stats.p50 = percentile(samples, 50.0);
+        stats.p95 = percentile(samples, 95.0);
+        stats.p99 = percentile(samples, 99.0);
+        return stats;
+    }
+
+    inline void writeJsonString(FILE* out, const char* text)
+    {
+        fputc('"', out);
+        for (const char* c = text ? text : ""; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                fprintf(out, "\\%c", *c);
+            else if ((unsigned char)*c < 0x20)
+                fprintf(out, "\\u%04x", (unsigned char)*c);
+            else
+                fputc(*c, out);
+        }
+        fputc('"', out);
+    }
+
+    inline void writeStats(FILE* out, const char* name, const Stats& stats)
+    {
+        fprintf(out, "  \"%s\": {\"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f},\n",
+            name, stats.mean, stats.min, stats.max, stats.p50, stats.p95, stats.p99);
+    }
+
+    template <typename T>
+    inline void writeSamples(FILE* out, const char* name, const std::vector<T>& samples, bool last)
+    {
+        fprintf(out, "    \"%s\": [", name);
+        for (size_t i = 0; i < samples.size(); ++i)
+            fprintf(out, i ? ", %.4f" : "%.4f", (double)samples[i]);
+        fprintf(out, last ? "]\n" : "],\n");
+    }
+
+    //Returns the value following flag, or nullptr when the flag is absent
+    inline const char* findArg(int argc, char* args[], const char* flag)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+        {
+            if (strcmp(args[i], flag) == 0)
+                return args[i + 1];
+        }
+        return nullptr;
+    }
+
+    inline bool hasArg(int argc, char* args[], const char* flag)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (strcmp(args[i], flag) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    inline int intArg(int argc, char* args[], const char* flag, int fallback)
+    {
+        const char* value = findArg(argc, args, flag);
+        return value ? atoi(value) : fallback;
+    }
+
+    inline double elapsedMs(Uint64 start, Uint64 end)
+    {
+        return (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    }
+
+    //Fastest of runs calls to fn, in milliseconds
+    template <typename Fn>
+    inline double bestMs(int runs, Fn&& fn)
+    {
+        double best = 1e300;
+        for (int run = 0; run < runs; ++run)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            fn();
+            best = std::min(best, elapsedMs(start, SDL_GetPerformanceCounter()));
+        }
+        return best;
+    }
+}
+
+//Micro-benchmark runners, each returns the process exit code
+int runAffineMathBenchmark(int argc, char* args[]);
+int runRenderQueueBenchmark(int argc, char* args[]);
+int runMeshBenchmark(int argc, char* args[]);
+int runFileIOBenchmark(int argc, char* args[]);
+int runTextureBenchmark(int argc, char* args[]);
+int runMipBenchmark(int argc, char* args[]);
+int runBlockCompressionBenchmark(int argc, char* args[]);
+int runJobBenchmark(int argc, char* args[]);
@@ -0,0 +1,236 @@
+#include "BenchmarkCommon.h"
+#include "BlockCompressor.h"
+#include "SDLEngine.h"
+#include "TextureManager.h"
+#include <GL/glew.h>
+#include <cmath>
+
+using namespace bench;
+
+namespace
+{
+    //Smooth gradients, hard edges and noise, so both the easy and the hard blocks show up in the error
+    std::vector<Uint8> makeTestImage(int size)
+    {
+        std::vector<Uint8> pixels((size_t)size * size * 4);
+        Uint32 state = 0x2468ACE1u;
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                state = state * 1664525u + 1013904223u;
+                Uint8* p = pixels.data() + ((size_t)y * size + x) * 4;
+                p[0] = (Uint8)(127.5f + 127.5f * std::sin(x * 0.02f));
+                p[1] = (Uint8)(y * 255 / size);
+                p[2] = ((x / 32 + y / 32) & 1) ? (Uint8)(state >> 26) : 200;
+                p[3] = 255;
+            }
+        }
+        return pixels;
+    }
+
+    //Peak signal to noise ratio of the channels a format keeps
+    double psnr(const Uint8* a, const Uint8* b, size_t texels, int channels)
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i < texels; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                double d = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+                sum += d * d;
+            }
+        }
+        double mse = sum / ((double)texels * channels);
+        return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+    }
+
+    //PSNR of one 4x4 block ramping red up from 0 to 240 over blue 80, with green rising alongside or, when opposed, falling
+    double rampPsnr(BlockFormat format, BlockQuality quality, bool opposed, int channels)
+    {
+        Uint8 block[16 * 4];
+        for (int i = 0; i < 16; ++i)
+        {
+            Uint8 t = (Uint8)(i * 240 / 15);
+            block[i * 4 + 0] = t;
+            block[i * 4 + 1] = opposed ? (Uint8)(240 - t) : t;
+            block[i * 4 + 2] = 80;
+            block[i * 4 + 3] = 255;
+        }
+
+        BlockOptions options;
+        options.format = format;
+        options.quality = quality;
+        options.threads = 1;
+        Uint8 compressed[16], decoded[16 * 4];
+        compressImage(block, 4, 4, options, compressed);
+        decompressImage(format, compressed, 4, 4, decoded);
+        return psnr(block, decoded, 16, channels);
+    }
+
+    GLenum glFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        default:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    //Best-of-runs time to create a texture and upload every level, glFinish included; reports the driver's size
+    template <typename Upload>
+    double timeUpload(int runs, GLenum internalFormat, const std::vector<MipLevel>& levels, GLint& driverBytes, Upload&& upload)
+    {
+        double best = 1e300;
+        for (int run = 0; run < runs; ++run)
+        {
+            GLuint texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glFinish();
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            glTexStorage2D(GL_TEXTURE_2D, (GLsizei)levels.size(), internalFormat, levels[0].width, levels[0].height);
+            for (size_t i = 0; i < levels.size(); ++i)
+                upload(i);
+            glFinish();
+            best = std::min(best, elapsedMs(start, SDL_GetPerformanceCounter()));
+
+            driverBytes = 0;
+            for (size_t i = 0; i < levels.size(); ++i)
+            {
+                GLint compressed = GL_FALSE, size = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, (GLint)i, GL_TEXTURE_COMPRESSED, &compressed);
+                if (compressed)
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, (GLint)i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                else
+                    size = levels[i].width * levels[i].height * 4;
+                driverBytes += size;
+            }
+            glDeleteTextures(1, &texture);
+        }
+        return best;
+    }
+}
+
+int runBlockCompressionBenchmark(int argc, char* args[])
+{
+    const char* outPath = findArg(argc, args, "--out");
+    const char* imagePath = findArg(argc, args, "--image");
+    const int size = std::max(4, intArg(argc, args, "--size", 2048));
+    const int runs = std::max(1, intArg(argc, args, "--runs", 3));
+    const int threads = std::max(0, intArg(argc, args, "--threads", 0));
+
+    InitOptions initOptions;
+    initOptions.headless = true;
+    initOptions.swapInterval = 0;
+    if (!init(initOptions))
+    {
+        SDL_Log("Failed to initialize benchmark!\n");
+        return 1;
+    }
+
+    int width = size, height = size;
+    std::vector<Uint8> pixels;
+    if (imagePath && !decodeImageFile(imagePath, width, height, pixels))
+    {
+        SDL_Log("Unable to load %s\n", imagePath);
+        close();
+        return 1;
+    }
+    if (!imagePath)
+        pixels = makeTestImage(size);
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        close();
+        return 1;
+    }
+
+    MipChain mips;
+    generateMipChain(pixels.data(), width, height, MipOptions(), mips);
+    const double megapixels = (double)mips.pixels.size() / 4.0 / 1e6;
+    const bool s3tc = GLEW_EXT_texture_compression_s3tc != 0;
+
+    // Uncompressed RGBA8 is the baseline for footprint and upload time
+    GLint rgbaDriverBytes = 0;
+    double rgbaUploadMs = timeUpload(runs, GL_RGBA8, mips.levels, rgbaDriverBytes, [&](size_t i)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, mips.levels[i].width, mips.levels[i].height, GL_RGBA, GL_UNSIGNED_BYTE, mips.level(i));
+    });
+
+    fprintf(out, "{\n  \"benchmark\": \"block_compression\",\n  \"image\": ");
+    writeJsonString(out, imagePath ? imagePath : "generated");
+    fprintf(out, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"levels\": %zu,\n  \"threads\": %d,\n  \"s3tc\": %s,\n",
+        width, height, mips.levels.size(), threads ? threads : SDL_GetNumLogicalCPUCores(), s3tc ? "true" : "false");
+    fprintf(out, "  \"rgba8\": {\"bytes\": %zu, \"driver_bytes\": %d, \"upload_ms\": %.3f},\n  \"results\": [\n",
+        mips.pixels.size(), rgbaDriverBytes, rgbaUploadMs);
+
+    const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 };
+    const BlockQuality qualities[] = { BlockQuality::Fast, BlockQuality::High };
+    std::vector<Uint8> decoded(mips.levelSize(0));
+    bool first = true;
+    bool rampsMatch = true;
+    for (BlockFormat format : formats)
+    {
+        for (BlockQuality quality : qualities)
+        {
+            BlockOptions options;
+            options.format = format;
+            options.quality = quality;
+            BlockChain chain;
+
+            options.threads = 1;
+            double singleMs = bestMs(runs, [&] { compressMipChain(mips, options, chain); });
+            options.threads = threads;
+            double threadedMs = bestMs(runs, [&] { compressMipChain(mips, options, chain); });
+
+            const int channels = format == BlockFormat::BC1 ? 3 : format == BlockFormat::BC5 ? 2 : 4;
+            decompressImage(format, chain.level(0), width, height, decoded.data());
+            double quality0 = psnr(mips.level(0), decoded.data(), (size_t)width * height, channels);
+
+            // Known answer: channels running against each other fit on an axis as well as channels running together
+            double rampDb = rampPsnr(format, quality, false, channels);
+            double opposedRampDb = rampPsnr(format, quality, true, channels);
+            if (opposedRampDb < rampDb - 1.0)
+            {
+                SDL_Log("%s %s encodes the opposed ramp at %.2f dB against %.2f dB\n", blockFormatName(format),
+                    quality == BlockQuality::Fast ? "fast" : "high", opposedRampDb, rampDb);
+                rampsMatch = false;
+            }
+
+            fprintf(out, "%s    {\"format\": \"%s\", \"quality\": \"%s\", \"bytes\": %zu, \"ratio\": %.2f, \"psnr_db\": %.2f, \"ramp_psnr_db\": %.2f, \"opposed_ramp_psnr_db\": %.2f, \"encode_ms\": %.3f, \"encode_threaded_ms\": %.3f, \"threaded_mpixels_per_sec\": %.1f",
+                first ? "" : ",\n", blockFormatName(format), quality == BlockQuality::Fast ? "fast" : "high", chain.blocks.size(),
+                (double)mips.pixels.size() / (double)chain.blocks.size(), quality0, rampDb, opposedRampDb, singleMs, threadedMs, megapixels / std::max(threadedMs / 1000.0, 1e-9));
+            first = false;
+
+            // Upload is the same for both qualities, timed once per format
+            if (quality == BlockQuality::Fast && (s3tc || (format != BlockFormat::BC1 && format != BlockFormat::BC3)))
+            {
+                GLint driverBytes = 0;
+                double uploadMs = timeUpload(runs, glFormat(format), chain.levels, driverBytes, [&](size_t i)
+                {
+                    glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, chain.levels[i].width, chain.levels[i].height,
+                        glFormat(format), (GLsizei)chain.levelSize(i), chain.level(i));
+                });
+                fprintf(out, ", \"driver_bytes\": %d, \"upload_ms\": %.3f, \"upload_speedup\": %.2f", driverBytes, uploadMs, rgbaUploadMs / std::max(uploadMs, 1e-9));
+            }
+            fprintf(out, "}");
+        }
+    }
+    fprintf(out, "\n  ],\n  \"ramps_match\": %s\n}\n", rampsMatch ? "true" : "false");
+
+    if (out != stdout)
+        fclose(out);
+
+    close();
+    return rampsMatch ? 0 : 1;
+}
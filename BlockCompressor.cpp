@@ -0,0 +1,914 @@
+#include "BlockCompressor.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSOR_SSE 1
+#endif
+
+#if defined(BLOCK_COMPRESSOR_SSE)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    //Texels of one block as floats, one array per channel so four texels fill an SSE register
+    struct BlockTexels
+    {
+        alignas(16) float c[4][16];
+    };
+
+    //Weight of the second endpoint for each index, BC1 and BC4 palettes store the endpoints first
+    const float kColourWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    const float kAlphaWeights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+    //BC7 4-bit index weights out of 64
+    const int kMode6Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    void gatherBlock(const Uint8* pixels, int width, int height, int blockX, int blockY, BlockTexels& block)
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            const Uint8* row = pixels + (size_t)std::min(blockY * 4 + y, height - 1) * width * 4;
+            for (int x = 0; x < 4; ++x)
+            {
+                const Uint8* texel = row + (size_t)std::min(blockX * 4 + x, width - 1) * 4;
+                for (int c = 0; c < 4; ++c)
+                    block.c[c][y * 4 + x] = texel[c];
+            }
+        }
+    }
+
+    void blockBounds(const BlockTexels& block, int channels, float minimum[4], float maximum[4])
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+#if defined(BLOCK_COMPRESSOR_SSE)
+            __m128 lo = _mm_load_ps(block.c[c]), hi = lo;
+            for (int i = 4; i < 16; i += 4)
+            {
+                __m128 texels = _mm_load_ps(block.c[c] + i);
+                lo = _mm_min_ps(lo, texels);
+                hi = _mm_max_ps(hi, texels);
+            }
+            lo = _mm_min_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 0, 3, 2)));
+            hi = _mm_max_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 0, 3, 2)));
+            minimum[c] = _mm_cvtss_f32(_mm_min_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 3, 0, 1))));
+            maximum[c] = _mm_cvtss_f32(_mm_max_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 3, 0, 1))));
+#else
+            minimum[c] = *std::min_element(block.c[c], block.c[c] + 16);
+            maximum[c] = *std::max_element(block.c[c], block.c[c] + 16);
+#endif
+        }
+    }
+
+    //Shrinks the bounding box by a sixteenth on each side, the extremes are rarely worth a palette entry
+    void insetBounds(int channels, float minimum[4], float maximum[4])
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            float inset = (maximum[c] - minimum[c]) / 16.0f;
+            minimum[c] += inset;
+            maximum[c] -= inset;
+        }
+    }
+
+    //Swaps the bounds of the channels that fall while the widest one rises, so the box diagonal follows the texels
+    void orientBounds(const BlockTexels& block, int channels, float minimum[4], float maximum[4])
+    {
+        int widest = 0;
+        for (int c = 1; c < channels; ++c)
+        {
+            if (maximum[c] - minimum[c] > maximum[widest] - minimum[widest])
+                widest = c;
+        }
+
+        float mean[4];
+        for (int c = 0; c < channels; ++c)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < 16; ++i)
+                sum += block.c[c][i];
+            mean[c] = sum / 16.0f;
+        }
+
+        for (int c = 0; c < channels; ++c)
+        {
+            float covariance = 0.0f;
+            for (int i = 0; i < 16; ++i)
+                covariance += (block.c[widest][i] - mean[widest]) * (block.c[c][i] - mean[c]);
+            if (covariance < 0.0f)
+                std::swap(minimum[c], maximum[c]);
+        }
+    }
+
+    //Position of every texel along origin + t * axis, rounded to 0..steps
+    void projectTexels(const BlockTexels& block, int firstChannel, int channels, const float origin[4], const float axis[4], int steps, int positions[16])
+    {
+        float lengthSq = 0.0f;
+        for (int c = 0; c < channels; ++c)
+            lengthSq += axis[c] * axis[c];
+        if (lengthSq <= 0.0f)
+        {
+            std::fill(positions, positions + 16, 0);
+            return;
+        }
+        const float scale = (float)steps / lengthSq;
+
+#if defined(BLOCK_COMPRESSOR_SSE)
+        for (int i = 0; i < 16; i += 4)
+        {
+            __m128 dot = _mm_setzero_ps();
+            for (int c = 0; c < channels; ++c)
+            {
+                __m128 offset = _mm_sub_ps(_mm_load_ps(block.c[firstChannel + c] + i), _mm_set1_ps(origin[c]));
+                dot = _mm_add_ps(dot, _mm_mul_ps(offset, _mm_set1_ps(axis[c])));
+            }
+            __m128 t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(dot, _mm_set1_ps(scale)), _mm_setzero_ps()), _mm_set1_ps((float)steps));
+            _mm_storeu_si128((__m128i*)(positions + i), _mm_cvtps_epi32(t));
+        }
+#else
+        for (int i = 0; i < 16; ++i)
+        {
+            float dot = 0.0f;
+            for (int c = 0; c < channels; ++c)
+                dot += (block.c[firstChannel + c][i] - origin[c]) * axis[c];
+            positions[i] = (int)(std::clamp(dot * scale, 0.0f, (float)steps) + 0.5f);
+        }
+#endif
+    }
+
+    //Nearest palette entry of every texel by squared distance
+    template <int Entries>
+    int nearestIndices(const BlockTexels& block, int firstChannel, int channels, const int palette[Entries][4], int indices[16])
+    {
+        int error = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int e = 0; e < Entries; ++e)
+            {
+                int distance = 0;
+                for (int c = 0; c < channels; ++c)
+                {
+                    int d = (int)block.c[firstChannel + c][i] - palette[e][c];
+                    distance += d * d;
+                }
+                if (distance < bestError)
+                {
+                    bestError = distance;
+                    best = e;
+                }
+            }
+            indices[i] = best;
+            error += bestError;
+        }
+        return error;
+    }
+
+    template <int Entries>
+    int paletteError(const BlockTexels& block, int firstChannel, int channels, const int palette[Entries][4], const int indices[16])
+    {
+        int error = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                int d = (int)block.c[firstChannel + c][i] - palette[indices[i]][c];
+                error += d * d;
+            }
+        }
+        return error;
+    }
+
+    //Mean and principal axis of the texels, by power iteration on their covariance
+    void principalAxis(const BlockTexels& block, int channels, float mean[4], float axis[4])
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < 16; ++i)
+                sum += block.c[c][i];
+            mean[c] = sum / 16.0f;
+        }
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int a = 0; a < channels; ++a)
+            {
+                for (int b = a; b < channels; ++b)
+                    covariance[a][b] += (block.c[a][i] - mean[a]) * (block.c[b][i] - mean[b]);
+            }
+        }
+        for (int a = 0; a < channels; ++a)
+        {
+            for (int b = 0; b < a; ++b)
+                covariance[a][b] = covariance[b][a];
+        }
+
+        // Starting from the column of the widest channel keeps channels that run against each other, (1, 1, 1) would be orthogonal to them
+        int widest = 0;
+        for (int c = 1; c < channels; ++c)
+        {
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        }
+        for (int c = 0; c < channels; ++c)
+            axis[c] = covariance[widest][c];
+        if (covariance[widest][widest] <= 0.0f)
+        {
+            for (int c = 0; c < channels; ++c)
+                axis[c] = 1.0f;
+        }
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[4] = {};
+            float length = 0.0f;
+            for (int a = 0; a < channels; ++a)
+            {
+                for (int b = 0; b < channels; ++b)
+                    next[a] += covariance[a][b] * axis[b];
+                length = std::max(length, std::fabs(next[a]));
+            }
+            if (length <= 0.0f)
+                break;
+            for (int c = 0; c < channels; ++c)
+                axis[c] = next[c] / length;
+        }
+    }
+
+    //Endpoints spanning the texels along the principal axis
+    void axisEndpoints(const BlockTexels& block, int channels, float e0[4], float e1[4])
+    {
+        float mean[4], axis[4];
+        principalAxis(block, channels, mean, axis);
+
+        float lo = 0.0f, hi = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < channels; ++c)
+                t += (block.c[c][i] - mean[c]) * axis[c];
+            lo = std::min(lo, t);
+            hi = std::max(hi, t);
+        }
+
+        float lengthSq = 0.0f;
+        for (int c = 0; c < channels; ++c)
+            lengthSq += axis[c] * axis[c];
+        for (int c = 0; c < channels; ++c)
+        {
+            float direction = lengthSq > 0.0f ? axis[c] / lengthSq : 0.0f;
+            e0[c] = std::clamp(mean[c] + direction * hi, 0.0f, 255.0f);
+            e1[c] = std::clamp(mean[c] + direction * lo, 0.0f, 255.0f);
+        }
+    }
+
+    //Least-squares endpoints for fixed per-texel weights of e1, false when the weights cannot separate them
+    bool fitEndpoints(const BlockTexels& block, int channels, const float weights[16], float e0[4], float e1[4])
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            float w = weights[i];
+            a += (1.0f - w) * (1.0f - w);
+            b += (1.0f - w) * w;
+            c += w * w;
+        }
+        float determinant = a * c - b * b;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            float x = 0.0f, y = 0.0f;
+            for (int i = 0; i < 16; ++i)
+            {
+                x += (1.0f - weights[i]) * block.c[ch][i];
+                y += weights[i] * block.c[ch][i];
+            }
+            e0[ch] = std::clamp((c * x - b * y) / determinant, 0.0f, 255.0f);
+            e1[ch] = std::clamp((a * y - b * x) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    Uint16 pack565(const float colour[4])
+    {
+        int r = (int)(colour[0] * 31.0f / 255.0f + 0.5f);
+        int g = (int)(colour[1] * 63.0f / 255.0f + 0.5f);
+        int b = (int)(colour[2] * 31.0f / 255.0f + 0.5f);
+        return (Uint16)(r << 11 | g << 5 | b);
+    }
+
+    void unpack565(Uint16 packed, int colour[4])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        colour[0] = r << 3 | r >> 2;
+        colour[1] = g << 2 | g >> 4;
+        colour[2] = b << 3 | b >> 2;
+        colour[3] = 255;
+    }
+
+    void colourPalette(Uint16 c0, Uint16 c1, int palette[4][4])
+    {
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int c = 0; c < 4; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    //BC1 colour block: quantizes the endpoints, picks the indices and writes 8 bytes, returns the squared error
+    int encodeColour(const BlockTexels& block, const float e0[4], const float e1[4], bool nearest, Uint8* out, int indices[16])
+    {
+        // c0 > c1 selects the four-colour palette, equal endpoints only ever use index 0
+        Uint16 c0 = pack565(e0), c1 = pack565(e1);
+        if (c0 < c1)
+            std::swap(c0, c1);
+        int palette[4][4];
+        colourPalette(c0, c1, palette);
+
+        int error;
+        if (c0 == c1)
+        {
+            std::fill(indices, indices + 16, 0);
+            error = paletteError<4>(block, 0, 3, palette, indices);
+        }
+        else if (nearest)
+        {
+            error = nearestIndices<4>(block, 0, 3, palette, indices);
+        }
+        else
+        {
+            static const int kOrder[4] = { 0, 2, 3, 1 };
+            const float origin[4] = { (float)palette[0][0], (float)palette[0][1], (float)palette[0][2] };
+            const float axis[4] = { (float)(palette[1][0] - palette[0][0]), (float)(palette[1][1] - palette[0][1]), (float)(palette[1][2] - palette[0][2]) };
+            projectTexels(block, 0, 3, origin, axis, 3, indices);
+            for (int i = 0; i < 16; ++i)
+                indices[i] = kOrder[indices[i]];
+            error = paletteError<4>(block, 0, 3, palette, indices);
+        }
+
+        Uint32 bits = 0;
+        for (int i = 0; i < 16; ++i)
+            bits |= (Uint32)indices[i] << (2 * i);
+        out[0] = (Uint8)c0;
+        out[1] = (Uint8)(c0 >> 8);
+        out[2] = (Uint8)c1;
+        out[3] = (Uint8)(c1 >> 8);
+        memcpy(out + 4, &bits, sizeof(bits));
+        return error;
+    }
+
+    void compressColour(const BlockTexels& block, BlockQuality quality, Uint8* out)
+    {
+        int indices[16];
+        if (quality == BlockQuality::Fast)
+        {
+            float minimum[4], maximum[4];
+            blockBounds(block, 3, minimum, maximum);
+            insetBounds(3, minimum, maximum);
+            orientBounds(block, 3, minimum, maximum);
+            encodeColour(block, maximum, minimum, false, out, indices);
+            return;
+        }
+
+        float e0[4], e1[4];
+        axisEndpoints(block, 3, e0, e1);
+        int best = encodeColour(block, e0, e1, true, out, indices);
+
+        Uint8 candidate[8];
+        for (int iteration = 0; iteration < 2 && best > 0; ++iteration)
+        {
+            float weights[16];
+            for (int i = 0; i < 16; ++i)
+                weights[i] = kColourWeights[indices[i]];
+            if (!fitEndpoints(block, 3, weights, e0, e1))
+                break;
+
+            int error = encodeColour(block, e0, e1, true, candidate, indices);
+            if (error >= best)
+                break;
+            best = error;
+            memcpy(out, candidate, sizeof(candidate));
+        }
+    }
+
+    //One channel in 8 bytes: two 8-bit endpoints and a 3-bit index per texel, always the 8-value palette
+    int encodeChannel(const BlockTexels& block, int channel, float first, float second, bool nearest, Uint8* out, int indices[16])
+    {
+        int a0 = (int)(std::max(first, second) + 0.5f);
+        int a1 = (int)(std::min(first, second) + 0.5f);
+        int palette[8][4];
+        palette[0][0] = a0;
+        palette[1][0] = a1;
+        for (int k = 2; k < 8; ++k)
+            palette[k][0] = ((8 - k) * a0 + (k - 1) * a1 + 3) / 7;
+
+        int error;
+        if (a0 == a1)
+        {
+            std::fill(indices, indices + 16, 0);
+            error = paletteError<8>(block, channel, 1, palette, indices);
+        }
+        else if (nearest)
+        {
+            error = nearestIndices<8>(block, channel, 1, palette, indices);
+        }
+        else
+        {
+            const float origin[4] = { (float)a0 };
+            const float axis[4] = { (float)(a1 - a0) };
+            projectTexels(block, channel, 1, origin, axis, 7, indices);
+            for (int i = 0; i < 16; ++i)
+                indices[i] = indices[i] == 0 ? 0 : indices[i] == 7 ? 1 : indices[i] + 1;
+            error = paletteError<8>(block, channel, 1, palette, indices);
+        }
+
+        Uint64 bits = 0;
+        for (int i = 0; i < 16; ++i)
+            bits |= (Uint64)indices[i] << (3 * i);
+        out[0] = (Uint8)a0;
+        out[1] = (Uint8)a1;
+        for (int i = 0; i < 6; ++i)
+            out[2 + i] = (Uint8)(bits >> (8 * i));
+        return error;
+    }
+
+    void compressChannel(const BlockTexels& block, int channel, BlockQuality quality, Uint8* out)
+    {
+        float minimum[4], maximum[4];
+        const BlockTexels* source = &block;
+
+        // The bounds and fit work on channel 0, so a single-channel copy is made for the others
+        BlockTexels single;
+        if (channel != 0)
+        {
+            memcpy(single.c[0], block.c[channel], sizeof(single.c[0]));
+            source = &single;
+        }
+        blockBounds(*source, 1, minimum, maximum);
+
+        int indices[16];
+        if (quality == BlockQuality::Fast)
+        {
+            encodeChannel(*source, 0, maximum[0], minimum[0], false, out, indices);
+            return;
+        }
+
+        int best = encodeChannel(*source, 0, maximum[0], minimum[0], true, out, indices);
+        Uint8 candidate[8];
+        float e0[4] = { (float)out[0] }, e1[4] = { (float)out[1] };
+        for (int iteration = 0; iteration < 2 && best > 0; ++iteration)
+        {
+            float weights[16];
+            for (int i = 0; i < 16; ++i)
+                weights[i] = kAlphaWeights[indices[i]];
+            if (!fitEndpoints(*source, 1, weights, e0, e1))
+                break;
+
+            int error = encodeChannel(*source, 0, e0[0], e1[0], true, candidate, indices);
+            if (error >= best)
+                break;
+            best = error;
+            memcpy(out, candidate, sizeof(candidate));
+        }
+    }
+
+    struct BitWriter
+    {
+        Uint8* out;
+        int position = 0;
+
+        void write(Uint32 value, int bits)
+        {
+            for (int i = 0; i < bits; ++i, ++position)
+            {
+                if (value >> i & 1)
+                    out[position >> 3] |= (Uint8)(1 << (position & 7));
+            }
+        }
+    };
+
+    struct BitReader
+    {
+        const Uint8* in;
+        int position = 0;
+
+        Uint32 read(int bits)
+        {
+            Uint32 value = 0;
+            for (int i = 0; i < bits; ++i, ++position)
+                value |= (Uint32)(in[position >> 3] >> (position & 7) & 1) << i;
+            return value;
+        }
+    };
+
+    //7-bit value and shared p-bit of one mode 6 endpoint, the p-bit is whichever lands closer
+    void quantizeMode6(const float endpoint[4], int quantized[4], int& pBit)
+    {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; ++p)
+        {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                candidate[c] = std::clamp((int)((endpoint[c] - p) / 2.0f + 0.5f), 0, 127);
+                float d = (float)(candidate[c] * 2 + p) - endpoint[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    //BC7 mode 6 block: one subset, RGBA 7.7.7.7 endpoints with a p-bit each, 4-bit indices
+    int encodeMode6(const BlockTexels& block, const float e0[4], const float e1[4], bool nearest, Uint8* out, int indices[16])
+    {
+        int q[2][4], p[2];
+        quantizeMode6(e0, q[0], p[0]);
+        quantizeMode6(e1, q[1], p[1]);
+
+        int endpoints[2][4], palette[16][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            endpoints[0][c] = q[0][c] << 1 | p[0];
+            endpoints[1][c] = q[1][c] << 1 | p[1];
+        }
+        for (int k = 0; k < 16; ++k)
+        {
+            for (int c = 0; c < 4; ++c)
+                palette[k][c] = ((64 - kMode6Weights[k]) * endpoints[0][c] + kMode6Weights[k] * endpoints[1][c] + 32) >> 6;
+        }
+
+        int error;
+        if (nearest)
+        {
+            error = nearestIndices<16>(block, 0, 4, palette, indices);
+        }
+        else
+        {
+            // Positions out of 64 snap to the closest of the uneven weights
+            static const auto kNearestWeight = [] {
+                std::vector<int> table(65);
+                for (int t = 0; t <= 64; ++t)
+                {
+                    int best = 0;
+                    for (int k = 1; k < 16; ++k)
+                    {
+                        if (std::abs(kMode6Weights[k] - t) < std::abs(kMode6Weights[best] - t))
+                            best = k;
+                    }
+                    table[t] = best;
+                }
+                return table;
+            }();
+            const float origin[4] = { (float)endpoints[0][0], (float)endpoints[0][1], (float)endpoints[0][2], (float)endpoints[0][3] };
+            float axis[4];
+            for (int c = 0; c < 4; ++c)
+                axis[c] = (float)(endpoints[1][c] - endpoints[0][c]);
+            projectTexels(block, 0, 4, origin, axis, 64, indices);
+            for (int i = 0; i < 16; ++i)
+                indices[i] = kNearestWeight[indices[i]];
+            error = paletteError<16>(block, 0, 4, palette, indices);
+        }
+
+        // The first texel's index is stored in 3 bits, so its top bit must be clear: swap the endpoints if not
+        int stored[16];
+        memcpy(stored, indices, sizeof(stored));
+        if (stored[0] & 8)
+        {
+            std::swap(q[0], q[1]);
+            std::swap(p[0], p[1]);
+            for (int i = 0; i < 16; ++i)
+                stored[i] = 15 - stored[i];
+        }
+
+        memset(out, 0, 16);
+        BitWriter writer = { out };
+        writer.write(1 << 6, 7);
+        for (int c = 0; c < 4; ++c)
+        {
+            writer.write(q[0][c], 7);
+            writer.write(q[1][c], 7);
+        }
+        writer.write(p[0], 1);
+        writer.write(p[1], 1);
+        writer.write(stored[0], 3);
+        for (int i = 1; i < 16; ++i)
+            writer.write(stored[i], 4);
+        return error;
+    }
+
+    void compressMode6(const BlockTexels& block, BlockQuality quality, Uint8* out)
+    {
+        int indices[16];
+        if (quality == BlockQuality::Fast)
+        {
+            float minimum[4], maximum[4];
+            blockBounds(block, 4, minimum, maximum);
+            insetBounds(4, minimum, maximum);
+            orientBounds(block, 4, minimum, maximum);
+            encodeMode6(block, minimum, maximum, false, out, indices);
+            return;
+        }
+
+        float e0[4], e1[4];
+        axisEndpoints(block, 4, e0, e1);
+        int best = encodeMode6(block, e0, e1, true, out, indices);
+
+        Uint8 candidate[16];
+        for (int iteration = 0; iteration < 2 && best > 0; ++iteration)
+        {
+            float weights[16];
+            for (int i = 0; i < 16; ++i)
+                weights[i] = kMode6Weights[indices[i]] / 64.0f;
+            if (!fitEndpoints(block, 4, weights, e0, e1))
+                break;
+
+            int error = encodeMode6(block, e0, e1, true, candidate, indices);
+            if (error >= best)
+                break;
+            best = error;
+            memcpy(out, candidate, sizeof(candidate));
+        }
+    }
+
+    void compressBlock(const BlockTexels& block, const BlockOptions& options, Uint8* out)
+    {
+        switch (options.format)
+        {
+        case BlockFormat::BC1:
+            compressColour(block, options.quality, out);
+            break;
+        case BlockFormat::BC3:
+            compressChannel(block, 3, options.quality, out);
+            compressColour(block, options.quality, out + 8);
+            break;
+        case BlockFormat::BC5:
+            compressChannel(block, 0, options.quality, out);
+            compressChannel(block, 1, options.quality, out + 8);
+            break;
+        case BlockFormat::BC7:
+            compressMode6(block, options.quality, out);
+            break;
+        }
+    }
+
+    void decodeColour(const Uint8* in, bool fourColour, Uint8 texels[16][4])
+    {
+        Uint16 c0 = (Uint16)(in[0] | in[1] << 8), c1 = (Uint16)(in[2] | in[3] << 8);
+        int palette[4][4];
+        colourPalette(c0, c1, palette);
+        if (!fourColour && c0 <= c1)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+
+        Uint32 bits;
+        memcpy(&bits, in + 4, sizeof(bits));
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+                texels[i][c] = (Uint8)palette[bits >> (2 * i) & 3][c];
+        }
+    }
+
+    void decodeChannel(const Uint8* in, Uint8 values[16])
+    {
+        int a0 = in[0], a1 = in[1], palette[8] = { a0, a1 };
+        if (a0 > a1)
+        {
+            for (int k = 2; k < 8; ++k)
+                palette[k] = ((8 - k) * a0 + (k - 1) * a1 + 3) / 7;
+        }
+        else
+        {
+            for (int k = 2; k < 6; ++k)
+                palette[k] = ((6 - k) * a0 + (k - 1) * a1 + 2) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        Uint64 bits = 0;
+        for (int i = 0; i < 6; ++i)
+            bits |= (Uint64)in[2 + i] << (8 * i);
+        for (int i = 0; i < 16; ++i)
+            values[i] = (Uint8)palette[bits >> (3 * i) & 7];
+    }
+
+    //Only mode 6 is decoded, the only mode the encoder writes; other modes come back black
+    void decodeMode6(const Uint8* in, Uint8 texels[16][4])
+    {
+        BitReader reader = { in };
+        if (reader.read(7) != 1 << 6)
+        {
+            memset(texels, 0, 16 * 4);
+            return;
+        }
+
+        int q[2][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            q[0][c] = (int)reader.read(7);
+            q[1][c] = (int)reader.read(7);
+        }
+        int p0 = (int)reader.read(1), p1 = (int)reader.read(1);
+        for (int i = 0; i < 16; ++i)
+        {
+            int index = (int)reader.read(i == 0 ? 3 : 4);
+            for (int c = 0; c < 4; ++c)
+            {
+                int e0 = q[0][c] << 1 | p0, e1 = q[1][c] << 1 | p1;
+                texels[i][c] = (Uint8)(((64 - kMode6Weights[index]) * e0 + kMode6Weights[index] * e1 + 32) >> 6);
+            }
+        }
+    }
+
+    void decodeBlock(BlockFormat format, const Uint8* in, Uint8 texels[16][4])
+    {
+        Uint8 values[16];
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            decodeColour(in, false, texels);
+            break;
+        case BlockFormat::BC3:
+            decodeColour(in + 8, true, texels);
+            decodeChannel(in, values);
+            for (int i = 0; i < 16; ++i)
+                texels[i][3] = values[i];
+            break;
+        case BlockFormat::BC5:
+            decodeChannel(in, values);
+            for (int i = 0; i < 16; ++i)
+            {
+                texels[i][0] = values[i];
+                texels[i][2] = 0;
+                texels[i][3] = 255;
+            }
+            decodeChannel(in + 8, values);
+            for (int i = 0; i < 16; ++i)
+                texels[i][1] = values[i];
+            break;
+        case BlockFormat::BC7:
+            decodeMode6(in, texels);
+            break;
+        }
+    }
+}
+
+size_t BlockChain::levelSize(size_t index) const
+{
+    return blockImageSize(format, levels[index].width, levels[index].height);
+}
+
+size_t blockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t blockImageSize(BlockFormat format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+}
+
+const char* blockFormatName(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        return "bc1";
+    case BlockFormat::BC3:
+        return "bc3";
+    case BlockFormat::BC5:
+        return "bc5";
+    default:
+        return "bc7";
+    }
+}
+
+bool parseBlockFormat(const char* name, BlockFormat& format)
+{
+    for (BlockFormat candidate : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 })
+    {
+        if (strcmp(name, blockFormatName(candidate)) == 0)
+        {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+BlockFormat chooseBlockFormat(const Uint8* pixels, size_t texelCount)
+{
+    for (size_t i = 0; i < texelCount; ++i)
+    {
+        if (pixels[i * 4 + 3] != 255)
+            return BlockFormat::BC3;
+    }
+    return BlockFormat::BC1;
+}
+
+void compressImage(const Uint8* pixels, int width, int height, const BlockOptions& options, Uint8* out)
+{
+    PROFILE_ZONE("compressImage");
+    const int blocksWide = (width + 3) / 4;
+    const int blocksHigh = (height + 3) / 4;
+    const size_t rowBytes = (size_t)blocksWide * blockSize(options.format);
+
+    auto compressRows = [&](int first, int last)
+    {
+        BlockTexels block;
+        for (int by = first; by < last; ++by)
+        {
+            Uint8* row = out + rowBytes * by;
+            for (int bx = 0; bx < blocksWide; ++bx)
+            {
+                gatherBlock(pixels, width, height, bx, by, block);
+                compressBlock(block, options, row + bx * blockSize(options.format));
+            }
+        }
+    };
+
+    // Contiguous bands of block rows, the calling thread takes the first
+    int threads = options.threads > 0 ? options.threads : SDL_GetNumLogicalCPUCores();
+    threads = std::clamp(threads, 1, std::max(1, blocksHigh));
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.emplace_back(compressRows, blocksHigh * t / threads, blocksHigh * (t + 1) / threads);
+    compressRows(0, blocksHigh / threads);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void compressMipChain(const MipChain& mips, const BlockOptions& options, BlockChain& chain)
+{
+    chain.format = options.format;
+    chain.levels.clear();
+    size_t total = 0;
+    for (const MipLevel& source : mips.levels)
+    {
+        MipLevel level = source;
+        level.offset = total;
+        chain.levels.push_back(level);
+        total += blockImageSize(options.format, level.width, level.height);
+    }
+
+    chain.blocks.resize(total);
+    for (size_t i = 0; i < chain.levels.size(); ++i)
+        compressImage(mips.level(i), chain.levels[i].width, chain.levels[i].height, options, chain.blocks.data() + chain.levels[i].offset);
+}
+
+void decompressImage(BlockFormat format, const Uint8* blocks, int width, int height, Uint8* pixels)
+{
+    const int blocksWide = (width + 3) / 4;
+    const int blocksHigh = (height + 3) / 4;
+    Uint8 texels[16][4];
+    for (int by = 0; by < blocksHigh; ++by)
+    {
+        for (int bx = 0; bx < blocksWide; ++bx, blocks += blockSize(format))
+        {
+            decodeBlock(format, blocks, texels);
+            for (int y = 0; y < 4 && by * 4 + y < height; ++y)
+            {
+                for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+                    memcpy(pixels + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+            }
+        }
+    }
+}
+
+void decompressBlockChain(const BlockChain& chain, MipChain& mips)
+{
+    mips.levels.clear();
+    size_t total = 0;
+    for (const MipLevel& source : chain.levels)
+    {
+        MipLevel level = source;
+        level.offset = total;
+        mips.levels.push_back(level);
+        total += (size_t)level.width * level.height * 4;
+    }
+
+    mips.pixels.resize(total);
+    for (size_t i = 0; i < chain.levels.size(); ++i)
+        decompressImage(chain.format, chain.level(i), chain.levels[i].width, chain.levels[i].height, mips.pixels.data() + mips.levels[i].offset);
+}
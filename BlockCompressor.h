@@ -0,0 +1,85 @@
+#pragma once
+#include "MipGenerator.h"
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <vector>
+
+enum class BlockFormat : Uint32
+{
+    //RGB at 4 bits per texel, alpha is dropped
+    BC1,
+
+    //BC1 colour plus interpolated alpha, 8 bits per texel
+    BC3,
+
+    //Red and green as two independent channels at 8 bits per texel, for normal maps
+    BC5,
+
+    //RGBA at 8 bits per texel with finer interpolation than BC3, encoded in mode 6
+    BC7
+};
+
+enum class BlockQuality
+{
+    //Bounding-box endpoints and indices projected onto the endpoint axis, SSE2 where available
+    Fast,
+
+    //Principal-axis endpoints refined by least squares, every texel matched to its nearest palette entry
+    High
+};
+
+struct BlockOptions
+{
+    BlockFormat format = BlockFormat::BC1;
+    BlockQuality quality = BlockQuality::Fast;
+
+    //Block rows are split across this many threads, 0 uses one per core
+    int threads = 0;
+};
+
+//Every level of a block-compressed image, level 0 first, offsets into blocks
+struct BlockChain
+{
+    BlockFormat format = BlockFormat::BC1;
+    std::vector<MipLevel> levels;
+    std::vector<Uint8> blocks;
+
+    const Uint8* level(size_t index) const { return blocks.data() + levels[index].offset; }
+    size_t levelSize(size_t index) const;
+};
+
+//Bytes per 4x4 block
+size_t blockSize(BlockFormat format);
+
+//Bytes of a width x height image, partial blocks at the edges count as whole ones
+size_t blockImageSize(BlockFormat format, int width, int height);
+
+const char* blockFormatName(BlockFormat format);
+bool parseBlockFormat(const char* name, BlockFormat& format);
+
+//BC1 when every texel is opaque, BC3 otherwise
+BlockFormat chooseBlockFormat(const Uint8* pixels, size_t texelCount);
+
+/**
+ * Block compression for textures, run offline by --compress-textures or on
+ * TextureManager's workers.
+ *
+ * Each 4x4 block is encoded on its own: two endpoints and an index per
+ * texel into the palette interpolated between them. Fast quality takes the
+ * endpoints from the block's bounding box, along the diagonal that follows
+ * the channels falling as well as rising, and projects every texel onto
+ * the line between them; High quality fits the line to the block's
+ * principal axis, picks each texel's nearest palette entry and refits the
+ * endpoints by least squares. BC7 only uses mode 6 (one subset, RGBA
+ * endpoints, 4-bit indices). Texels past the image edge repeat the last
+ * row or column.
+ */
+void compressImage(const Uint8* pixels, int width, int height, const BlockOptions& options, Uint8* out);
+
+//Compresses every level of a mip chain
+void compressMipChain(const MipChain& mips, const BlockOptions& options, BlockChain& chain);
+
+//Expands blocks back to RGBA8, BC5 comes back as (r, g, 0, 255)
+void decompressImage(BlockFormat format, const Uint8* blocks, int width, int height, Uint8* pixels);
+
+void decompressBlockChain(const BlockChain& chain, MipChain& mips);
@@ -0,0 +1,185 @@
+#include "BenchmarkCommon.h"
+#include "MappedFile.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace bench;
+
+namespace
+{
+    //Touches every byte so each reader pays for actually delivering the data
+    Uint64 checksum(const Uint8* data, size_t size)
+    {
+        Uint64 sum = 0;
+        size_t words = size / sizeof(Uint64);
+        for (size_t i = 0; i < words; ++i)
+        {
+            Uint64 word;
+            memcpy(&word, data + i * sizeof(Uint64), sizeof(word));
+            sum += word;
+        }
+        for (size_t i = words * sizeof(Uint64); i < size; ++i)
+            sum += data[i];
+        return sum;
+    }
+
+    //The old readShaderSource(): ifstream into a stringstream, a std::string, then a new[] copy
+    Uint64 readStream(const char* path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string content = buffer.str();
+
+        char* result = new char[content.size() + 1];
+        std::copy(content.begin(), content.end(), result);
+        result[content.size()] = '\0';
+
+        Uint64 sum = checksum((const Uint8*)result, content.size());
+        delete[] result;
+        return sum;
+    }
+
+    //The old read_file_to_string(): fseek/ftell, malloc and one fread
+    Uint64 readWhole(const char* path)
+    {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+            return 0;
+
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        rewind(file);
+
+        char* buffer = (char*)malloc(length + 1);
+        size_t read = fread(buffer, 1, length, file);
+        buffer[read] = '\0';
+        fclose(file);
+
+        Uint64 sum = checksum((const Uint8*)buffer, read);
+        free(buffer);
+        return sum;
+    }
+
+    Uint64 readMapped(const char* path)
+    {
+        MappedFile file;
+        if (!file.open(path))
+            return 0;
+        return checksum(file.data(), file.size());
+    }
+
+    bool writeTestFile(const char* path, size_t size)
+    {
+        FILE* file = fopen(path, "wb");
+        if (!file)
+            return false;
+
+        std::vector<Uint8> block(1 << 20);
+        Uint32 state = 0x12345678u;
+        for (Uint8& byte : block)
+        {
+            state = state * 1664525u + 1013904223u;
+            byte = (Uint8)(state >> 24);
+        }
+
+        bool ok = true;
+        for (size_t written = 0; written < size && ok; written += block.size())
+        {
+            size_t count = std::min(block.size(), size - written);
+            ok = fwrite(block.data(), 1, count, file) == count;
+        }
+        return fclose(file) == 0 && ok;
+    }
+}
+
+int runFileIOBenchmark(int argc, char* args[])
+{
+    const char* outPath = findArg(argc, args, "--out");
+    const char* inputPath = findArg(argc, args, "--file");
+    const int runs = std::max(1, intArg(argc, args, "--runs", 10));
+    const size_t sizeMb = (size_t)std::max(1, intArg(argc, args, "--size", 256));
+
+    // Without --file a generated asset-sized file is read, removed afterwards
+    const char* path = inputPath ? inputPath : "bench_io.tmp";
+    if (!inputPath && !writeTestFile(path, sizeMb << 20))
+    {
+        SDL_Log("Unable to write benchmark file %s\n", path);
+        return 1;
+    }
+
+    MappedFile probe;
+    if (!probe.open(path))
+    {
+        SDL_Log("Unable to open benchmark file %s\n", path);
+        return 1;
+    }
+    const size_t fileSize = probe.size();
+    const bool mapped = probe.mapped();
+    probe.close();
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        return 1;
+    }
+
+    struct Reader
+    {
+        const char* name;
+        int copies;
+        Uint64 (*read)(const char* path);
+    };
+    const Reader readers[] = {
+        { "ifstream_stringstream_new", 3, readStream },
+        { "fread_malloc", 1, readWhole },
+        { "mapped_file", 0, readMapped },
+    };
+
+    // Page cache is warmed once so every reader starts from the same state
+    Uint64 expected = readWhole(path);
+
+    fprintf(out, "{\n  \"benchmark\": \"file_io\",\n  \"file\": ");
+    writeJsonString(out, path);
+    fprintf(out, ",\n  \"bytes\": %zu,\n  \"mapped\": %s,\n  \"runs\": %d,\n  \"results\": [\n", fileSize, mapped ? "true" : "false", runs);
+
+    int exitCode = 0;
+    for (size_t r = 0; r < sizeof(readers) / sizeof(readers[0]); ++r)
+    {
+        std::vector<double> samples;
+        bool match = true;
+        for (int run = 0; run < runs; ++run)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            Uint64 sum = readers[r].read(path);
+            samples.push_back(elapsedMs(start, SDL_GetPerformanceCounter()));
+            match = match && sum == expected;
+        }
+        if (!match)
+        {
+            SDL_Log("%s read different bytes than fread\n", readers[r].name);
+            exitCode = 1;
+        }
+
+        Stats stats = computeStats(samples);
+        fprintf(out, "    {\"reader\": \"%s\", \"copies\": %d, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"min_ms\": %.3f, \"mb_per_sec\": %.1f, \"match\": %s}%s\n",
+            readers[r].name, readers[r].copies, stats.mean, stats.p50, stats.min,
+            stats.p50 > 0.0 ? (double)fileSize / (1 << 20) / (stats.p50 / 1000.0) : 0.0,
+            match ? "true" : "false",
+            r + 1 < sizeof(readers) / sizeof(readers[0]) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+
+    if (!inputPath)
+    {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+    return exitCode;
+}
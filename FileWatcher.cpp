@@ -0,0 +1,170 @@
+#include "FileWatcher.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <filesystem>
+#include <map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    bool readFile(const std::string& path, std::string& contents)
+    {
+        // One copy out of the mapping, the contents outlive it on the main thread
+        MappedFile file;
+        if (!file.open(path.c_str()))
+            return false;
+
+        contents.assign(file.text());
+        return true;
+    }
+
+    std::string normalizedPath(const std::filesystem::path& path)
+    {
+        return path.lexically_normal().generic_string();
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool FileWatcher::start(const std::vector<std::string>& paths)
+{
+    stop();
+    mPaths = paths;
+
+#ifdef __linux__
+    mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mInotifyFd < 0)
+        SDL_Log("inotify unavailable, polling shader modification times instead.\n");
+#endif
+
+    mRunning = true;
+    mThread = std::thread(&FileWatcher::run, this);
+    return true;
+}
+
+void FileWatcher::stop()
+{
+    mRunning = false;
+    if (mThread.joinable())
+        mThread.join();
+
+#ifdef __linux__
+    if (mInotifyFd >= 0)
+        close(mInotifyFd);
+#endif
+    mInotifyFd = -1;
+}
+
+std::vector<FileChange> FileWatcher::takeChanges()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<FileChange> changes;
+    changes.swap(mChanges);
+    return changes;
+}
+
+void FileWatcher::publish(const std::string& path)
+{
+    PROFILE_ZONE("FileWatcher::publish");
+
+    FileChange change;
+    change.path = path;
+
+    // A file caught mid-save shows up again with its final contents
+    if (!readFile(path, change.contents))
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (FileChange& pending : mChanges)
+    {
+        if (pending.path == path)
+        {
+            pending.contents.swap(change.contents);
+            return;
+        }
+    }
+    mChanges.push_back(std::move(change));
+}
+
+void FileWatcher::run()
+{
+    profilerSetThreadName("FileWatcher");
+
+#ifdef __linux__
+    if (mInotifyFd >= 0)
+    {
+        // One watch per directory, events carry the file name
+        std::map<int, std::filesystem::path> directories;
+        for (const std::string& path : mPaths)
+        {
+            std::filesystem::path directory = std::filesystem::path(path).parent_path();
+            if (directory.empty())
+                directory = ".";
+
+            int wd = inotify_add_watch(mInotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd >= 0)
+                directories[wd] = directory;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        while (mRunning)
+        {
+            pollfd descriptor = { mInotifyFd, POLLIN, 0 };
+            if (poll(&descriptor, 1, 100) <= 0)
+                continue;
+
+            ssize_t length = read(mInotifyFd, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const inotify_event* event = (const inotify_event*)(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                auto directory = directories.find(event->wd);
+                if (event->len == 0 || directory == directories.end())
+                    continue;
+
+                std::string changed = normalizedPath(directory->second / event->name);
+                for (const std::string& path : mPaths)
+                {
+                    if (normalizedPath(path) == changed)
+                        publish(path);
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    // Modification time polling
+    std::vector<std::filesystem::file_time_type> times(mPaths.size());
+    for (size_t i = 0; i < mPaths.size(); ++i)
+    {
+        std::error_code error;
+        times[i] = std::filesystem::last_write_time(mPaths[i], error);
+    }
+
+    while (mRunning)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        for (size_t i = 0; i < mPaths.size(); ++i)
+        {
+            std::error_code error;
+            std::filesystem::file_time_type time = std::filesystem::last_write_time(mPaths[i], error);
+            if (!error && time != times[i])
+            {
+                times[i] = time;
+                publish(mPaths[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A watched file that changed, contents are read on the watcher thread
+struct FileChange
+{
+    std::string path;
+    std::string contents;
+};
+
+/**
+ * Watches a fixed set of files from a background thread.
+ *
+ * On Linux the thread blocks on inotify, watching the parent directories
+ * so editors that save by renaming a temporary file are caught too.
+ * Elsewhere it polls modification times four times a second. Changed files
+ * are read on the watcher thread and handed out by takeChanges(); several
+ * saves between two calls collapse into the latest contents.
+ */
+class FileWatcher
+{
+public:
+    ~FileWatcher();
+
+    bool start(const std::vector<std::string>& paths);
+    void stop();
+
+    bool running() const { return mThread.joinable(); }
+    bool usesInotify() const { return mInotifyFd >= 0; }
+
+    //Changes since the last call, safe to call every frame
+    std::vector<FileChange> takeChanges();
+
+private:
+    void run();
+    void publish(const std::string& path);
+
+    std::vector<std::string> mPaths;
+    std::thread mThread;
+    std::atomic<bool> mRunning = false;
+    int mInotifyFd = -1;
+
+    std::mutex mMutex;
+    std::vector<FileChange> mChanges;
+};
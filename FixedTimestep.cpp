@@ -0,0 +1,28 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+#include <cmath>
+
+void FixedTimestep::setTickRate(double ticksPerSecond, int maxTicksPerFrame)
+{
+    mTickNs = (Uint64)std::max(1.0, std::round(1e9 / std::max(ticksPerSecond, 1e-3)));
+    mMaxTicksPerFrame = std::max(1, maxTicksPerFrame);
+    mAccumulatorNs = 0;
+    mTicks = 0;
+    mDroppedTicks = 0;
+}
+
+int FixedTimestep::advance(Uint64 elapsedNs)
+{
+    mAccumulatorNs += elapsedNs;
+    Uint64 due = mAccumulatorNs / mTickNs;
+
+    // Time that cannot be caught up is dropped whole ticks at a time, alpha keeps its fraction
+    if (due > (Uint64)mMaxTicksPerFrame)
+    {
+        mDroppedTicks += due - mMaxTicksPerFrame;
+        due = mMaxTicksPerFrame;
+    }
+    mAccumulatorNs = mAccumulatorNs % mTickNs;
+    mTicks += due;
+    return (int)due;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <SDL3/SDL.h>
+
+/**
+ * Fixed-rate simulation clock.
+ *
+ * Real time goes into an accumulator in integer nanoseconds and comes out
+ * as whole ticks of 1/tickRate seconds, so the simulation always steps by
+ * the same amount whatever the frame rate and never drifts. What is left
+ * over is alpha(), how far the rendered frame lies between the last two
+ * ticks. A frame that would owe more than maxTicksPerFrame ticks (after a
+ * hitch, or when ticks cost more than they cover) drops the excess instead
+ * of spiralling into ever longer frames.
+ */
+class FixedTimestep
+{
+public:
+    void setTickRate(double ticksPerSecond, int maxTicksPerFrame = 8);
+
+    //Adds real time and returns the number of ticks to simulate now
+    int advance(Uint64 elapsedNs);
+
+    //Fraction of a tick accumulated since the last one, in [0, 1)
+    float alpha() const { return (float)((double)mAccumulatorNs / (double)mTickNs); }
+
+    float tickSeconds() const { return (float)((double)mTickNs / 1e9); }
+    Uint64 tickNs() const { return mTickNs; }
+
+    //Ticks handed out and ticks dropped by the clamp since setTickRate
+    Uint64 ticks() const { return mTicks; }
+    Uint64 droppedTicks() const { return mDroppedTicks; }
+
+private:
+    Uint64 mTickNs = 16666667;
+    Uint64 mAccumulatorNs = 0;
+    int mMaxTicksPerFrame = 8;
+    Uint64 mTicks = 0;
+    Uint64 mDroppedTicks = 0;
+};
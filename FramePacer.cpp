@@ -0,0 +1,134 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cstring>
+
+const char* pacingModeName(PacingMode mode)
+{
+    switch (mode)
+    {
+    case PacingMode::Limit:
+        return "limit";
+    case PacingMode::JustInTime:
+        return "jit";
+    default:
+        return "off";
+    }
+}
+
+bool parsePacingMode(const char* name, PacingMode& mode)
+{
+    if (!name)
+        return false;
+    if (strcmp(name, "off") == 0)
+        mode = PacingMode::Off;
+    else if (strcmp(name, "limit") == 0)
+        mode = PacingMode::Limit;
+    else if (strcmp(name, "jit") == 0)
+        mode = PacingMode::JustInTime;
+    else
+        return false;
+    return true;
+}
+
+void FramePacer::configure(PacingMode mode, double frameRate, bool vsync, double marginMs)
+{
+    mMode = mode;
+    mVsync = vsync;
+    mFrequency = SDL_GetPerformanceFrequency();
+    mPeriod = frameRate > 0.0 ? (Uint64)((double)mFrequency / frameRate + 0.5) : 0;
+    mMargin = (Uint64)(std::max(marginMs, 0.0) * (double)mFrequency / 1000.0);
+    mSpinWindow = mFrequency / 1000;
+
+    mFrameStart = 0;
+    mDeadline = 0;
+    mLastPresent = 0;
+    mWorkCount = 0;
+    mWorkNext = 0;
+    mStats = FramePacingStats();
+}
+
+Uint64 FramePacer::waitForFrame()
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (mPeriod == 0)
+    {
+        mDeadline = 0;
+        mFrameStart = now;
+        return now;
+    }
+
+    // Presents land on vblanks with vsync, so the next one is due a period after the last; the limiter keeps its own cadence
+    Uint64 base = mVsync && mMode != PacingMode::Limit && mLastPresent != 0 ? mLastPresent : mDeadline;
+    Uint64 deadline = base != 0 ? base + mPeriod : now + mPeriod;
+
+    // A frame that fell behind gives up the deadlines already passed, in whole periods to keep the phase
+    if (deadline <= now)
+        deadline += ((now - deadline) / mPeriod + 1) * mPeriod;
+
+    Uint64 start = now;
+    if (mMode == PacingMode::Limit)
+        start = deadline - mPeriod;
+    else if (mMode == PacingMode::JustInTime)
+        start = deadline - std::min(workEstimate() + mMargin, mPeriod);
+    if (start > now)
+        sleepUntil(start);
+
+    mDeadline = deadline;
+    mFrameStart = SDL_GetPerformanceCounter();
+    return mFrameStart;
+}
+
+void FramePacer::endFrame(Uint64 submitted, Uint64 presented)
+{
+    mWork[mWorkNext] = submitted > mFrameStart ? submitted - mFrameStart : 0;
+    mWorkNext = (mWorkNext + 1) % kWorkSamples;
+    mWorkCount = std::min(mWorkCount + 1, (int)kWorkSamples);
+    mLastPresent = presented;
+
+    double latencyMs = presented > mFrameStart ? (double)(presented - mFrameStart) * 1000.0 / (double)mFrequency : 0.0;
+    mStats.frames++;
+    mStats.lastLatencyMs = latencyMs;
+    mStats.totalLatencyMs += latencyMs;
+
+    // With vsync a present within half a period of the vblank made it, later ones waited for the next
+    Uint64 tolerance = mVsync ? mPeriod / 2 : 0;
+    if (mDeadline != 0 && presented > mDeadline + tolerance)
+        mStats.missedDeadlines++;
+}
+
+void FramePacer::sleepUntil(Uint64 target)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // Sleep up to the spin window before the target, then spin out the rest
+    if (target > now + mSpinWindow)
+    {
+        Uint64 sleepTicks = target - mSpinWindow - now;
+        SDL_DelayNS(sleepTicks * 1000000000ull / mFrequency);
+        Uint64 woke = SDL_GetPerformanceCounter();
+        Uint64 oversleep = woke - now > sleepTicks ? woke - now - sleepTicks : 0;
+        mStats.sleepMs += (double)(woke - now) * 1000.0 / (double)mFrequency;
+        mStats.maxOversleepMs = std::max(mStats.maxOversleepMs, (double)oversleep * 1000.0 / (double)mFrequency);
+
+        // The window follows the worst recent overrun up at once and back down slowly
+        mSpinWindow = std::max(oversleep + oversleep / 4, mSpinWindow - mSpinWindow / 16);
+        mSpinWindow = std::clamp(mSpinWindow, mFrequency / 4000, mFrequency / 250);
+        now = woke;
+    }
+
+    Uint64 spinStart = now;
+    while (now < target)
+    {
+        SDL_CPUPauseInstruction();
+        now = SDL_GetPerformanceCounter();
+    }
+    mStats.spinMs += (double)(now - spinStart) * 1000.0 / (double)mFrequency;
+}
+
+Uint64 FramePacer::workEstimate() const
+{
+    Uint64 longest = 0;
+    for (int i = 0; i < mWorkCount; ++i)
+        longest = std::max(longest, mWork[i]);
+    return longest;
+}
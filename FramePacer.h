@@ -0,0 +1,94 @@
+#pragma once
+#include <SDL3/SDL.h>
+
+//How the main loop paces frames on top of the swap interval
+enum class PacingMode
+{
+    //Frames start as soon as the last one is presented, vsync alone paces them
+    Off,
+
+    //Frames start at a fixed rate, sleeping and then spinning until their slot
+    Limit,
+
+    //Frames start as late as they can and still be presented by the deadline, so input is sampled just before the swap
+    JustInTime
+};
+
+//Name used on the command line and in benchmark output, and back; false for an unknown name
+const char* pacingModeName(PacingMode mode);
+bool parsePacingMode(const char* name, PacingMode& mode);
+
+//Pacing telemetry since FramePacer::configure()
+struct FramePacingStats
+{
+    Uint64 frames = 0;
+
+    //Frames presented after their deadline
+    Uint64 missedDeadlines = 0;
+
+    //Time from the start of a frame, where input is sampled, to its present: the last frame and all of them
+    double lastLatencyMs = 0.0;
+    double totalLatencyMs = 0.0;
+
+    //Time waitForFrame() slept and spun, and the furthest a sleep overran
+    double sleepMs = 0.0;
+    double spinMs = 0.0;
+    double maxOversleepMs = 0.0;
+};
+
+/**
+ * Decides when the main loop starts its next frame.
+ *
+ * Every frame gets a deadline, the time it should be presented by. With
+ * vsync the deadlines are the vblanks after the last present, otherwise
+ * they follow one another at the frame rate. Limit starts a frame one
+ * period before its deadline; JustInTime starts it the slowest recent
+ * frame plus a margin before, which leaves the least time between sampling
+ * input and showing the result. Waits sleep for most of the time and spin
+ * the rest, the spin window tracking how late the OS wakes the thread.
+ */
+class FramePacer
+{
+public:
+    //frameRate is the refresh rate or the limiter target, 0 leaves frames without deadlines
+    void configure(PacingMode mode, double frameRate, bool vsync, double marginMs = 2.0);
+
+    //Blocks until the next frame may start, returns its start in SDL_GetPerformanceCounter ticks
+    Uint64 waitForFrame();
+
+    //The frame waitForFrame() started finished submitting and was presented, both in SDL_GetPerformanceCounter ticks
+    void endFrame(Uint64 submitted, Uint64 presented);
+
+    PacingMode mode() const { return mMode; }
+    double frameRate() const { return mPeriod ? (double)mFrequency / (double)mPeriod : 0.0; }
+
+    //Present time the current frame aims for, 0 without deadlines
+    Uint64 deadline() const { return mDeadline; }
+
+    const FramePacingStats& stats() const { return mStats; }
+
+private:
+    enum { kWorkSamples = 32 };
+
+    void sleepUntil(Uint64 target);
+
+    //Longest frame among the recent ones, from start to submission
+    Uint64 workEstimate() const;
+
+    PacingMode mMode = PacingMode::Off;
+    bool mVsync = false;
+    Uint64 mFrequency = 1;
+    Uint64 mPeriod = 0;
+    Uint64 mMargin = 0;
+    Uint64 mSpinWindow = 0;
+
+    Uint64 mFrameStart = 0;
+    Uint64 mDeadline = 0;
+    Uint64 mLastPresent = 0;
+
+    Uint64 mWork[kWorkSamples] = {};
+    int mWorkCount = 0;
+    int mWorkNext = 0;
+
+    FramePacingStats mStats;
+};
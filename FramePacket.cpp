@@ -0,0 +1,109 @@
+#include "FramePacket.h"
+#include <algorithm>
+
+namespace
+{
+    // The lists let go of their storage before the arena reuses or frees it
+    void dropLists(FramePacket& packet)
+    {
+        packet.draws = std::pmr::vector<PacketDraw>(&packet.arena);
+        packet.gridModelViews = std::pmr::vector<Affine>(&packet.arena);
+        packet.gridUpdate = std::pmr::vector<Affine>(&packet.arena);
+    }
+}
+
+void FramePacket::reset()
+{
+    dropLists(*this);
+    arena.reset();
+}
+
+void FramePacket::release()
+{
+    dropLists(*this);
+    arena.reserve(0);
+}
+
+void FramePacketQueue::init(int packetCount)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPacketCount = std::clamp(packetCount, 1, (int)kMaxPackets);
+    mFree.clear();
+    mQueued.clear();
+    for (int i = mPacketCount - 1; i >= 0; --i)
+        mFree.push_back(&mPackets[i]);
+    mClosed = false;
+    mWriterWaitTicks = 0;
+}
+
+FramePacket* FramePacketQueue::beginWrite()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mFree.empty() && !mClosed)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        mChanged.wait(lock, [this] { return !mFree.empty() || mClosed; });
+        mWriterWaitTicks += SDL_GetPerformanceCounter() - start;
+    }
+    if (mClosed)
+        return nullptr;
+
+    FramePacket* packet = mFree.back();
+    mFree.pop_back();
+    return packet;
+}
+
+void FramePacketQueue::endWrite(FramePacket* packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueued.push_back(packet);
+    }
+    mChanged.notify_all();
+}
+
+FramePacket* FramePacketQueue::beginRead()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mChanged.wait(lock, [this] { return !mQueued.empty() || mClosed; });
+    if (mQueued.empty())
+        return nullptr;
+
+    FramePacket* packet = mQueued.front();
+    mQueued.erase(mQueued.begin());
+    return packet;
+}
+
+void FramePacketQueue::endRead(FramePacket* packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFree.push_back(packet);
+    }
+    mChanged.notify_all();
+}
+
+void FramePacketQueue::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+    }
+    mChanged.notify_all();
+}
+
+void FramePacketQueue::release()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (FramePacket& packet : mPackets)
+        packet.release();
+    std::vector<FramePacket*>().swap(mFree);
+    std::vector<FramePacket*>().swap(mQueued);
+    mClosed = true;
+}
+
+double FramePacketQueue::writerWaitMs() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return (double)mWriterWaitTicks * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
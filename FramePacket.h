@@ -0,0 +1,112 @@
+#pragma once
+#include "AffineMath.h"
+#include "LinearArena.h"
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+//Meshes a packet can draw, the render side maps them to vertex arrays and index ranges
+enum class PacketMesh : Uint8
+{
+    Cube,
+    Pyramid
+};
+
+//One object drawn with the rendering program
+struct PacketDraw
+{
+    PacketMesh mesh = PacketMesh::Cube;
+    Affine modelView;
+    glm::vec4 color = glm::vec4(1.0f);
+};
+
+/**
+ * Everything the render side needs to draw one simulated frame.
+ *
+ * update() fills a packet from the scene and render code only reads the
+ * packet, never the scene, so the next frame can be simulated while this
+ * one is submitted. The lists live in the packet's arena, which lasts
+ * exactly as long as the packet is in flight; reset() frees them together.
+ */
+struct FramePacket
+{
+    //Empties the lists and the arena, before the packet is filled again
+    void reset();
+
+    //Empties the lists and frees the arena's block
+    void release();
+
+    LinearArena arena;
+
+    Uint64 frame = 0;
+
+    //SDL_GetPerformanceCounter when update() started and when the newest input it saw arrived, 0 without input
+    Uint64 updateStart = 0;
+    Uint64 input = 0;
+
+    float timeFactor = 0.0f;
+    bool drawScene = true;
+    Affine view;
+
+    //Cube and pyramid of the scene mode
+    std::pmr::vector<PacketDraw> draws{ &arena };
+
+    //Per-object mode, the model-view of every grid cube
+    std::pmr::vector<Affine> gridModelViews{ &arena };
+
+    //Instanced mode, grid cubes drawn from the instance buffer
+    Sint32 gridInstances = 0;
+
+    //Grid world matrices from gridUpdateFirst on to copy into the instance buffer first
+    Uint32 gridUpdateFirst = 0;
+    std::pmr::vector<Affine> gridUpdate{ &arena };
+};
+
+/**
+ * Hands frame packets from the simulating thread to the rendering one.
+ *
+ * Packets cycle free -> written -> queued -> read -> free. The writer
+ * blocks while no packet is free, which bounds how far simulation runs
+ * ahead: with two packets one frame is submitted while the next is
+ * simulated, a third lets simulation absorb a slow frame. Packets are read
+ * in the order they were written. With one packet and a single thread
+ * this degenerates to update() then render().
+ */
+class FramePacketQueue
+{
+public:
+    enum { kMaxPackets = 3 };
+
+    void init(int packetCount);
+
+    //A free packet to fill, nullptr once closed
+    FramePacket* beginWrite();
+    void endWrite(FramePacket* packet);
+
+    //The oldest queued packet, nullptr once closed and drained
+    FramePacket* beginRead();
+    void endRead(FramePacket* packet);
+
+    //Wakes both sides, queued packets are still read
+    void close();
+
+    //Frees the storage of every packet once neither side uses the queue, init() again before reuse
+    void release();
+
+    //Milliseconds the writer spent blocked on a free packet
+    double writerWaitMs() const;
+
+private:
+    FramePacket mPackets[kMaxPackets];
+    int mPacketCount = 1;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mChanged;
+    std::vector<FramePacket*> mFree;
+    std::vector<FramePacket*> mQueued;
+    bool mClosed = false;
+    Uint64 mWriterWaitTicks = 0;
+};
@@ -0,0 +1,132 @@
+#include "FrameRingBuffer.h"
+#include "Profiler.h"
+#include <algorithm>
+
+bool FrameRingBuffer::create(GLsizeiptr frameSize, int frameCount, MemoryTag tag)
+{
+    destroy();
+    MemoryTagScope memoryTag(tag);
+
+    mFrameCount = std::clamp(frameCount, 1, (int)kMaxFrames);
+    mFrameSize = (frameSize + 255) & ~(GLsizeiptr)255;
+    const GLsizeiptr totalSize = mFrameSize * mFrameCount;
+
+    glGenBuffers(1, &mBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+
+    if (GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+        mMapped = (Uint8*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+        if (!mMapped)
+        {
+            SDL_Log("Persistent mapping failed, falling back to glBufferSubData\n");
+            glDeleteBuffers(1, &mBuffer);
+            glGenBuffers(1, &mBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+        }
+    }
+
+    if (!mMapped)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+        mStaging.resize(totalSize);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    trackGpuMemory(MemoryDomain::GpuBuffer, mBuffer, (Uint64)totalSize, tag, mMapped ? GL_MAP_PERSISTENT_BIT : GL_STREAM_DRAW);
+
+    mFrame = 0;
+    mHead = 0;
+    return glGetError() == GL_NO_ERROR;
+}
+
+void FrameRingBuffer::destroy()
+{
+    for (GLsync& fence : mFences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (mBuffer)
+    {
+        if (mMapped)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        untrackGpuMemory(MemoryDomain::GpuBuffer, mBuffer);
+        glDeleteBuffers(1, &mBuffer);
+    }
+
+    mBuffer = 0;
+    mMapped = nullptr;
+    std::vector<Uint8>().swap(mStaging);
+    mFrameCount = 0;
+    mFrameSize = 0;
+}
+
+void FrameRingBuffer::beginFrame()
+{
+    if (!mBuffer)
+        return;
+
+    mFrame = (mFrame + 1) % mFrameCount;
+    mHead = 0;
+
+    GLsync& fence = mFences[mFrame];
+    if (!fence)
+        return;
+
+    // Normally already signaled, the region was last used frameCount frames ago
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        PROFILE_ZONE("Wait ring fence");
+        mFenceWaits++;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void FrameRingBuffer::endFrame()
+{
+    if (!mBuffer)
+        return;
+
+    if (mFences[mFrame])
+        glDeleteSync(mFences[mFrame]);
+    mFences[mFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+RingAllocation FrameRingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    RingAllocation allocation;
+    GLsizeiptr start = (mHead + alignment - 1) & ~(alignment - 1);
+    if (!mBuffer || size <= 0 || start + size > mFrameSize)
+        return allocation;
+
+    mHead = start + size;
+    allocation.offset = mFrame * mFrameSize + start;
+    allocation.size = size;
+    allocation.data = mMapped ? mMapped + allocation.offset : mStaging.data() + allocation.offset;
+    return allocation;
+}
+
+void FrameRingBuffer::commit(const RingAllocation& allocation)
+{
+    if (mMapped || !allocation.data)
+        return;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
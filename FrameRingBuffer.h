@@ -0,0 +1,65 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include "MemoryTracker.h"
+#include <vector>
+
+//Space handed out by FrameRingBuffer::allocate, data is nullptr when the frame region is full
+struct RingAllocation
+{
+    void* data = nullptr;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+};
+
+/**
+ * Per-frame dynamic data in one GL buffer split into frameCount regions.
+ *
+ * Each frame bump-allocates from its own region and fences it in
+ * endFrame(); beginFrame() only waits when the GPU is still reading the
+ * region about to be reused, which with three regions it normally is not.
+ *
+ * With GL_ARB_buffer_storage the buffer is mapped once with
+ * GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT and allocations point
+ * straight into it. Without it allocations point into a CPU copy and
+ * commit() uploads them with glBufferSubData.
+ */
+class FrameRingBuffer
+{
+public:
+    enum { kMaxFrames = 4 };
+
+    //Needs a current GL context, frameSize is rounded up to 256 bytes; the buffer and its staging copy are charged to tag
+    bool create(GLsizeiptr frameSize, int frameCount = 3, MemoryTag tag = MemoryTag::Render);
+    void destroy();
+
+    //Waits for the GPU to release the next region and makes it current
+    void beginFrame();
+
+    //Fences everything submitted since beginFrame()
+    void endFrame();
+
+    //alignment must be a power of two
+    RingAllocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+
+    //Makes the written allocation visible to the GPU, a no-op for a persistent mapping
+    void commit(const RingAllocation& allocation);
+
+    GLuint buffer() const { return mBuffer; }
+    bool persistent() const { return mMapped != nullptr; }
+    GLsizeiptr frameSize() const { return mFrameSize; }
+
+    //Times beginFrame() had to block on a fence
+    Uint32 fenceWaits() const { return mFenceWaits; }
+
+private:
+    GLuint mBuffer = 0;
+    Uint8* mMapped = nullptr;
+    std::vector<Uint8> mStaging;
+    GLsync mFences[kMaxFrames] = {};
+    int mFrameCount = 0;
+    int mFrame = 0;
+    GLsizeiptr mFrameSize = 0;
+    GLsizeiptr mHead = 0;
+    Uint32 mFenceWaits = 0;
+};
@@ -0,0 +1,257 @@
+#include "GLStateCache.h"
+#include <cstring>
+
+GLStateCache gStateCache;
+
+void GLStateCache::invalidate()
+{
+    mProgram = kUnknown;
+    mVertexArray = kUnknown;
+    mArrayBuffer = kUnknown;
+    mElementBuffer = kUnknown;
+    mUniformBuffer = kUnknown;
+    mStorageBuffer = kUnknown;
+    mPixelUnpackBuffer = kUnknown;
+    std::unordered_map<Uint64, RangeBinding>().swap(mRanges);
+    mActiveTexture = kUnknown;
+    for (GLuint& texture : mTextures)
+        texture = kUnknown;
+
+    for (int& cap : mCaps)
+        cap = -1;
+    mDepthFunc = kUnknown;
+    mDepthMask = -1;
+    mBlendSrc = kUnknown;
+    mBlendDst = kUnknown;
+    mClearColorValid = false;
+
+    std::unordered_map<GLuint, std::vector<UniformShadow>>().swap(mUniforms);
+    mProgramUniforms = nullptr;
+}
+
+void GLStateCache::forgetProgram(GLuint program)
+{
+    mUniforms.erase(program);
+    if (mProgram == program)
+    {
+        mProgram = kUnknown;
+        mProgramUniforms = nullptr;
+    }
+}
+
+bool GLStateCache::changed(bool differs)
+{
+    if (differs)
+        mCounters.issued++;
+    else
+        mCounters.filtered++;
+    return differs;
+}
+
+GLuint* GLStateCache::bufferSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        return &mArrayBuffer;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return &mElementBuffer;
+    case GL_UNIFORM_BUFFER:
+        return &mUniformBuffer;
+    case GL_SHADER_STORAGE_BUFFER:
+        return &mStorageBuffer;
+    case GL_PIXEL_UNPACK_BUFFER:
+        return &mPixelUnpackBuffer;
+    default:
+        return nullptr;
+    }
+}
+
+int GLStateCache::capSlot(GLenum cap)
+{
+    switch (cap)
+    {
+    case GL_DEPTH_TEST:
+        return 0;
+    case GL_BLEND:
+        return 1;
+    case GL_CULL_FACE:
+        return 2;
+    case GL_SCISSOR_TEST:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (!changed(mProgram != program))
+        return;
+
+    glUseProgram(program);
+    mProgram = program;
+    mProgramUniforms = program != 0 ? &mUniforms[program] : nullptr;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (!changed(mVertexArray != vao))
+        return;
+
+    glBindVertexArray(vao);
+    mVertexArray = vao;
+
+    //The element buffer binding is part of the VAO
+    mElementBuffer = kUnknown;
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint* slot = bufferSlot(target);
+    if (!changed(!slot || *slot != buffer))
+        return;
+
+    glBindBuffer(target, buffer);
+    if (slot)
+        *slot = buffer;
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    RangeBinding& binding = mRanges[((Uint64)target << 32) | index];
+    if (!changed(binding.buffer != buffer || binding.offset != offset || binding.size != size))
+        return;
+
+    glBindBufferRange(target, index, buffer, offset, size);
+    binding.buffer = buffer;
+    binding.offset = offset;
+    binding.size = size;
+
+    //Binding a range also binds the generic target
+    if (GLuint* slot = bufferSlot(target))
+        *slot = buffer;
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    // Only 2D textures are bound so far, the shadow does not track the target per unit
+    if (!changed(unit >= kTextureUnits || mTextures[unit] != texture))
+        return;
+
+    if (mActiveTexture != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        mActiveTexture = unit;
+    }
+    glBindTexture(target, texture);
+    if (unit < kTextureUnits)
+        mTextures[unit] = texture;
+}
+
+void GLStateCache::forgetTexture(GLuint texture)
+{
+    for (GLuint& bound : mTextures)
+    {
+        if (bound == texture)
+            bound = kUnknown;
+    }
+}
+
+void GLStateCache::enable(GLenum cap)
+{
+    int slot = capSlot(cap);
+    if (!changed(slot < 0 || mCaps[slot] != 1))
+        return;
+
+    glEnable(cap);
+    if (slot >= 0)
+        mCaps[slot] = 1;
+}
+
+void GLStateCache::disable(GLenum cap)
+{
+    int slot = capSlot(cap);
+    if (!changed(slot < 0 || mCaps[slot] != 0))
+        return;
+
+    glDisable(cap);
+    if (slot >= 0)
+        mCaps[slot] = 0;
+}
+
+void GLStateCache::depthFunc(GLenum func)
+{
+    if (!changed(mDepthFunc != func))
+        return;
+
+    glDepthFunc(func);
+    mDepthFunc = func;
+}
+
+void GLStateCache::depthMask(GLboolean mask)
+{
+    if (!changed(mDepthMask != (int)mask))
+        return;
+
+    glDepthMask(mask);
+    mDepthMask = mask;
+}
+
+void GLStateCache::blendFunc(GLenum sfactor, GLenum dfactor)
+{
+    if (!changed(mBlendSrc != sfactor || mBlendDst != dfactor))
+        return;
+
+    glBlendFunc(sfactor, dfactor);
+    mBlendSrc = sfactor;
+    mBlendDst = dfactor;
+}
+
+void GLStateCache::clearColor(float r, float g, float b, float a)
+{
+    const float color[4] = { r, g, b, a };
+    if (!changed(!mClearColorValid || memcmp(mClearColor, color, sizeof(color)) != 0))
+        return;
+
+    glClearColor(r, g, b, a);
+    memcpy(mClearColor, color, sizeof(color));
+    mClearColorValid = true;
+}
+
+bool GLStateCache::uniformChanged(GLint location, GLenum type, const float* value, int count)
+{
+    //Without a known program there is nothing to compare against
+    if (!mProgramUniforms)
+        return changed(true);
+
+    if ((size_t)location >= mProgramUniforms->size())
+        mProgramUniforms->resize(location + 1);
+
+    UniformShadow& shadow = (*mProgramUniforms)[location];
+    if (!changed(shadow.type != type || memcmp(shadow.value, value, sizeof(float) * count) != 0))
+        return false;
+
+    shadow.type = type;
+    memcpy(shadow.value, value, sizeof(float) * count);
+    return true;
+}
+
+void GLStateCache::uniform1f(GLint location, float value)
+{
+    if (location >= 0 && uniformChanged(location, GL_FLOAT, &value, 1))
+        glUniform1f(location, value);
+}
+
+void GLStateCache::uniform4f(GLint location, float x, float y, float z, float w)
+{
+    const float value[4] = { x, y, z, w };
+    if (location >= 0 && uniformChanged(location, GL_FLOAT_VEC4, value, 4))
+        glUniform4f(location, x, y, z, w);
+}
+
+void GLStateCache::uniformMatrix4fv(GLint location, const float* value)
+{
+    if (location >= 0 && uniformChanged(location, GL_FLOAT_MAT4, value, 16))
+        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <GL/glew.h>
+#include <SDL3/SDL.h>
+#include <unordered_map>
+#include <vector>
+
+//Calls forwarded to GL and calls dropped because the state already matched
+struct GLStateCounters
+{
+    Uint32 issued = 0;
+    Uint32 filtered = 0;
+};
+
+/**
+ * Shadow copy of the GL state the renderer touches.
+ *
+ * Every setter compares against the last value it sent and only calls GL
+ * when the state actually changes. Uniform values are shadowed per program
+ * and location. Anything that changes GL state behind the cache's back must
+ * call invalidate() afterwards.
+ */
+class GLStateCache
+{
+public:
+    //Forgets every shadowed value and frees what held them, the next call of each setter reaches GL
+    void invalidate();
+
+    //Drops the uniform shadow of a program that was deleted or relinked
+    void forgetProgram(GLuint program);
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    //Binds through glActiveTexture, units past kTextureUnits are not shadowed
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    //Drops a deleted texture from the shadowed bindings so a reused name is bound again
+    void forgetTexture(GLuint texture);
+
+    void enable(GLenum cap);
+    void disable(GLenum cap);
+    void depthFunc(GLenum func);
+    void depthMask(GLboolean mask);
+    void blendFunc(GLenum sfactor, GLenum dfactor);
+    void clearColor(float r, float g, float b, float a);
+
+    //Uniform setters apply to the current program like their GL counterparts
+    void uniform1f(GLint location, float value);
+    void uniform4f(GLint location, float x, float y, float z, float w);
+    void uniformMatrix4fv(GLint location, const float* value);
+
+    //Counters since the last resetCounters()
+    const GLStateCounters& counters() const { return mCounters; }
+    void resetCounters() { mCounters = GLStateCounters(); }
+
+private:
+    enum { kUnknown = 0xFFFFFFFFu };
+    enum { kTextureUnits = 8 };
+
+    struct UniformShadow
+    {
+        GLenum type = 0;
+        float value[16];
+    };
+
+    struct RangeBinding
+    {
+        GLuint buffer = kUnknown;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    bool changed(bool differs);
+    GLuint* bufferSlot(GLenum target);
+    int capSlot(GLenum cap);
+    bool uniformChanged(GLint location, GLenum type, const float* value, int count);
+
+    GLuint mProgram = kUnknown;
+    GLuint mVertexArray = kUnknown;
+    GLuint mArrayBuffer = kUnknown;
+    GLuint mElementBuffer = kUnknown;
+    GLuint mUniformBuffer = kUnknown;
+    GLuint mStorageBuffer = kUnknown;
+    GLuint mPixelUnpackBuffer = kUnknown;
+    std::unordered_map<Uint64, RangeBinding> mRanges;
+    GLuint mActiveTexture = kUnknown;
+    GLuint mTextures[kTextureUnits] = {};
+
+    //-1 unknown, 0 disabled, 1 enabled
+    int mCaps[4] = { -1, -1, -1, -1 };
+    GLenum mDepthFunc = kUnknown;
+    int mDepthMask = -1;
+    GLenum mBlendSrc = kUnknown;
+    GLenum mBlendDst = kUnknown;
+    float mClearColor[4];
+    bool mClearColorValid = false;
+
+    std::unordered_map<GLuint, std::vector<UniformShadow>> mUniforms;
+    std::vector<UniformShadow>* mProgramUniforms = nullptr;
+
+    GLStateCounters mCounters;
+};
+
+//The state cache of the main GL context
+extern GLStateCache gStateCache;
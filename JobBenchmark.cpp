@@ -0,0 +1,195 @@
+#include "BenchmarkCommon.h"
+#include "AffineMath.h"
+#include "JobSystem.h"
+#include "TransformStore.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+using namespace bench;
+
+namespace
+{
+    //Objects to transform and cull, SoA like TransformStore, plus the frustum they are tested against
+    struct CullScene
+    {
+        std::vector<float> values[9];
+        std::vector<Affine> world;
+        std::vector<Uint8> visible;
+        std::vector<Uint32> chunkVisible;
+        glm::vec4 planes[6];
+
+        TRSArrays arrays(size_t first) const
+        {
+            return { values[0].data() + first, values[1].data() + first, values[2].data() + first,
+                values[3].data() + first, values[4].data() + first, values[5].data() + first,
+                values[6].data() + first, values[7].data() + first, values[8].data() + first };
+        }
+    };
+
+    void makeScene(size_t count, CullScene& scene)
+    {
+        std::mt19937 rng(4321);
+        std::uniform_real_distribution<float> position(-300.0f, 300.0f);
+        std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+        std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+        for (std::vector<float>& v : scene.values)
+            v.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                scene.values[k][i] = position(rng);
+                scene.values[k + 3][i] = angle(rng);
+                scene.values[k + 6][i] = scale(rng);
+            }
+        }
+        scene.world.resize(count);
+        scene.visible.resize(count);
+        scene.chunkVisible.resize((count + kTransformGrain - 1) / kTransformGrain);
+
+        // Frustum planes of a camera at the origin looking down -z, pointing inwards
+        glm::mat4 m = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+        glm::vec4 rows[4];
+        for (int r = 0; r < 4; ++r)
+            rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+        for (int p = 0; p < 6; ++p)
+        {
+            glm::vec4 plane = (p & 1) ? rows[3] - rows[p / 2] : rows[3] + rows[p / 2];
+            scene.planes[p] = plane / glm::length(glm::vec3(plane));
+        }
+    }
+
+    void transformRange(void* data, size_t begin, size_t end)
+    {
+        CullScene& scene = *(CullScene*)data;
+        composeTRSBatch(scene.arrays(begin), scene.world.data() + begin, end - begin);
+    }
+
+    //Bounding sphere of a unit cube against every plane, one visible count per grain-sized chunk
+    void cullRange(void* data, size_t begin, size_t end)
+    {
+        CullScene& scene = *(CullScene*)data;
+        Uint32 visible = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Affine& w = scene.world[i];
+            glm::vec3 center(w.m[0][3], w.m[1][3], w.m[2][3]);
+            float radius = 0.8660254f * std::max(scene.values[6][i], std::max(scene.values[7][i], scene.values[8][i]));
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p)
+                inside = glm::dot(glm::vec3(scene.planes[p]), center) + scene.planes[p].w >= -radius;
+            scene.visible[i] = inside;
+            visible += inside;
+        }
+        scene.chunkVisible[begin / kTransformGrain] = visible;
+    }
+
+    //Transform jobs first, cull jobs held back on their counter, then the main thread helps until all are done
+    Uint32 runFrame(CullScene& scene)
+    {
+        const size_t count = scene.world.size();
+        JobCounter transformed, culled;
+        Job job;
+        job.data = &scene;
+        for (size_t begin = 0; begin < count; begin += kTransformGrain)
+        {
+            job.function = transformRange;
+            job.begin = begin;
+            job.end = std::min(count, begin + kTransformGrain);
+            gJobs.run(job, &transformed);
+        }
+        for (size_t begin = 0; begin < count; begin += kTransformGrain)
+        {
+            job.function = cullRange;
+            job.begin = begin;
+            job.end = std::min(count, begin + kTransformGrain);
+            gJobs.run(job, &culled, &transformed);
+        }
+        gJobs.wait(culled);
+
+        Uint32 visible = 0;
+        for (Uint32 v : scene.chunkVisible)
+            visible += v;
+        return visible;
+    }
+}
+
+int runJobBenchmark(int argc, char* args[])
+{
+    const size_t count = (size_t)std::max(1, intArg(argc, args, "--objects", 1000000));
+    const int maxThreads = std::clamp(intArg(argc, args, "--max-threads", 64), 1, (int)JobSystem::kMaxThreads);
+    const int runs = std::max(1, intArg(argc, args, "--runs", 20));
+    const char* outPath = findArg(argc, args, "--out");
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        return 1;
+    }
+
+    CullScene scene;
+    makeScene(count, scene);
+
+    // Plain loops without the job system are the reference for both time and output
+    std::vector<double> serialMs;
+    for (int run = 0; run < runs; ++run)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (size_t begin = 0; begin < count; begin += kTransformGrain)
+            transformRange(&scene, begin, std::min(count, begin + kTransformGrain));
+        for (size_t begin = 0; begin < count; begin += kTransformGrain)
+            cullRange(&scene, begin, std::min(count, begin + kTransformGrain));
+        serialMs.push_back(elapsedMs(start, SDL_GetPerformanceCounter()));
+    }
+    const std::vector<Affine> referenceWorld = scene.world;
+    const std::vector<Uint8> referenceVisible = scene.visible;
+    Uint32 referenceCount = 0;
+    for (Uint8 v : referenceVisible)
+        referenceCount += v;
+    const Stats serial = computeStats(serialMs);
+
+    fprintf(out, "{\n  \"benchmark\": \"jobs\",\n  \"objects\": %zu,\n  \"visible\": %u,\n  \"cores\": %d,\n  \"path\": \"%s\",\n",
+        count, referenceCount, SDL_GetNumLogicalCPUCores(), affineMathPath());
+    fprintf(out, "  \"serial_ms\": {\"min\": %.3f, \"mean\": %.3f},\n  \"results\": [\n", serial.min, serial.mean);
+
+    bool passed = true;
+    double oneThreadMs = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        gJobs.init(threads);
+        std::fill(scene.world.begin(), scene.world.end(), Affine());
+        std::fill(scene.visible.begin(), scene.visible.end(), (Uint8)0);
+
+        std::vector<double> frameMs;
+        bool matches = true;
+        for (int run = 0; run < runs; ++run)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            Uint32 visible = runFrame(scene);
+            frameMs.push_back(elapsedMs(start, SDL_GetPerformanceCounter()));
+            matches = matches && visible == referenceCount;
+        }
+        matches = matches && memcmp(scene.world.data(), referenceWorld.data(), count * sizeof(Affine)) == 0
+            && scene.visible == referenceVisible;
+        passed = passed && matches;
+
+        JobStats jobStats = gJobs.stats();
+        gJobs.shutdown();
+
+        Stats stats = computeStats(frameMs);
+        if (threads == 1)
+            oneThreadMs = stats.min;
+        double speedup = oneThreadMs / std::max(stats.min, 1e-9);
+        fprintf(out, "    {\"threads\": %d, \"min_ms\": %.3f, \"mean_ms\": %.3f, \"p95_ms\": %.3f, \"mobjects_per_sec\": %.1f, \"speedup\": %.2f, \"efficiency\": %.2f, \"jobs\": %llu, \"stolen\": %llu, \"inlined\": %llu, \"matches\": %s}%s\n",
+            threads, stats.min, stats.mean, stats.p95, (double)count / 1e3 / std::max(stats.min, 1e-9), speedup, speedup / threads,
+            (unsigned long long)jobStats.executed, (unsigned long long)jobStats.stolen, (unsigned long long)jobStats.inlined,
+            matches ? "true" : "false", threads * 2 <= maxThreads ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"passed\": %s\n}\n", passed ? "true" : "false");
+
+    if (out != stdout)
+        fclose(out);
+    return passed ? 0 : 1;
+}
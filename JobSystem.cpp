@@ -0,0 +1,279 @@
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+
+JobSystem gJobs;
+
+namespace
+{
+    //Polls for new work this many times before a worker goes to sleep
+    const int kSpinCount = 64;
+
+    //Queue of the current thread, -1 on threads the job system did not start
+    thread_local const JobSystem* tSystem = nullptr;
+    thread_local int tQueueIndex = -1;
+    thread_local Uint32 tStealSeed = 0x9E3779B9u;
+}
+
+JobSystem::~JobSystem()
+{
+    shutdown();
+}
+
+bool JobSystem::init(int threadCount)
+{
+    shutdown();
+    MemoryTagScope memoryTag(MemoryTag::Jobs);
+
+    if (threadCount <= 0)
+        threadCount = SDL_GetNumLogicalCPUCores();
+    mThreadCount = std::clamp(threadCount, 1, (int)kMaxThreads);
+
+    mQueues = std::make_unique<WorkerQueue[]>(mThreadCount);
+    for (int i = 0; i < mThreadCount; ++i)
+        mQueues[i].jobs.resize(kQueueCapacity);
+
+    tSystem = this;
+    tQueueIndex = 0;
+
+    mStopping = false;
+    for (int i = 1; i < mThreadCount; ++i)
+        mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+    return true;
+}
+
+void JobSystem::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers)
+        worker.join();
+    std::vector<std::thread>().swap(mWorkers);
+
+    // Every counter has to be waited for before shutdown, so the queues are empty by now
+    mQueues.reset();
+    mThreadCount = 1;
+    mQueued = 0;
+    std::vector<DeferredJob>().swap(mDeferred);
+    mDeferredCount = 0;
+    if (tSystem == this)
+        tSystem = nullptr;
+}
+
+void JobSystem::run(const Job& job, JobCounter* counter, const JobCounter* after)
+{
+    Job queued = job;
+    queued.counter = counter;
+    if (counter)
+        counter->mCount.fetch_add(1);
+
+    if (after)
+    {
+        // Counted before after is checked, so a finish() that brings after to zero either sees it or happened first
+        std::lock_guard<std::mutex> lock(mDeferredMutex);
+        mDeferredCount.fetch_add(1);
+        if (after->mCount.load() > 0)
+        {
+            mDeferred.push_back({ queued, after });
+            return;
+        }
+        mDeferredCount.fetch_sub(1);
+    }
+    push(queued);
+}
+
+void JobSystem::wait(const JobCounter& counter)
+{
+    const int index = queueIndex();
+    Job job;
+    while (counter.mCount.load(std::memory_order_acquire) > 0)
+    {
+        if (findJob(index, job))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+JobStats JobSystem::stats() const
+{
+    JobStats stats;
+    for (int i = 0; mQueues && i < mThreadCount; ++i)
+    {
+        stats.executed += mQueues[i].executed.load(std::memory_order_relaxed);
+        stats.stolen += mQueues[i].stolen.load(std::memory_order_relaxed);
+        stats.inlined += mQueues[i].inlined.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+size_t JobSystem::chunkSize(size_t count, size_t grain) const
+{
+    if (mThreadCount <= 1)
+        return count;
+
+    // About four ranges per thread leaves room to balance uneven ones; whole grains keep SIMD batches aligned
+    grain = std::max<size_t>(grain, 1);
+    size_t target = (count + (size_t)mThreadCount * 4 - 1) / ((size_t)mThreadCount * 4);
+    return std::max(grain, (target + grain - 1) / grain * grain);
+}
+
+int JobSystem::queueIndex() const
+{
+    return tSystem == this ? tQueueIndex : -1;
+}
+
+void JobSystem::push(const Job& job)
+{
+    if (mThreadCount <= 1)
+    {
+        execute(job);
+        return;
+    }
+
+    // Threads without a queue of their own spread their jobs over all of them
+    int index = queueIndex();
+    if (index < 0)
+        index = (int)((Uint32)mPushCursor.fetch_add(1, std::memory_order_relaxed) % (Uint32)mThreadCount);
+
+    WorkerQueue& queue = mQueues[index];
+    {
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.tail - queue.head == kQueueCapacity)
+        {
+            lock.unlock();
+            queue.inlined.fetch_add(1, std::memory_order_relaxed);
+            execute(job);
+            return;
+        }
+        queue.jobs[queue.tail % kQueueCapacity] = job;
+        queue.tail++;
+    }
+
+    mQueued.fetch_add(1);
+    if (mSleeping.load() > 0)
+    {
+        // Taking the lock orders this with a worker that is between its last check and sleeping
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+        }
+        mWake.notify_one();
+    }
+}
+
+bool JobSystem::pop(int index, Job& job)
+{
+    WorkerQueue& queue = mQueues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.head == queue.tail)
+        return false;
+
+    // Newest first, its data is most likely still in cache
+    queue.tail--;
+    job = queue.jobs[queue.tail % kQueueCapacity];
+    mQueued.fetch_sub(1);
+    return true;
+}
+
+bool JobSystem::steal(int thief, Job& job)
+{
+    // A random first victim keeps thieves from all piling onto the same queue
+    tStealSeed ^= tStealSeed << 13;
+    tStealSeed ^= tStealSeed >> 17;
+    tStealSeed ^= tStealSeed << 5;
+    const int first = (int)(tStealSeed % (Uint32)mThreadCount);
+
+    for (int i = 0; i < mThreadCount; ++i)
+    {
+        int victim = (first + i) % mThreadCount;
+        if (victim == thief)
+            continue;
+
+        WorkerQueue& queue = mQueues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.head == queue.tail)
+            continue;
+
+        // Oldest first, the owner works from the other end
+        job = queue.jobs[queue.head % kQueueCapacity];
+        queue.head++;
+        queue.stolen.fetch_add(1, std::memory_order_relaxed);
+        mQueued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::findJob(int index, Job& job)
+{
+    if (mThreadCount <= 1 || mQueued.load(std::memory_order_relaxed) <= 0)
+        return false;
+    return (index >= 0 && pop(index, job)) || steal(index, job);
+}
+
+void JobSystem::execute(const Job& job)
+{
+    job.function(job.data, job.begin, job.end);
+    if (mQueues)
+        mQueues[std::max(queueIndex(), 0)].executed.fetch_add(1, std::memory_order_relaxed);
+    finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+    // The counter may be gone as soon as it reaches zero, it is not touched after the decrement
+    if (counter && counter->mCount.fetch_sub(1) == 1 && mDeferredCount.load() > 0)
+        releaseDeferred();
+}
+
+void JobSystem::releaseDeferred()
+{
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(mDeferredMutex);
+        auto waiting = std::partition(mDeferred.begin(), mDeferred.end(),
+            [](const DeferredJob& deferred) { return deferred.after->mCount.load() > 0; });
+        for (auto it = waiting; it != mDeferred.end(); ++it)
+            ready.push_back(it->job);
+        mDeferred.erase(waiting, mDeferred.end());
+        mDeferredCount.fetch_sub((int)ready.size());
+    }
+    for (const Job& job : ready)
+        push(job);
+}
+
+void JobSystem::workerLoop(int index)
+{
+    tSystem = this;
+    tQueueIndex = index;
+    tStealSeed ^= (Uint32)index * 0x85EBCA6Bu;
+
+    Job job;
+    while (true)
+    {
+        if (findJob(index, job))
+        {
+            execute(job);
+            continue;
+        }
+
+        // Frame work arrives in bursts, a short spin catches the next one without a wake-up
+        bool found = false;
+        for (int spin = 0; spin < kSpinCount && !found; ++spin)
+        {
+            std::this_thread::yield();
+            found = mQueued.load(std::memory_order_relaxed) > 0;
+        }
+        if (found)
+            continue;
+
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mSleeping.fetch_add(1);
+        mWake.wait(lock, [this] { return mStopping || mQueued.load() > 0; });
+        mSleeping.fetch_sub(1);
+        if (mStopping)
+            return;
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//Number of jobs started with it that have not finished yet
+class JobCounter
+{
+public:
+    bool done() const { return mCount.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> mCount = 0;
+};
+
+//A function run on [begin, end) of whatever data points to
+struct Job
+{
+    void (*function)(void* data, size_t begin, size_t end) = nullptr;
+    void* data = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+
+    //Set by JobSystem::run
+    JobCounter* counter = nullptr;
+};
+
+//Totals since init()
+struct JobStats
+{
+    Uint64 executed = 0;
+
+    //Jobs a thread took from another thread's queue
+    Uint64 stolen = 0;
+
+    //Jobs run on the spot because the queue was full
+    Uint64 inlined = 0;
+};
+
+/**
+ * Work-stealing job system shared by the engine's per-frame work.
+ *
+ * The thread that calls init() and every worker own a fixed-size deque.
+ * A thread pushes and pops its own jobs at the back, so the most recent
+ * (and cache-warm) job runs next, and steals from the front of another
+ * queue when its own is empty. Idle workers spin briefly before sleeping.
+ *
+ * Jobs are tracked with JobCounters: run() counts a job up on its counter
+ * and finishing it counts down. A job can wait for another counter; it is
+ * held back until that counter reaches zero, so chains of work are
+ * dispatched without blocking anyone. wait() runs queued jobs until the
+ * counter is done rather than sleeping. A counter must outlive the jobs
+ * started with it and the jobs that wait for it.
+ *
+ * Before init(), or with one thread, everything runs inline on the caller.
+ */
+class JobSystem
+{
+public:
+    enum { kMaxThreads = 64, kQueueCapacity = 4096 };
+
+    ~JobSystem();
+
+    //threadCount includes the calling thread, 0 uses one per core
+    bool init(int threadCount = 0);
+    void shutdown();
+
+    int threadCount() const { return mThreadCount; }
+
+    //Queues job, counted on counter; with after, the job is held until after is done
+    void run(const Job& job, JobCounter* counter = nullptr, const JobCounter* after = nullptr);
+
+    //Runs queued jobs until counter reaches zero
+    void wait(const JobCounter& counter);
+
+    //Calls fn(begin, end) on ranges of [0, count) that are whole multiples of grain but the last, returns when all are done
+    template <typename Fn>
+    void parallelFor(size_t count, size_t grain, const Fn& fn);
+
+    JobStats stats() const;
+
+private:
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex mutex;
+        std::vector<Job> jobs;
+        size_t head = 0;
+        size_t tail = 0;
+        std::atomic<Uint64> executed = 0;
+        std::atomic<Uint64> stolen = 0;
+        std::atomic<Uint64> inlined = 0;
+    };
+
+    //A job held back until after is done
+    struct DeferredJob
+    {
+        Job job;
+        const JobCounter* after;
+    };
+
+    size_t chunkSize(size_t count, size_t grain) const;
+    int queueIndex() const;
+    void push(const Job& job);
+    bool pop(int index, Job& job);
+    bool steal(int thief, Job& job);
+    bool findJob(int index, Job& job);
+    void execute(const Job& job);
+    void finish(JobCounter* counter);
+    void releaseDeferred();
+    void workerLoop(int index);
+
+    int mThreadCount = 1;
+    std::unique_ptr<WorkerQueue[]> mQueues;
+    std::vector<std::thread> mWorkers;
+    std::atomic<int> mQueued = 0;
+    std::atomic<int> mPushCursor = 0;
+
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+    std::atomic<int> mSleeping = 0;
+    bool mStopping = false;
+
+    std::mutex mDeferredMutex;
+    std::vector<DeferredJob> mDeferred;
+    std::atomic<int> mDeferredCount = 0;
+};
+
+template <typename Fn>
+void JobSystem::parallelFor(size_t count, size_t grain, const Fn& fn)
+{
+    const size_t chunk = chunkSize(count, grain);
+    if (chunk >= count)
+    {
+        if (count > 0)
+            fn((size_t)0, count);
+        return;
+    }
+
+    Job job;
+    job.function = [](void* data, size_t begin, size_t end) { (*(const Fn*)data)(begin, end); };
+    job.data = (void*)&fn;
+    JobCounter counter;
+    for (size_t begin = 0; begin < count; begin += chunk)
+    {
+        job.begin = begin;
+        job.end = std::min(count, begin + chunk);
+        run(job, &counter);
+    }
+    wait(counter);
+}
+
+//Started by init(), stopped by close()
+extern JobSystem gJobs;
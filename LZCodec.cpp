@@ -0,0 +1,151 @@
+#include "LZCodec.h"
+#include <cstring>
+
+namespace
+{
+    const int kHashBits = 16;
+    const size_t kMinMatch = 4;
+    const size_t kMaxOffset = 65535;
+
+    //Matches stop short of the end like in LZ4, the stream always ends in literals
+    const size_t kLastLiterals = 5;
+
+    Uint32 read32(const Uint8* p)
+    {
+        Uint32 value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    Uint32 hash4(Uint32 sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - kHashBits);
+    }
+
+    void writeLength(std::vector<Uint8>& out, size_t length)
+    {
+        while (length >= 255)
+        {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back((Uint8)length);
+    }
+
+    void writeSequence(std::vector<Uint8>& out, const Uint8* literals, size_t literalCount, size_t offset, size_t matchLength)
+    {
+        size_t matchCode = matchLength ? matchLength - kMinMatch : 0;
+        Uint8 token = (Uint8)((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15));
+        out.push_back(token);
+        if (literalCount >= 15)
+            writeLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+
+        if (matchLength)
+        {
+            out.push_back((Uint8)(offset & 0xFF));
+            out.push_back((Uint8)(offset >> 8));
+            if (matchCode >= 15)
+                writeLength(out, matchCode - 15);
+        }
+    }
+
+    bool readLength(const Uint8*& in, const Uint8* end, size_t& length)
+    {
+        Uint8 byte;
+        do
+        {
+            if (in >= end)
+                return false;
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+void lzCompress(const Uint8* data, size_t size, std::vector<Uint8>& out)
+{
+    std::vector<Uint32> table((size_t)1 << kHashBits, 0);
+
+    size_t anchor = 0;
+    size_t position = 0;
+    const size_t matchLimit = size > kLastLiterals ? size - kLastLiterals : 0;
+
+    while (position + kMinMatch <= matchLimit)
+    {
+        Uint32 sequence = read32(data + position);
+        Uint32 hash = hash4(sequence);
+        size_t candidate = table[hash];
+        table[hash] = (Uint32)position;
+
+        if (candidate >= position || position - candidate > kMaxOffset || read32(data + candidate) != sequence)
+        {
+            position++;
+            continue;
+        }
+
+        size_t length = kMinMatch;
+        while (position + length < matchLimit && data[candidate + length] == data[position + length])
+            length++;
+
+        writeSequence(out, data + anchor, position - anchor, position - candidate, length);
+        position += length;
+        anchor = position;
+    }
+
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+bool lzDecompress(const Uint8* data, size_t size, Uint8* out, size_t outSize)
+{
+    const Uint8* in = data;
+    const Uint8* inEnd = data + size;
+    size_t written = 0;
+
+    while (in < inEnd)
+    {
+        Uint8 token = *in++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(in, inEnd, literalCount))
+            return false;
+        if (literalCount > (size_t)(inEnd - in) || literalCount > outSize - written)
+            return false;
+        if (literalCount)
+            memcpy(out + written, in, literalCount);
+        in += literalCount;
+        written += literalCount;
+
+        // The last sequence ends after its literals
+        if (in == inEnd)
+            break;
+
+        if (inEnd - in < 2)
+            return false;
+        size_t offset = in[0] | (size_t)in[1] << 8;
+        in += 2;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+            return false;
+        matchLength += kMinMatch;
+
+        if (offset == 0 || offset > written || matchLength > outSize - written)
+            return false;
+
+        // Overlapping matches repeat a pattern, so copy forward byte by byte when they overlap
+        const Uint8* source = out + written - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(out + written, source, matchLength);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; ++i)
+                out[written + i] = source[i];
+        }
+        written += matchLength;
+    }
+    return written == outSize;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+
+/**
+ * Byte-oriented LZ77 in the style of the LZ4 block format.
+ *
+ * Each sequence is a token byte (literal count in the high nibble, match
+ * length minus 4 in the low nibble, 15 meaning more length bytes follow),
+ * the literals, then a 16-bit little-endian match offset. The last sequence
+ * has literals only. Matches are found through a single-entry hash table,
+ * which trades ratio for a compressor fast enough to run at pack time on
+ * every asset and a decoder that is little more than memcpy.
+ */
+
+//Appends the compressed form of data to out
+void lzCompress(const Uint8* data, size_t size, std::vector<Uint8>& out);
+
+//Decodes exactly outSize bytes, false on corrupt input
+bool lzDecompress(const Uint8* data, size_t size, Uint8* out, size_t outSize);
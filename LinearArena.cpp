@@ -0,0 +1,100 @@
+#include "LinearArena.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace
+{
+    //Header of a heap block holding one allocation that overflowed
+    struct OverflowBlock
+    {
+        OverflowBlock* next;
+        size_t bytes;
+    };
+
+    Uint8* alignUp(Uint8* pointer, size_t alignment)
+    {
+        uintptr_t address = (uintptr_t)pointer;
+        return pointer + ((alignment - address % alignment) % alignment);
+    }
+}
+
+LinearArena::LinearArena(size_t capacity)
+{
+    reserve(capacity);
+}
+
+LinearArena::~LinearArena()
+{
+    releaseOverflow(nullptr);
+    ::operator delete(mBlock);
+}
+
+void LinearArena::reserve(size_t capacity)
+{
+    releaseOverflow(nullptr);
+    ::operator delete(mBlock);
+    mBlock = capacity > 0 ? (Uint8*)::operator new(capacity) : nullptr;
+    mCapacity = capacity;
+    mUsed = 0;
+}
+
+void LinearArena::reset()
+{
+    // A quarter more than the busiest frame so far, the next frame that needs a little more still fits
+    if (mHighWater > mCapacity)
+        reserve(mHighWater + mHighWater / 4);
+    releaseOverflow(nullptr);
+    mUsed = 0;
+}
+
+ArenaMarker LinearArena::mark() const
+{
+    ArenaMarker marker;
+    marker.used = mUsed;
+    marker.overflow = mOverflow;
+    marker.overflowBytes = mOverflowBytes;
+    return marker;
+}
+
+void LinearArena::rewind(const ArenaMarker& marker)
+{
+    releaseOverflow(marker.overflow);
+    mUsed = marker.used;
+    mOverflowBytes = marker.overflowBytes;
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+    if (mBlock)
+    {
+        Uint8* start = alignUp(mBlock + mUsed, alignment);
+        if (start + bytes <= mBlock + mCapacity)
+        {
+            mUsed = (size_t)(start + bytes - mBlock);
+            mHighWater = std::max(mHighWater, used());
+            return start;
+        }
+    }
+
+    // The allocation follows its header, aligned within a block padded for it
+    OverflowBlock* block = (OverflowBlock*)::operator new(sizeof(OverflowBlock) + alignment + bytes);
+    block->next = (OverflowBlock*)mOverflow;
+    block->bytes = bytes;
+    mOverflow = block;
+    mOverflowBytes += bytes;
+    mOverflows++;
+    mHighWater = std::max(mHighWater, used());
+    return alignUp((Uint8*)(block + 1), alignment);
+}
+
+void LinearArena::releaseOverflow(void* until)
+{
+    while (mOverflow && mOverflow != until)
+    {
+        OverflowBlock* block = (OverflowBlock*)mOverflow;
+        mOverflow = block->next;
+        mOverflowBytes -= block->bytes;
+        ::operator delete(block);
+    }
+}
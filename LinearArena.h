@@ -0,0 +1,85 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <memory_resource>
+
+//Position in a LinearArena to rewind to
+struct ArenaMarker
+{
+    size_t used = 0;
+    void* overflow = nullptr;
+    size_t overflowBytes = 0;
+};
+
+/**
+ * Bump allocator for data that lives one frame, usable by std::pmr containers.
+ *
+ * Allocating moves a pointer through one block and deallocating does
+ * nothing; reset() frees everything at once. What does not fit the block
+ * goes to the heap and is freed with the rest, and the next reset() grows
+ * the block to the most the arena ever held, so a steady workload stops
+ * touching the heap after its first frames. Not thread safe: one thread
+ * fills an arena at a time.
+ */
+class LinearArena : public std::pmr::memory_resource
+{
+public:
+    LinearArena() = default;
+    explicit LinearArena(size_t capacity);
+    ~LinearArena() override;
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    //Frees everything and replaces the block with one of capacity bytes
+    void reserve(size_t capacity);
+
+    //Frees everything, growing the block first if it overflowed
+    void reset();
+
+    //Everything allocated after mark() is freed by rewind(), scopes nest like a stack
+    ArenaMarker mark() const;
+    void rewind(const ArenaMarker& marker);
+
+    size_t capacity() const { return mCapacity; }
+    size_t used() const { return mUsed + mOverflowBytes; }
+    size_t highWater() const { return mHighWater; }
+
+    //Allocations that did not fit the block and went to the heap
+    Uint64 overflows() const { return mOverflows; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    void releaseOverflow(void* until);
+
+    Uint8* mBlock = nullptr;
+    size_t mCapacity = 0;
+    size_t mUsed = 0;
+    size_t mHighWater = 0;
+
+    //Heap blocks of the allocations that overflowed, newest first
+    void* mOverflow = nullptr;
+    size_t mOverflowBytes = 0;
+    Uint64 mOverflows = 0;
+};
+
+//Rewinds an arena to where it stood when the scope opened, a stack allocator for work nested inside a frame
+class ArenaScope
+{
+public:
+    explicit ArenaScope(LinearArena& arena) : mArena(arena), mMarker(arena.mark()) {}
+    ~ArenaScope() { mArena.rewind(mMarker); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    std::pmr::memory_resource* resource() const { return &mArena; }
+
+private:
+    LinearArena& mArena;
+    ArenaMarker mMarker;
+};
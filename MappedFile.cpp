@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+#include <cstdio>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        mData = std::exchange(other.mData, nullptr);
+        mSize = std::exchange(other.mSize, 0);
+        mOpen = std::exchange(other.mOpen, false);
+        mMapping = std::exchange(other.mMapping, nullptr);
+        mBuffer = std::move(other.mBuffer);
+
+        // The fallback view points into the buffer, which moved without reallocating
+        other.mBuffer.clear();
+    }
+    return *this;
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size = {};
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        // The view keeps the mapping alive, both handles can go right away
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+        {
+            mMapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        mSize = (size_t)size.QuadPart;
+    }
+    CloseHandle(file);
+#else
+    int file = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return false;
+
+    struct stat info = {};
+    if (fstat(file, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (view != MAP_FAILED)
+        {
+            madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+            mMapping = view;
+        }
+        mSize = (size_t)info.st_size;
+    }
+    ::close(file);
+#endif
+
+    if (mMapping)
+    {
+        mData = (const Uint8*)mMapping;
+        mOpen = true;
+        return true;
+    }
+
+    mSize = 0;
+    return readFallback(path);
+}
+
+bool MappedFile::readFallback(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    // Files without a known size (pipes, procfs) are read in chunks
+    Uint8 chunk[65536];
+    size_t read = 0;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        mBuffer.insert(mBuffer.end(), chunk, chunk + read);
+    bool ok = !ferror(file);
+    fclose(file);
+    if (!ok)
+    {
+        mBuffer.clear();
+        return false;
+    }
+
+    mData = mBuffer.data();
+    mSize = mBuffer.size();
+    mOpen = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mMapping)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(mMapping);
+#else
+        munmap(mMapping, mSize);
+#endif
+    }
+
+    mMapping = nullptr;
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+    std::vector<Uint8>().swap(mBuffer);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * Read-only view of a whole file.
+ *
+ * The file is memory-mapped (mmap with MADV_SEQUENTIAL, or a Win32 file
+ * mapping opened for sequential scan), so its bytes are handed out straight
+ * from the page cache without being copied. When mapping is not possible,
+ * e.g. for an empty file or a file system without mmap support, the file
+ * is read once into an owned buffer instead; callers cannot tell the
+ * difference. The view stays valid until the MappedFile is closed,
+ * reopened or destroyed.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //Returns false when the file cannot be opened or read
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const { return mOpen; }
+
+    //True when the view points into a mapping rather than the fallback buffer
+    bool mapped() const { return mMapping != nullptr; }
+
+    const Uint8* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+    std::span<const Uint8> bytes() const { return std::span<const Uint8>(mData, mSize); }
+    std::string_view text() const { return std::string_view((const char*)mData, mSize); }
+
+private:
+    bool readFallback(const char* path);
+
+    const Uint8* mData = nullptr;
+    size_t mSize = 0;
+    bool mOpen = false;
+
+    //Start of the mapped view, nullptr for the fallback
+    void* mMapping = nullptr;
+    std::vector<Uint8> mBuffer;
+};
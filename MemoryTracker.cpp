@@ -0,0 +1,387 @@
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace
+{
+    //Precedes every block operator new hands out, the allocation starts offset bytes into what malloc returned
+    struct BlockHeader
+    {
+        Uint64 size;
+        Uint32 offset;
+        Uint8 tag;
+        Uint8 aligned;
+    };
+
+    const size_t kHeaderSize = 16;
+    static_assert(sizeof(BlockHeader) <= kHeaderSize, "The header must keep the default new alignment");
+
+    struct alignas(64) UsageCounters
+    {
+        std::atomic<Uint64> bytes;
+        std::atomic<Uint64> peakBytes;
+        std::atomic<Uint64> blocks;
+    };
+
+    UsageCounters gUsage[(int)MemoryDomain::Count][(int)MemoryTag::Count];
+
+    std::atomic<Uint64> gAllocations = 0;
+    std::atomic<Uint64> gFrees = 0;
+    std::atomic<Uint64> gBytes = 0;
+
+    thread_local MemoryTag tTag = MemoryTag::Untagged;
+
+    void charge(MemoryDomain domain, MemoryTag tag, Uint64 bytes)
+    {
+        UsageCounters& usage = gUsage[(int)domain][(int)tag];
+        Uint64 now = usage.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        usage.blocks.fetch_add(1, std::memory_order_relaxed);
+        Uint64 peak = usage.peakBytes.load(std::memory_order_relaxed);
+        while (now > peak && !usage.peakBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void credit(MemoryDomain domain, MemoryTag tag, Uint64 bytes)
+    {
+        UsageCounters& usage = gUsage[(int)domain][(int)tag];
+        usage.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        usage.blocks.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void* allocateAligned(size_t size, size_t alignment)
+    {
+#ifdef _MSC_VER
+        return _aligned_malloc(size, alignment);
+#else
+        // aligned_alloc wants a size that is a multiple of the alignment
+        return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+
+    void freeAligned(void* pointer)
+    {
+#ifdef _MSC_VER
+        _aligned_free(pointer);
+#else
+        free(pointer);
+#endif
+    }
+
+    //Retries through the new handler like the standard operator new, nullptr once there is none
+    void* allocate(size_t size, size_t alignment)
+    {
+        size = size > 0 ? size : 1;
+        const bool aligned = alignment > kHeaderSize;
+        const size_t offset = aligned ? alignment : kHeaderSize;
+        for (;;)
+        {
+            Uint8* base = (Uint8*)(aligned ? allocateAligned(size + offset, alignment) : malloc(size + offset));
+            if (base)
+            {
+                BlockHeader* header = (BlockHeader*)(base + offset - kHeaderSize);
+                header->size = size;
+                header->offset = (Uint32)offset;
+                header->tag = (Uint8)tTag;
+                header->aligned = aligned;
+                gAllocations.fetch_add(1, std::memory_order_relaxed);
+                gBytes.fetch_add(size, std::memory_order_relaxed);
+                charge(MemoryDomain::Cpu, tTag, size);
+                return base + offset;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                return nullptr;
+            handler();
+        }
+    }
+
+    void* allocateOrThrow(size_t size, size_t alignment)
+    {
+        void* pointer = allocate(size, alignment);
+        if (!pointer)
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+    void release(void* pointer)
+    {
+        if (!pointer)
+            return;
+        const BlockHeader* header = (const BlockHeader*)((Uint8*)pointer - kHeaderSize);
+        Uint8* base = (Uint8*)pointer - header->offset;
+        gFrees.fetch_add(1, std::memory_order_relaxed);
+        credit(MemoryDomain::Cpu, (MemoryTag)header->tag, header->size);
+        if (header->aligned)
+            freeAligned(base);
+        else
+            free(base);
+    }
+
+    struct GpuBlock
+    {
+        MemoryDomain domain;
+        GLuint name;
+        Uint64 bytes;
+        MemoryTag tag;
+        GLenum usage;
+    };
+
+    //GL objects by domain and name, never destroyed so globals can still untrack from their destructors
+    struct GpuRegistry
+    {
+        std::mutex mutex;
+        std::unordered_map<Uint64, GpuBlock> blocks;
+    };
+
+    GpuRegistry& gpuRegistry()
+    {
+        static GpuRegistry* registry = new GpuRegistry();
+        return *registry;
+    }
+
+    Uint64 gpuKey(MemoryDomain domain, GLuint name)
+    {
+        return (Uint64)domain << 32 | name;
+    }
+
+    struct Budget
+    {
+        Uint64 limit = 0;
+        BudgetAction action = BudgetAction::Fail;
+        MemoryEvictor evictor = nullptr;
+        void* user = nullptr;
+
+        //Reported already, an overrun is logged once until usage drops back under the limit
+        bool over = false;
+    };
+
+    //Never destroyed either, for the same reason
+    struct BudgetRegistry
+    {
+        std::mutex mutex;
+        Budget budgets[(int)MemoryDomain::Count][(int)MemoryTag::Count];
+    };
+
+    BudgetRegistry& budgetRegistry()
+    {
+        static BudgetRegistry* registry = new BudgetRegistry();
+        return *registry;
+    }
+
+    std::atomic<Uint64> gOverruns = 0;
+    std::atomic<Uint64> gEvictions = 0;
+}
+
+const char* memoryTagName(MemoryTag tag)
+{
+    switch (tag)
+    {
+    case MemoryTag::Transforms:
+        return "transforms";
+    case MemoryTag::Render:
+        return "render";
+    case MemoryTag::Shaders:
+        return "shaders";
+    case MemoryTag::Textures:
+        return "textures";
+    case MemoryTag::Assets:
+        return "assets";
+    case MemoryTag::Jobs:
+        return "jobs";
+    default:
+        return "untagged";
+    }
+}
+
+const char* memoryDomainName(MemoryDomain domain)
+{
+    switch (domain)
+    {
+    case MemoryDomain::GpuBuffer:
+        return "gpu_buffer";
+    case MemoryDomain::GpuTexture:
+        return "gpu_texture";
+    default:
+        return "cpu";
+    }
+}
+
+MemoryUsage memoryUsage(MemoryTag tag, MemoryDomain domain)
+{
+    const UsageCounters& counters = gUsage[(int)domain][(int)tag];
+    MemoryUsage usage;
+    usage.bytes = counters.bytes.load(std::memory_order_relaxed);
+    usage.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    usage.blocks = counters.blocks.load(std::memory_order_relaxed);
+    return usage;
+}
+
+HeapCounters heapCounters()
+{
+    HeapCounters counters;
+    counters.allocations = gAllocations.load(std::memory_order_relaxed);
+    counters.frees = gFrees.load(std::memory_order_relaxed);
+    counters.bytes = gBytes.load(std::memory_order_relaxed);
+    return counters;
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag)
+    : mPrevious(tTag)
+{
+    tTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope()
+{
+    tTag = mPrevious;
+}
+
+void trackGpuMemory(MemoryDomain domain, GLuint name, Uint64 bytes, MemoryTag tag, GLenum usage)
+{
+    // The registry's own storage is not charged to whoever tracks the object
+    MemoryTagScope memoryTag(MemoryTag::Untagged);
+    GpuRegistry& registry = gpuRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto it = registry.blocks.find(gpuKey(domain, name));
+    if (it != registry.blocks.end())
+        credit(domain, it->second.tag, it->second.bytes);
+    registry.blocks[gpuKey(domain, name)] = { domain, name, bytes, tag, usage };
+    charge(domain, tag, bytes);
+}
+
+void untrackGpuMemory(MemoryDomain domain, GLuint name)
+{
+    GpuRegistry& registry = gpuRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto it = registry.blocks.find(gpuKey(domain, name));
+    if (it == registry.blocks.end())
+        return;
+    credit(domain, it->second.tag, it->second.bytes);
+    registry.blocks.erase(it);
+}
+
+void setMemoryBudget(MemoryTag tag, MemoryDomain domain, Uint64 limit, BudgetAction action, MemoryEvictor evictor, void* user)
+{
+    BudgetRegistry& registry = budgetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    Budget& budget = registry.budgets[(int)domain][(int)tag];
+    budget.limit = limit;
+    budget.action = action;
+    budget.evictor = evictor;
+    budget.user = user;
+    budget.over = false;
+}
+
+bool enforceMemoryBudgets()
+{
+    // Evictors run without the lock, they free memory and may set budgets themselves
+    BudgetRegistry& registry = budgetRegistry();
+    Budget budgets[(int)MemoryDomain::Count][(int)MemoryTag::Count];
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::copy(&registry.budgets[0][0], &registry.budgets[0][0] + SDL_arraysize(budgets) * SDL_arraysize(budgets[0]), &budgets[0][0]);
+    }
+
+    bool within = true;
+    for (int d = 0; d < (int)MemoryDomain::Count; ++d)
+    {
+        for (int t = 0; t < (int)MemoryTag::Count; ++t)
+        {
+            Budget& budget = budgets[d][t];
+            if (budget.limit == 0)
+                continue;
+
+            MemoryDomain domain = (MemoryDomain)d;
+            MemoryTag tag = (MemoryTag)t;
+            Uint64 used = memoryUsage(tag, domain).bytes;
+            if (used > budget.limit && budget.action == BudgetAction::Evict && budget.evictor)
+            {
+                budget.evictor(used - budget.limit, budget.user);
+                gEvictions.fetch_add(1, std::memory_order_relaxed);
+                used = memoryUsage(tag, domain).bytes;
+            }
+
+            bool over = used > budget.limit;
+            if (over && !budget.over)
+            {
+                gOverruns.fetch_add(1, std::memory_order_relaxed);
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Memory budget exceeded: %s %s uses %llu of %llu bytes!\n",
+                    memoryTagName(tag), memoryDomainName(domain), (unsigned long long)used, (unsigned long long)budget.limit);
+                SDL_assert(used <= budget.limit);
+            }
+            within = within && !over;
+
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            if (registry.budgets[d][t].limit == budget.limit)
+                registry.budgets[d][t].over = over;
+        }
+    }
+    return within;
+}
+
+Uint64 memoryBudgetOverruns()
+{
+    return gOverruns.load(std::memory_order_relaxed);
+}
+
+Uint64 memoryEvictions()
+{
+    return gEvictions.load(std::memory_order_relaxed);
+}
+
+size_t reportMemoryLeaks()
+{
+    // Untagged memory includes every global and the runtime's own, it is not expected to be back to zero
+    size_t leaks = 0;
+    for (int t = 1; t < (int)MemoryTag::Count; ++t)
+    {
+        MemoryUsage usage = memoryUsage((MemoryTag)t, MemoryDomain::Cpu);
+        if (usage.blocks > 0)
+        {
+            SDL_Log("Memory leak: %s still holds %llu bytes in %llu blocks (peak %llu bytes).\n", memoryTagName((MemoryTag)t),
+                (unsigned long long)usage.bytes, (unsigned long long)usage.blocks, (unsigned long long)usage.peakBytes);
+            leaks++;
+        }
+    }
+
+    GpuRegistry& registry = gpuRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& entry : registry.blocks)
+    {
+        const GpuBlock& block = entry.second;
+        SDL_Log("Memory leak: %s %u of %llu bytes (%s, usage 0x%04X) was never released.\n", memoryDomainName(block.domain), block.name,
+            (unsigned long long)block.bytes, memoryTagName(block.tag), block.usage);
+    }
+    return leaks + registry.blocks.size();
+}
+
+// Every replaceable form, so no allocation bypasses the counters and every one is freed by its match
+void* operator new(size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocateOrThrow(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateOrThrow(size, (size_t)alignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, (size_t)alignment); }
+
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release(pointer); }
@@ -0,0 +1,103 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+
+//Subsystem memory is charged to
+enum class MemoryTag : Uint8
+{
+    Untagged,
+    Transforms,
+    Render,
+    Shaders,
+    Textures,
+    Assets,
+    Jobs,
+    Count
+};
+
+//Where the memory lives
+enum class MemoryDomain : Uint8
+{
+    Cpu,
+    GpuBuffer,
+    GpuTexture,
+    Count
+};
+
+const char* memoryTagName(MemoryTag tag);
+const char* memoryDomainName(MemoryDomain domain);
+
+//Live bytes and blocks of one tag in one domain, and the most bytes it ever held
+struct MemoryUsage
+{
+    Uint64 bytes = 0;
+    Uint64 peakBytes = 0;
+    Uint64 blocks = 0;
+};
+
+MemoryUsage memoryUsage(MemoryTag tag, MemoryDomain domain);
+
+/**
+ * operator new and delete calls since startup, over all threads.
+ *
+ * Kept by the replacement global operators in MemoryTracker.cpp, so only
+ * C++ allocations are seen; SDL and the GL driver allocate with malloc.
+ * Take one snapshot before and one after a stretch of frames to check it
+ * allocated nothing.
+ */
+struct HeapCounters
+{
+    Uint64 allocations = 0;
+    Uint64 frees = 0;
+    Uint64 bytes = 0;
+};
+
+HeapCounters heapCounters();
+
+/**
+ * Charges the C++ allocations of the calling thread to a tag until the
+ * scope closes. Scopes nest, the innermost wins. Every block remembers its
+ * tag, so freeing it credits the right tag whichever thread frees it.
+ */
+class MemoryTagScope
+{
+public:
+    explicit MemoryTagScope(MemoryTag tag);
+    ~MemoryTagScope();
+
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+private:
+    MemoryTag mPrevious;
+};
+
+//Records a GL buffer or texture of bytes (GpuBuffer or GpuTexture), usage is the buffer usage or the texture's internal format; again for the same name replaces it
+void trackGpuMemory(MemoryDomain domain, GLuint name, Uint64 bytes, MemoryTag tag, GLenum usage);
+void untrackGpuMemory(MemoryDomain domain, GLuint name);
+
+//What happens when a budget is exceeded
+enum class BudgetAction
+{
+    //Log an error and assert, the caller is expected to stay within its budget
+    Fail,
+
+    //Ask the evictor to free memory, and fail like above only when it cannot get back under
+    Evict
+};
+
+//Frees at least bytes of its memory if it can, returns how much it freed
+typedef Uint64 (*MemoryEvictor)(Uint64 bytes, void* user);
+
+//limit 0 removes the budget
+void setMemoryBudget(MemoryTag tag, MemoryDomain domain, Uint64 limit, BudgetAction action, MemoryEvictor evictor = nullptr, void* user = nullptr);
+
+//Checks every budget against current use; call once per frame where the evictors may run, false while one is still exceeded
+bool enforceMemoryBudgets();
+
+//Times enforceMemoryBudgets() found a budget exceeded after any eviction, and evictions it ran
+Uint64 memoryBudgetOverruns();
+Uint64 memoryEvictions();
+
+//Call once every subsystem has shut down: logs each tag still holding CPU memory and each GL object never untracked, returns how many
+size_t reportMemoryLeaks();
@@ -0,0 +1,84 @@
+#include "BenchmarkCommon.h"
+#include "MeshBuilder.h"
+#include <random>
+
+using namespace bench;
+
+namespace
+{
+    //Unindexed UV sphere with its triangles shuffled, the worst case a loader can hand over
+    std::vector<glm::vec3> makeSphereSoup(int segments)
+    {
+        const float pi = 3.14159265f;
+        auto point = [&](int ring, int segment)
+        {
+            float theta = pi * ring / segments;
+            float phi = 2.0f * pi * (segment % segments) / segments;
+            return glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+        };
+
+        std::vector<glm::vec3> triangles;
+        for (int ring = 0; ring < segments; ++ring)
+        {
+            for (int segment = 0; segment < segments; ++segment)
+            {
+                glm::vec3 a = point(ring, segment);
+                glm::vec3 b = point(ring, segment + 1);
+                glm::vec3 c = point(ring + 1, segment);
+                glm::vec3 d = point(ring + 1, segment + 1);
+                if (ring != 0)
+                    triangles.insert(triangles.end(), { a, b, c });
+                if (ring != segments - 1)
+                    triangles.insert(triangles.end(), { b, d, c });
+            }
+        }
+
+        std::mt19937 rng(1234);
+        size_t triangleCount = triangles.size() / 3;
+        for (size_t t = triangleCount - 1; t > 0; --t)
+        {
+            size_t other = std::uniform_int_distribution<size_t>(0, t)(rng);
+            for (int k = 0; k < 3; ++k)
+                std::swap(triangles[t * 3 + k], triangles[other * 3 + k]);
+        }
+        return triangles;
+    }
+}
+
+int runMeshBenchmark(int argc, char* args[])
+{
+    const char* outPath = findArg(argc, args, "--out");
+    const int sizes[] = { 16, 64, 256 };
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"benchmark\": \"mesh\",\n  \"cache_size\": 16,\n  \"results\": [\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        std::vector<glm::vec3> soup = makeSphereSoup(sizes[s]);
+
+        MeshBuildReport report;
+        Uint64 start = SDL_GetPerformanceCounter();
+        MeshData mesh = buildMesh(soup.data(), soup.size(), &report);
+        double buildMs = elapsedMs(start, SDL_GetPerformanceCounter());
+
+        std::vector<Uint8> packed;
+        GLenum indexType = packIndices(mesh.indices, mesh.positions.size(), packed);
+
+        fprintf(out, "    {\"segments\": %d, \"input_vertices\": %zu, \"vertices\": %zu, \"triangles\": %zu, \"index_bits\": %d, "
+            "\"acmr_before\": %.3f, \"acmr_after\": %.3f, \"atvr_before\": %.3f, \"atvr_after\": %.3f, \"build_ms\": %.3f}%s\n",
+            sizes[s], report.inputVertices, report.outputVertices, report.triangles, indexSize(indexType) * 8,
+            report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr, buildMs,
+            s + 1 < sizeof(sizes) / sizeof(sizes[0]) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
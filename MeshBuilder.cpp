@@ -0,0 +1,386 @@
+#include "MeshBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    //Forsyth's tuning values, the cache size only steers the heuristic
+    const int kCacheSize = 16;
+    const float kCacheDecayPower = 1.5f;
+    const float kLastTriangleScore = 0.75f;
+    const float kValenceBoostScale = 2.0f;
+    const float kValenceBoostPower = 0.5f;
+    const Uint32 kNone = 0xFFFFFFFFu;
+
+    //Score terms precomputed for every cache position and the common valences
+    struct ScoreTables
+    {
+        enum { kMaxValence = 64 };
+
+        float cache[kCacheSize];
+        float valence[kMaxValence];
+
+        ScoreTables()
+        {
+            for (int i = 0; i < kCacheSize; ++i)
+                cache[i] = i < 3 ? kLastTriangleScore : powf(1.0f - (i - 3) * (1.0f / (kCacheSize - 3)), kCacheDecayPower);
+            valence[0] = 0.0f;
+            for (int i = 1; i < kMaxValence; ++i)
+                valence[i] = kValenceBoostScale * powf((float)i, -kValenceBoostPower);
+        }
+    };
+
+    float vertexScore(int cachePosition, Uint32 liveTriangles)
+    {
+        static const ScoreTables tables;
+
+        // Vertices without triangles left must not attract anything
+        if (liveTriangles == 0)
+            return -1.0f;
+
+        // Favor vertices with few triangles left so they are finished and leave the cache
+        float score = liveTriangles < ScoreTables::kMaxValence ? tables.valence[liveTriangles] : kValenceBoostScale * powf((float)liveTriangles, -kValenceBoostPower);
+        if (cachePosition >= 0)
+            score += tables.cache[cachePosition];
+        return score;
+    }
+
+    struct PositionKey
+    {
+        Uint32 bits[3];
+
+        bool operator==(const PositionKey& other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+    };
+
+    struct PositionKeyHash
+    {
+        size_t operator()(const PositionKey& key) const
+        {
+            Uint32 h = key.bits[0] * 73856093u ^ key.bits[1] * 19349663u ^ key.bits[2] * 83492791u;
+            return h ^ (h >> 16);
+        }
+    };
+
+    PositionKey positionKey(const glm::vec3& position)
+    {
+        PositionKey key;
+        for (int c = 0; c < 3; ++c)
+        {
+            // -0 and +0 are the same position
+            float value = position[c] == 0.0f ? 0.0f : position[c];
+            memcpy(&key.bits[c], &value, sizeof(float));
+        }
+        return key;
+    }
+}
+
+MeshData buildMesh(const glm::vec3* soup, size_t vertexCount, MeshBuildReport* report)
+{
+    MeshData mesh = weldVertices(soup, vertexCount);
+    if (report)
+    {
+        report->inputVertices = vertexCount;
+        report->triangles = mesh.indices.size() / 3;
+        report->before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+    }
+
+    optimizeVertexCache(mesh.indices, mesh.positions.size());
+    optimizeOverdraw(mesh.indices, mesh.positions);
+    optimizeVertexFetch(mesh);
+
+    if (report)
+    {
+        report->outputVertices = mesh.positions.size();
+        report->after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+    }
+    return mesh;
+}
+
+MeshData weldVertices(const glm::vec3* soup, size_t vertexCount)
+{
+    MeshData mesh;
+    mesh.indices.reserve(vertexCount);
+
+    std::unordered_map<PositionKey, Uint32, PositionKeyHash> unique;
+    unique.reserve(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        auto inserted = unique.emplace(positionKey(soup[i]), (Uint32)mesh.positions.size());
+        if (inserted.second)
+            mesh.positions.push_back(soup[i]);
+        mesh.indices.push_back(inserted.first->second);
+    }
+    return mesh;
+}
+
+void optimizeVertexCache(std::vector<Uint32>& indices, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of every vertex, the first liveTriangles[v] entries are the ones not emitted yet
+    std::vector<Uint32> offsets(vertexCount + 1, 0);
+    for (Uint32 index : indices)
+        offsets[index + 1]++;
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] += offsets[v];
+
+    std::vector<Uint32> liveTriangles(vertexCount, 0);
+    std::vector<Uint32> adjacency(indices.size());
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            Uint32 v = indices[t * 3 + k];
+            adjacency[offsets[v] + liveTriangles[v]++] = (Uint32)t;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        vertexScores[v] = vertexScore(-1, liveTriangles[v]);
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+    std::vector<Uint8> emitted(triangleCount, 0);
+    std::vector<Uint32> result;
+    result.reserve(indices.size());
+
+    Uint32 cache[kCacheSize + 3];
+    int cacheCount = 0;
+    size_t restartCursor = 0;
+
+    Uint32 best = (Uint32)(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    while (result.size() < indices.size())
+    {
+        // Dead end, continue with the next triangle in input order
+        if (best == kNone)
+        {
+            while (emitted[restartCursor])
+                ++restartCursor;
+            best = (Uint32)restartCursor;
+        }
+
+        const Uint32* triangle = &indices[best * 3];
+        emitted[best] = 1;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            Uint32 v = triangle[k];
+            Uint32* begin = &adjacency[offsets[v]];
+            Uint32* end = begin + liveTriangles[v];
+            Uint32* found = std::find(begin, end, best);
+            std::swap(*found, *(end - 1));
+            liveTriangles[v]--;
+        }
+
+        // Most recent first, the emitted triangle's vertices move to the front
+        Uint32 newCache[kCacheSize + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k)
+            newCache[newCount++] = triangle[k];
+        for (int i = 0; i < cacheCount; ++i)
+        {
+            Uint32 v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache[newCount++] = v;
+        }
+
+        // Rescore the cached vertices, the ones pushed past the end leave the cache
+        for (int i = 0; i < newCount; ++i)
+        {
+            Uint32 v = newCache[i];
+            cachePosition[v] = i < kCacheSize ? i : -1;
+            float score = vertexScore(cachePosition[v], liveTriangles[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+
+            for (Uint32 a = offsets[v]; a < offsets[v] + liveTriangles[v]; ++a)
+                triangleScores[adjacency[a]] += delta;
+        }
+
+        cacheCount = std::min(newCount, kCacheSize);
+        memcpy(cache, newCache, cacheCount * sizeof(Uint32));
+
+        // The next triangle is the best scoring one touching the cache
+        best = kNone;
+        float bestScore = -1e30f;
+        for (int i = 0; i < cacheCount; ++i)
+        {
+            Uint32 v = cache[i];
+            for (Uint32 a = offsets[v]; a < offsets[v] + liveTriangles[v]; ++a)
+            {
+                Uint32 t = adjacency[a];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<Uint32>& indices, const std::vector<glm::vec3>& positions, float threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    const int cacheSize = 16;
+    VertexCacheStats baseline = analyzeVertexCache(indices.data(), indices.size(), positions.size(), cacheSize);
+
+    // A triangle missing the cache on all three vertices starts a new cluster
+    std::vector<Uint32> clusterStarts;
+    std::vector<Uint32> stamps(positions.size(), 0);
+    Uint32 time = cacheSize + 1;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            Uint32 v = indices[t * 3 + k];
+            if (time - stamps[v] > (Uint32)cacheSize)
+            {
+                stamps[v] = time++;
+                misses++;
+            }
+        }
+        if (misses == 3)
+            clusterStarts.push_back((Uint32)t);
+    }
+    clusterStarts.push_back((Uint32)triangleCount);
+    if (clusterStarts.size() < 3)
+        return;
+
+    glm::vec3 meshCenter(0.0f);
+    for (const glm::vec3& position : positions)
+        meshCenter += position;
+    meshCenter /= (float)std::max<size_t>(positions.size(), 1);
+
+    // Clusters facing away from the mesh center are likely to occlude the rest, draw them first
+    struct Cluster
+    {
+        Uint32 first;
+        Uint32 last;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters;
+    clusters.reserve(clusterStarts.size() - 1);
+    for (size_t c = 0; c + 1 < clusterStarts.size(); ++c)
+    {
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (Uint32 t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& d = positions[indices[t * 3 + 2]];
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(cross);
+            center += (a + b + d) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        float key = 0.0f;
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f)
+            key = glm::dot(center / area - meshCenter, normal / normalLength);
+        clusters.push_back({ clusterStarts[c], clusterStarts[c + 1], key });
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<Uint32> sorted;
+    sorted.reserve(indices.size());
+    for (const Cluster& cluster : clusters)
+        sorted.insert(sorted.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+
+    VertexCacheStats reordered = analyzeVertexCache(sorted.data(), sorted.size(), positions.size(), cacheSize);
+    if (reordered.acmr <= baseline.acmr * threshold)
+        indices.swap(sorted);
+}
+
+void optimizeVertexFetch(MeshData& mesh)
+{
+    std::vector<Uint32> remap(mesh.positions.size(), kNone);
+    std::vector<glm::vec3> positions;
+    positions.reserve(mesh.positions.size());
+
+    for (Uint32& index : mesh.indices)
+    {
+        if (remap[index] == kNone)
+        {
+            remap[index] = (Uint32)positions.size();
+            positions.push_back(mesh.positions[index]);
+        }
+        index = remap[index];
+    }
+
+    // Vertices no triangle uses are dropped
+    mesh.positions.swap(positions);
+}
+
+VertexCacheStats analyzeVertexCache(const Uint32* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+
+    // A vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+    std::vector<Uint32> stamps(vertexCount, 0);
+    std::vector<Uint8> used(vertexCount, 0);
+    Uint32 time = cacheSize + 1;
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        Uint32 v = indices[i];
+        if (time - stamps[v] > (Uint32)cacheSize)
+        {
+            stamps[v] = time++;
+            misses++;
+        }
+        if (!used[v])
+        {
+            used[v] = 1;
+            uniqueVertices++;
+        }
+    }
+
+    stats.acmr = (float)misses / (float)(indexCount / 3);
+    stats.atvr = (float)misses / (float)uniqueVertices;
+    return stats;
+}
+
+GLenum packIndices(const std::vector<Uint32>& indices, size_t vertexCount, std::vector<Uint8>& out)
+{
+    if (vertexCount <= 0xFFFF)
+    {
+        out.resize(indices.size() * sizeof(Uint16));
+        Uint16* narrow = (Uint16*)out.data();
+        for (size_t i = 0; i < indices.size(); ++i)
+            narrow[i] = (Uint16)indices[i];
+        return GL_UNSIGNED_SHORT;
+    }
+
+    out.resize(indices.size() * sizeof(Uint32));
+    memcpy(out.data(), indices.data(), out.size());
+    return GL_UNSIGNED_INT;
+}
+
+GLsizei indexSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
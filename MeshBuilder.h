@@ -0,0 +1,64 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+//An indexed triangle list
+struct MeshData
+{
+    std::vector<glm::vec3> positions;
+    std::vector<Uint32> indices;
+};
+
+//Post-transform vertex cache behaviour of an index buffer
+struct VertexCacheStats
+{
+    //Vertex shader runs per triangle, 0.5 is the ideal for large regular meshes and 3 the worst case
+    float acmr = 0.0f;
+
+    //Vertex shader runs per unique vertex, 1 means every vertex is transformed exactly once
+    float atvr = 0.0f;
+};
+
+//What buildMesh did, "before" is the welded mesh in its original triangle order
+struct MeshBuildReport
+{
+    size_t inputVertices = 0;
+    size_t outputVertices = 0;
+    size_t triangles = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+/**
+ * Indexed mesh construction.
+ *
+ * buildMesh() runs the whole pipeline on an unindexed triangle soup:
+ * weldVertices, optimizeVertexCache (Forsyth's linear-speed algorithm),
+ * optimizeOverdraw (Tipsify-style cluster sort that may not worsen ACMR by
+ * more than the threshold) and optimizeVertexFetch. Each stage can also be
+ * used on its own.
+ */
+MeshData buildMesh(const glm::vec3* soup, size_t vertexCount, MeshBuildReport* report = nullptr);
+
+//Merges vertices with identical positions, triangles keep their order and winding
+MeshData weldVertices(const glm::vec3* soup, size_t vertexCount);
+
+//Reorders triangles so consecutive ones share vertices still in the post-transform cache
+void optimizeVertexCache(std::vector<Uint32>& indices, size_t vertexCount);
+
+//Draws outward-facing triangle clusters first, keeps the new order only if ACMR grows by less than threshold
+void optimizeOverdraw(std::vector<Uint32>& indices, const std::vector<glm::vec3>& positions, float threshold = 1.05f);
+
+//Renumbers vertices in the order the index buffer first uses them
+void optimizeVertexFetch(MeshData& mesh);
+
+//Simulates a FIFO post-transform cache of cacheSize entries
+VertexCacheStats analyzeVertexCache(const Uint32* indices, size_t indexCount, size_t vertexCount, int cacheSize = 16);
+
+//Narrows indices to 16 bits when every vertex fits, returns GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+GLenum packIndices(const std::vector<Uint32>& indices, size_t vertexCount, std::vector<Uint8>& out);
+
+//Size in bytes of GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+GLsizei indexSize(GLenum indexType);
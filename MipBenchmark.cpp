@@ -0,0 +1,217 @@
+#include "BenchmarkCommon.h"
+#include "MipGenerator.h"
+#include <SDL3_image/SDL_image.h>
+#include <string>
+
+using namespace bench;
+
+namespace
+{
+    struct Image
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<Uint8> pixels;
+    };
+
+    bool loadImage(const char* path, Image& image)
+    {
+        SDL_Surface* decoded = IMG_Load(path);
+        SDL_Surface* rgba = decoded ? SDL_ConvertSurface(decoded, SDL_PIXELFORMAT_RGBA32) : nullptr;
+        SDL_DestroySurface(decoded);
+        if (!rgba)
+            return false;
+
+        image.width = rgba->w;
+        image.height = rgba->h;
+        image.pixels.resize((size_t)image.width * image.height * 4);
+        for (int y = 0; y < image.height; ++y)
+            memcpy(image.pixels.data() + (size_t)y * image.width * 4, (const Uint8*)rgba->pixels + (size_t)rgba->pitch * y, (size_t)image.width * 4);
+        SDL_DestroySurface(rgba);
+        return true;
+    }
+
+    //Gradients, noise, hard edges and an alpha ramp, the things mip filters get wrong
+    Image makeTestImage(int size)
+    {
+        Image image;
+        image.width = size;
+        image.height = size;
+        image.pixels.resize((size_t)size * size * 4);
+
+        Uint32 state = 0x12345678u;
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                state = state * 1664525u + 1013904223u;
+                Uint8* p = image.pixels.data() + ((size_t)y * size + x) * 4;
+                p[0] = (Uint8)(x * 255 / size);
+                p[1] = ((x / 8 + y / 8) & 1) ? 255 : 0;
+                p[2] = (Uint8)(state >> 24);
+                p[3] = (Uint8)(y < size / 2 ? 255 : (x * 2 * 255 / size) & 0xFF);
+            }
+        }
+        return image;
+    }
+
+    Image makeUniformImage(int width, int height, const Uint8 texel[4])
+    {
+        Image image;
+        image.width = width;
+        image.height = height;
+        for (int i = 0; i < width * height; ++i)
+            image.pixels.insert(image.pixels.end(), texel, texel + 4);
+        return image;
+    }
+
+    //Largest per-channel difference over every level of two chains of the same image
+    int maxDifference(const MipChain& a, const MipChain& b, size_t& differing)
+    {
+        int worst = 0;
+        differing = 0;
+        for (size_t i = 0; i < a.pixels.size() && i < b.pixels.size(); ++i)
+        {
+            int difference = std::abs((int)a.pixels[i] - (int)b.pixels[i]);
+            worst = std::max(worst, difference);
+            differing += difference != 0;
+        }
+        return a.pixels.size() == b.pixels.size() ? worst : 255;
+    }
+
+    struct Check
+    {
+        const char* name;
+        bool passed;
+    };
+
+    //Known answers for the cases the generator exists to get right
+    std::vector<Check> runChecks()
+    {
+        std::vector<Check> checks;
+        MipChain chain;
+
+        // A flat colour must stay flat through every level and both filters
+        const Uint8 flat[4] = { 200, 100, 50, 128 };
+        Image uniform = makeUniformImage(37, 20, flat);
+        for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+        {
+            MipOptions options;
+            options.filter = filter;
+            generateMipChain(uniform.pixels.data(), uniform.width, uniform.height, options, chain);
+            bool passed = chain.levels.size() == (size_t)mipLevelCount(uniform.width, uniform.height);
+            for (size_t i = 0; i < chain.pixels.size() && passed; ++i)
+                passed = std::abs((int)chain.pixels[i] - (int)flat[i % 4]) <= 1;
+            checks.push_back({ filter == MipFilter::Box ? "flat_colour_box" : "flat_colour_kaiser", passed });
+        }
+
+        // Black and white average to linear 0.5, which is sRGB 188 and not 128
+        const Uint8 checker[16] = { 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0, 0, 0, 255 };
+        MipOptions options;
+        generateMipChain(checker, 2, 2, options, chain);
+        checks.push_back({ "srgb_average", chain.level(1)[0] == 188 && chain.level(1)[3] == 255 });
+        options.srgb = false;
+        generateMipChain(checker, 2, 2, options, chain);
+        checks.push_back({ "unorm_average", chain.level(1)[0] == 128 });
+
+        // Colour under zero alpha must not bleed into the visible texel
+        const Uint8 fringe[16] = { 255, 0, 0, 255, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0 };
+        options = MipOptions();
+        generateMipChain(fringe, 2, 2, options, chain);
+        const Uint8* bottom = chain.level(1);
+        checks.push_back({ "straight_alpha_no_bleed", bottom[0] == 255 && bottom[1] == 0 && bottom[2] == 0 && bottom[3] == 64 });
+
+        // Premultiplied sources keep their colour scaled by alpha
+        const Uint8 premultiplied[16] = { 128, 0, 0, 128, 128, 0, 0, 128, 0, 0, 0, 0, 0, 0, 0, 0 };
+        options.alpha = MipAlpha::Premultiplied;
+        options.srgb = false;
+        generateMipChain(premultiplied, 2, 2, options, chain);
+        checks.push_back({ "premultiplied_alpha", chain.level(1)[0] == 64 && chain.level(1)[3] == 64 });
+
+        return checks;
+    }
+
+    void dumpChain(const char* prefix, const char* filter, const MipChain& chain)
+    {
+        for (size_t i = 0; i < chain.levels.size(); ++i)
+        {
+            const MipLevel& level = chain.levels[i];
+            SDL_Surface* surface = SDL_CreateSurfaceFrom(level.width, level.height, SDL_PIXELFORMAT_RGBA32,
+                (void*)chain.level(i), level.width * 4);
+            std::string path = std::string(prefix) + "_" + filter + "_" + std::to_string(i) + ".bmp";
+            if (!surface || !SDL_SaveBMP(surface, path.c_str()))
+                SDL_Log("Unable to write %s: %s\n", path.c_str(), SDL_GetError());
+            SDL_DestroySurface(surface);
+        }
+    }
+}
+
+int runMipBenchmark(int argc, char* args[])
+{
+    const char* outPath = findArg(argc, args, "--out");
+    const char* imagePath = findArg(argc, args, "--image");
+    const char* dumpPrefix = findArg(argc, args, "--dump");
+    const int size = std::max(1, intArg(argc, args, "--size", 1024));
+    const int runs = std::max(1, intArg(argc, args, "--runs", 5));
+
+    Image image;
+    if (imagePath && !loadImage(imagePath, image))
+    {
+        SDL_Log("Unable to load %s: %s\n", imagePath, SDL_GetError());
+        return 1;
+    }
+    if (!imagePath)
+        image = makeTestImage(size);
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        return 1;
+    }
+
+    int exitCode = 0;
+    std::vector<Check> checks = runChecks();
+
+    fprintf(out, "{\n  \"benchmark\": \"mips\",\n  \"path\": \"%s\",\n  \"image\": ", mipGeneratorPath());
+    writeJsonString(out, imagePath ? imagePath : "generated");
+    fprintf(out, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"levels\": %d,\n  \"checks\": {", image.width, image.height, mipLevelCount(image.width, image.height));
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        fprintf(out, "%s\"%s\": %s", i ? ", " : "", checks[i].name, checks[i].passed ? "true" : "false");
+        if (!checks[i].passed)
+            exitCode = 1;
+    }
+    fprintf(out, "},\n  \"results\": [\n");
+
+    const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser };
+    const double megapixels = (double)image.width * image.height / 1e6;
+    for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); ++f)
+    {
+        MipOptions options;
+        options.filter = filters[f];
+        const char* name = filters[f] == MipFilter::Box ? "box" : "kaiser";
+
+        MipChain reference, simd;
+        double referenceMs = bestMs(runs, [&] { generateMipChainReference(image.pixels.data(), image.width, image.height, options, reference); });
+        double simdMs = bestMs(runs, [&] { generateMipChain(image.pixels.data(), image.width, image.height, options, simd); });
+
+        // Table-based sRGB and fused multiply-adds may round differently, by at most one step
+        size_t differing = 0;
+        int worst = maxDifference(reference, simd, differing);
+        if (worst > 1)
+            exitCode = 1;
+
+        if (dumpPrefix)
+            dumpChain(dumpPrefix, name, simd);
+
+        fprintf(out, "    {\"filter\": \"%s\", \"reference_ms\": %.3f, \"simd_ms\": %.3f, \"speedup\": %.2f, \"simd_mpixels_per_sec\": %.1f, \"max_abs_diff\": %d, \"differing_bytes\": %zu}%s\n",
+            name, referenceMs, simdMs, referenceMs / std::max(simdMs, 1e-9), megapixels / std::max(simdMs / 1000.0, 1e-9),
+            worst, differing, f + 1 < sizeof(filters) / sizeof(filters[0]) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+    return exitCode;
+}
@@ -0,0 +1,471 @@
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define MIP_GENERATOR_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE 1
+#endif
+
+#if defined(MIP_GENERATOR_SSE) || defined(MIP_GENERATOR_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    const int kKaiserTaps = 8;
+
+    //Linear values are quantized to 16 bits before the sRGB table, fine enough to stay within 1/255 near black
+    const int kEncodeSize = 1 << 16;
+
+    float srgbToLinear(float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float c)
+    {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    struct ConversionTables
+    {
+        float srgbToLinear[256];
+        float unormToFloat[256];
+        Uint8 linearToSrgb[kEncodeSize];
+    };
+
+    const ConversionTables& conversionTables()
+    {
+        static ConversionTables tables;
+        static const bool built = [] {
+            for (int i = 0; i < 256; ++i)
+            {
+                tables.unormToFloat[i] = (float)i / 255.0f;
+                tables.srgbToLinear[i] = srgbToLinear((float)i / 255.0f);
+            }
+            for (int i = 0; i < kEncodeSize; ++i)
+                tables.linearToSrgb[i] = (Uint8)(linearToSrgb((float)i / (float)(kEncodeSize - 1)) * 255.0f + 0.5f);
+            return true;
+        }();
+        (void)built;
+        return tables;
+    }
+
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    //Weights of the source texels 2x-3 .. 2x+4 for destination texel x, a half-band sinc under a Kaiser window
+    struct KaiserKernel
+    {
+        float weights[kKaiserTaps];
+    };
+
+    KaiserKernel makeKaiserKernel()
+    {
+        const double pi = 3.14159265358979323846;
+        const double alpha = 4.0;
+        const double halfWidth = kKaiserTaps / 2;
+
+        double weights[kKaiserTaps];
+        double sum = 0.0;
+        for (int k = 0; k < kKaiserTaps; ++k)
+        {
+            // Source texel centres sit half a texel off the destination centre
+            double t = k - (kKaiserTaps - 1) * 0.5;
+            double x = t * 0.5;
+            double sinc = std::sin(pi * x) / (pi * x);
+            double r = t / halfWidth;
+            weights[k] = sinc * besselI0(alpha * std::sqrt(1.0 - r * r)) / besselI0(alpha);
+            sum += weights[k];
+        }
+
+        KaiserKernel kernel;
+        for (int k = 0; k < kKaiserTaps; ++k)
+            kernel.weights[k] = (float)(weights[k] / sum);
+        return kernel;
+    }
+
+    const KaiserKernel& kaiserKernel()
+    {
+        static const KaiserKernel kernel = makeKaiserKernel();
+        return kernel;
+    }
+
+    int clampIndex(int index, int size)
+    {
+        return std::clamp(index, 0, size - 1);
+    }
+
+    //Stages of the chain, the reference and SIMD versions fill one each
+    struct MipKernels
+    {
+        void (*decode)(const Uint8* in, size_t count, const MipOptions& options, float* out);
+        void (*encode)(const float* in, size_t count, const MipOptions& options, Uint8* out);
+        void (*box)(const float* src, int sw, int sh, float* dst, int dw, int dh);
+        void (*kaiser)(const float* src, int sw, int sh, float* dst, int dw, int dh, std::vector<float>& temp);
+    };
+
+    void decodeReference(const Uint8* in, size_t count, const MipOptions& options, float* out)
+    {
+        for (size_t i = 0; i < count; ++i, in += 4, out += 4)
+        {
+            float alpha = in[3] / 255.0f;
+            for (int c = 0; c < 3; ++c)
+            {
+                float value = in[c] / 255.0f;
+                if (options.srgb)
+                    value = srgbToLinear(value);
+                if (options.alpha == MipAlpha::Straight)
+                    value *= alpha;
+                out[c] = value;
+            }
+            out[3] = alpha;
+        }
+    }
+
+    void encodeReference(const float* in, size_t count, const MipOptions& options, Uint8* out)
+    {
+        for (size_t i = 0; i < count; ++i, in += 4, out += 4)
+        {
+            // Ringing of the Kaiser filter can push colour past alpha, which no premultiplied texel can hold
+            float alpha = std::clamp(in[3], 0.0f, 1.0f);
+            for (int c = 0; c < 3; ++c)
+            {
+                float value = std::clamp(in[c], 0.0f, alpha);
+                if (options.alpha == MipAlpha::Straight)
+                    value = alpha > 0.0f ? value / alpha : 0.0f;
+                if (options.srgb)
+                    value = linearToSrgb(value);
+                out[c] = (Uint8)(value * 255.0f + 0.5f);
+            }
+            out[3] = (Uint8)(alpha * 255.0f + 0.5f);
+        }
+    }
+
+    void boxReference(const float* src, int sw, int sh, float* dst, int dw, int dh)
+    {
+        for (int y = 0; y < dh; ++y)
+        {
+            const float* row0 = src + (size_t)(2 * y) * sw * 4;
+            const float* row1 = src + (size_t)std::min(2 * y + 1, sh - 1) * sw * 4;
+            for (int x = 0; x < dw; ++x)
+            {
+                int x0 = 2 * x, x1 = std::min(2 * x + 1, sw - 1);
+                for (int c = 0; c < 4; ++c)
+                    dst[((size_t)y * dw + x) * 4 + c] = 0.25f * (row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c]);
+            }
+        }
+    }
+
+    void kaiserReference(const float* src, int sw, int sh, float* dst, int dw, int dh, std::vector<float>& temp)
+    {
+        const KaiserKernel& kernel = kaiserKernel();
+        temp.assign((size_t)dw * sh * 4, 0.0f);
+
+        for (int y = 0; y < sh; ++y)
+        {
+            for (int x = 0; x < dw; ++x)
+            {
+                float* out = temp.data() + ((size_t)y * dw + x) * 4;
+                for (int k = 0; k < kKaiserTaps; ++k)
+                {
+                    const float* texel = src + ((size_t)y * sw + clampIndex(2 * x - 3 + k, sw)) * 4;
+                    for (int c = 0; c < 4; ++c)
+                        out[c] += kernel.weights[k] * texel[c];
+                }
+            }
+        }
+
+        for (int y = 0; y < dh; ++y)
+        {
+            for (int x = 0; x < dw; ++x)
+            {
+                float* out = dst + ((size_t)y * dw + x) * 4;
+                for (int c = 0; c < 4; ++c)
+                    out[c] = 0.0f;
+                for (int k = 0; k < kKaiserTaps; ++k)
+                {
+                    const float* texel = temp.data() + ((size_t)clampIndex(2 * y - 3 + k, sh) * dw + x) * 4;
+                    for (int c = 0; c < 4; ++c)
+                        out[c] += kernel.weights[k] * texel[c];
+                }
+            }
+        }
+    }
+
+#if defined(MIP_GENERATOR_SSE)
+    inline __m128 madd(__m128 a, __m128 b, __m128 c)
+    {
+#if defined(__FMA__)
+        return _mm_fmadd_ps(a, b, c);
+#else
+        return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+    }
+
+#if defined(MIP_GENERATOR_AVX2)
+    inline __m256 madd(__m256 a, __m256 b, __m256 c)
+    {
+#if defined(__FMA__)
+        return _mm256_fmadd_ps(a, b, c);
+#else
+        return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+    }
+#endif
+
+    //One texel per __m128, the byte to float conversions go through tables
+    void decodeSimd(const Uint8* in, size_t count, const MipOptions& options, float* out)
+    {
+        const ConversionTables& tables = conversionTables();
+        const float* colour = options.srgb ? tables.srgbToLinear : tables.unormToFloat;
+        for (size_t i = 0; i < count; ++i, in += 4, out += 4)
+        {
+            float alpha = tables.unormToFloat[in[3]];
+            if (options.alpha == MipAlpha::Straight)
+                _mm_storeu_ps(out, _mm_mul_ps(_mm_setr_ps(colour[in[0]], colour[in[1]], colour[in[2]], 1.0f), _mm_set1_ps(alpha)));
+            else
+                _mm_storeu_ps(out, _mm_setr_ps(colour[in[0]], colour[in[1]], colour[in[2]], alpha));
+        }
+    }
+
+    void encodeSimd(const float* in, size_t count, const MipOptions& options, Uint8* out)
+    {
+        const ConversionTables& tables = conversionTables();
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 alphaLane = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+        const float colourScale = options.srgb ? (float)(kEncodeSize - 1) : 255.0f;
+        const __m128 scale = _mm_setr_ps(colourScale, colourScale, colourScale, 255.0f);
+        const bool straight = options.alpha == MipAlpha::Straight;
+
+        alignas(16) Sint32 quantized[4];
+        for (size_t i = 0; i < count; ++i, in += 4, out += 4)
+        {
+            __m128 texel = _mm_loadu_ps(in);
+            __m128 alpha = _mm_min_ps(_mm_max_ps(_mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 3, 3, 3)), zero), one);
+            texel = _mm_min_ps(_mm_max_ps(texel, zero), alpha);
+            if (straight)
+            {
+                // Zero alpha gives an infinite reciprocal that the mask turns into black
+                __m128 reciprocal = _mm_and_ps(_mm_cmpgt_ps(alpha, zero), _mm_div_ps(one, alpha));
+                texel = _mm_or_ps(_mm_and_ps(alphaLane, alpha), _mm_andnot_ps(alphaLane, _mm_mul_ps(texel, reciprocal)));
+            }
+            _mm_store_si128((__m128i*)quantized, _mm_cvtps_epi32(_mm_mul_ps(texel, scale)));
+
+            if (options.srgb)
+            {
+                out[0] = tables.linearToSrgb[quantized[0]];
+                out[1] = tables.linearToSrgb[quantized[1]];
+                out[2] = tables.linearToSrgb[quantized[2]];
+            }
+            else
+            {
+                out[0] = (Uint8)quantized[0];
+                out[1] = (Uint8)quantized[1];
+                out[2] = (Uint8)quantized[2];
+            }
+            out[3] = (Uint8)quantized[3];
+        }
+    }
+
+    void boxSimd(const float* src, int sw, int sh, float* dst, int dw, int dh)
+    {
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        for (int y = 0; y < dh; ++y)
+        {
+            const float* row0 = src + (size_t)(2 * y) * sw * 4;
+            const float* row1 = src + (size_t)std::min(2 * y + 1, sh - 1) * sw * 4;
+            float* out = dst + (size_t)y * dw * 4;
+
+            int x = 0;
+#if defined(MIP_GENERATOR_AVX2)
+            //Two destination texels per step: add the rows, then pair up the even and odd source texels
+            const __m256 quarter8 = _mm256_set1_ps(0.25f);
+            for (; x + 2 <= dw && 2 * x + 3 < sw; x += 2)
+            {
+                __m256 sum01 = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * x), _mm256_loadu_ps(row1 + 8 * x));
+                __m256 sum23 = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * x + 8), _mm256_loadu_ps(row1 + 8 * x + 8));
+                __m256 even = _mm256_permute2f128_ps(sum01, sum23, 0x20);
+                __m256 odd = _mm256_permute2f128_ps(sum01, sum23, 0x31);
+                _mm256_storeu_ps(out + 4 * x, _mm256_mul_ps(_mm256_add_ps(even, odd), quarter8));
+            }
+#endif
+            for (; x < dw; ++x)
+            {
+                int x0 = 2 * x, x1 = std::min(2 * x + 1, sw - 1);
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0 * 4), _mm_loadu_ps(row0 + x1 * 4)),
+                    _mm_add_ps(_mm_loadu_ps(row1 + x0 * 4), _mm_loadu_ps(row1 + x1 * 4)));
+                _mm_storeu_ps(out + 4 * x, _mm_mul_ps(sum, quarter));
+            }
+        }
+    }
+
+    void kaiserSimd(const float* src, int sw, int sh, float* dst, int dw, int dh, std::vector<float>& temp)
+    {
+        const KaiserKernel& kernel = kaiserKernel();
+        temp.resize((size_t)dw * sh * 4);
+
+        __m128 weights[kKaiserTaps];
+        for (int k = 0; k < kKaiserTaps; ++k)
+            weights[k] = _mm_set1_ps(kernel.weights[k]);
+#if defined(MIP_GENERATOR_AVX2)
+        __m256 weights8[kKaiserTaps];
+        for (int k = 0; k < kKaiserTaps; ++k)
+            weights8[k] = _mm256_set1_ps(kernel.weights[k]);
+#endif
+
+        // Horizontal pass, every source row into temp
+        for (int y = 0; y < sh; ++y)
+        {
+            const float* row = src + (size_t)y * sw * 4;
+            float* out = temp.data() + (size_t)y * dw * 4;
+
+            int x = 0;
+            while (x < dw)
+            {
+#if defined(MIP_GENERATOR_AVX2)
+                //Away from the edges two destination texels go together, their taps sit two texels apart
+                if (x + 2 <= dw && 2 * x >= 3 && 2 * x + 6 < sw)
+                {
+                    const float* first = row + (size_t)(2 * x - 3) * 4;
+                    __m256 sum = _mm256_setzero_ps();
+                    for (int k = 0; k < kKaiserTaps; ++k)
+                        sum = madd(weights8[k], _mm256_loadu2_m128(first + (k + 2) * 4, first + k * 4), sum);
+                    _mm256_storeu_ps(out + 4 * x, sum);
+                    x += 2;
+                    continue;
+                }
+#endif
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < kKaiserTaps; ++k)
+                    sum = madd(weights[k], _mm_loadu_ps(row + clampIndex(2 * x - 3 + k, sw) * 4), sum);
+                _mm_storeu_ps(out + 4 * x, sum);
+                ++x;
+            }
+        }
+
+        // Vertical pass, whole rows at a time so every float lane is independent
+        const size_t rowFloats = (size_t)dw * 4;
+        for (int y = 0; y < dh; ++y)
+        {
+            const float* rows[kKaiserTaps];
+            for (int k = 0; k < kKaiserTaps; ++k)
+                rows[k] = temp.data() + (size_t)clampIndex(2 * y - 3 + k, sh) * rowFloats;
+            float* out = dst + (size_t)y * rowFloats;
+
+            size_t i = 0;
+#if defined(MIP_GENERATOR_AVX2)
+            for (; i + 8 <= rowFloats; i += 8)
+            {
+                __m256 sum = _mm256_setzero_ps();
+                for (int k = 0; k < kKaiserTaps; ++k)
+                    sum = madd(weights8[k], _mm256_loadu_ps(rows[k] + i), sum);
+                _mm256_storeu_ps(out + i, sum);
+            }
+#endif
+            for (; i < rowFloats; i += 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < kKaiserTaps; ++k)
+                    sum = madd(weights[k], _mm_loadu_ps(rows[k] + i), sum);
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+    }
+#endif
+
+    void buildChain(const MipKernels& kernels, const Uint8* pixels, int width, int height, const MipOptions& options, MipChain& chain)
+    {
+        chain.levels.clear();
+        const int levelCount = mipLevelCount(width, height);
+        size_t total = 0;
+        for (int i = 0, w = width, h = height; i < levelCount; ++i)
+        {
+            MipLevel level;
+            level.width = w;
+            level.height = h;
+            level.offset = total;
+            chain.levels.push_back(level);
+            total += (size_t)w * h * 4;
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+        chain.pixels.resize(total);
+        if (!levelCount)
+            return;
+
+        // Level 0 is the source as is, only the smaller levels go through the float round trip
+        memcpy(chain.pixels.data(), pixels, chain.levelSize(0));
+
+        std::vector<float> current((size_t)width * height * 4), next, temp;
+        kernels.decode(pixels, (size_t)width * height, options, current.data());
+        for (int i = 1; i < levelCount; ++i)
+        {
+            const MipLevel& above = chain.levels[i - 1];
+            const MipLevel& level = chain.levels[i];
+            next.resize((size_t)level.width * level.height * 4);
+            if (options.filter == MipFilter::Kaiser)
+                kernels.kaiser(current.data(), above.width, above.height, next.data(), level.width, level.height, temp);
+            else
+                kernels.box(current.data(), above.width, above.height, next.data(), level.width, level.height);
+            kernels.encode(next.data(), (size_t)level.width * level.height, options, chain.pixels.data() + level.offset);
+            current.swap(next);
+        }
+    }
+}
+
+void generateMipChain(const Uint8* pixels, int width, int height, const MipOptions& options, MipChain& chain)
+{
+#if defined(MIP_GENERATOR_SSE)
+    static const MipKernels kernels = { decodeSimd, encodeSimd, boxSimd, kaiserSimd };
+#else
+    static const MipKernels kernels = { decodeReference, encodeReference, boxReference, kaiserReference };
+#endif
+    buildChain(kernels, pixels, width, height, options, chain);
+}
+
+void generateMipChainReference(const Uint8* pixels, int width, int height, const MipOptions& options, MipChain& chain)
+{
+    static const MipKernels kernels = { decodeReference, encodeReference, boxReference, kaiserReference };
+    buildChain(kernels, pixels, width, height, options, chain);
+}
+
+int mipLevelCount(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return 0;
+
+    int count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        count++;
+    }
+    return count;
+}
+
+const char* mipGeneratorPath()
+{
+#if defined(MIP_GENERATOR_AVX2)
+    return "avx2";
+#elif defined(MIP_GENERATOR_SSE)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <vector>
+
+enum class MipFilter
+{
+    //2x2 average, cheap and slightly blurry
+    Box,
+
+    //8-tap Kaiser-windowed sinc, keeps more detail in the smaller levels
+    Kaiser
+};
+
+//How the source stores alpha
+enum class MipAlpha
+{
+    //Colour is weighted by alpha while filtering so transparent texels do not bleed into their neighbours
+    Straight,
+    Premultiplied
+};
+
+struct MipOptions
+{
+    MipFilter filter = MipFilter::Box;
+    MipAlpha alpha = MipAlpha::Straight;
+
+    //Colour channels are sRGB encoded and are filtered as linear values, alpha is always linear
+    bool srgb = true;
+};
+
+struct MipLevel
+{
+    int width = 0;
+    int height = 0;
+    size_t offset = 0;
+};
+
+//Every level of an RGBA8 image down to 1x1, level 0 first, rows packed without padding
+struct MipChain
+{
+    std::vector<MipLevel> levels;
+    std::vector<Uint8> pixels;
+
+    const Uint8* level(size_t index) const { return pixels.data() + levels[index].offset; }
+    size_t levelSize(size_t index) const { return (size_t)levels[index].width * levels[index].height * 4; }
+};
+
+/**
+ * Builds a full mip chain on the CPU so textures never wait on
+ * glGenerateMipmap.
+ *
+ * Level 0 is decoded once to linear float RGBA (premultiplied unless the
+ * source already is), each level is filtered from the one above it, and
+ * every level is converted back to sRGB RGBA8. The filters run on AVX2
+ * (two texels per step) or SSE2 (one texel per step) when the compiler
+ * targets them, like AffineMath; sRGB conversion uses tables. Each level
+ * halves its size rounding down, so odd sizes drop their last row or
+ * column. Safe to call from worker threads.
+ */
+void generateMipChain(const Uint8* pixels, int width, int height, const MipOptions& options, MipChain& chain);
+
+//Plain scalar version using powf for sRGB, the reference generateMipChain is checked against
+void generateMipChainReference(const Uint8* pixels, int width, int height, const MipOptions& options, MipChain& chain);
+
+int mipLevelCount(int width, int height);
+
+//Name of the instruction set generateMipChain was compiled for
+const char* mipGeneratorPath();
@@ -0,0 +1,315 @@
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //Events kept per thread, must be a power of two
+    const Uint64 kRingCapacity = 1ull << 16;
+
+    //Frames between GPU/CPU clock recalibrations
+    const Uint64 kCalibrationInterval = 256;
+
+    struct ZoneEvent
+    {
+        const char* name;
+        Uint64 start;
+        Uint64 end;
+        Uint32 depth;
+    };
+
+    //Single-producer ring, only the owning thread writes events and head
+    struct ZoneRing
+    {
+        ZoneEvent events[kRingCapacity];
+        std::atomic<Uint64> head{ 0 };
+        Uint32 depth = 0;
+        int threadId = 0;
+        std::string name;
+    };
+
+    struct GpuQuery
+    {
+        GLuint timestamp = 0;
+        GLuint elapsed = 0;
+        const char* name = nullptr;
+    };
+
+    struct GpuQueryFrame
+    {
+        std::vector<GpuQuery> queries;
+        size_t used = 0;
+    };
+
+    //Registry lock is only taken when a thread records its first zone and when dumping
+    std::mutex gRegistryMutex;
+    std::vector<std::unique_ptr<ZoneRing>> gRings;
+
+    ZoneRing* gGpuRing = nullptr;
+    GpuQueryFrame gGpuFrames[2];
+    Uint64 gGpuFrameIndex = 0;
+    Sint64 gGpuToCpuOffsetNs = 0;
+    Uint64 gGpuDropped = 0;
+    bool gGpuReady = false;
+    bool gGpuZoneOpen = false;
+
+    ZoneRing* registerRing(const char* name)
+    {
+        // Rings live as long as the process, not as long as the subsystem that happened to profile first on the thread
+        MemoryTagScope memoryTag(MemoryTag::Untagged);
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        gRings.push_back(std::make_unique<ZoneRing>());
+        ZoneRing* ring = gRings.back().get();
+        ring->threadId = (int)gRings.size();
+        ring->name = name;
+        return ring;
+    }
+
+    ZoneRing& threadRing()
+    {
+        thread_local ZoneRing* ring = registerRing("Thread");
+        return *ring;
+    }
+
+    void pushEvent(ZoneRing& ring, const char* name, Uint64 start, Uint64 end, Uint32 depth)
+    {
+        Uint64 head = ring.head.load(std::memory_order_relaxed);
+        ring.events[head & (kRingCapacity - 1)] = { name, start, end, depth };
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    Uint64 ticksToNs(Uint64 ticks)
+    {
+        const Uint64 frequency = SDL_GetPerformanceFrequency();
+        return (ticks / frequency) * 1000000000ull + (ticks % frequency) * 1000000000ull / frequency;
+    }
+
+    Uint64 nsToTicks(Uint64 ns)
+    {
+        const Uint64 frequency = SDL_GetPerformanceFrequency();
+        return (ns / 1000000000ull) * frequency + (ns % 1000000000ull) * frequency / 1000000000ull;
+    }
+
+    void calibrateGpuClock()
+    {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        gGpuToCpuOffsetNs = (Sint64)ticksToNs(SDL_GetPerformanceCounter()) - (Sint64)gpuNow;
+    }
+
+    void resolveGpuFrame(GpuQueryFrame& frame)
+    {
+        for (size_t i = 0; i < frame.used; ++i)
+        {
+            const GpuQuery& query = frame.queries[i];
+
+            //Never wait on the GPU, late results are dropped
+            GLint available = 0;
+            glGetQueryObjectiv(query.elapsed, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                gGpuDropped++;
+                continue;
+            }
+
+            GLuint64 startNs = 0;
+            GLuint64 elapsedNs = 0;
+            glGetQueryObjectui64v(query.timestamp, GL_QUERY_RESULT, &startNs);
+            glGetQueryObjectui64v(query.elapsed, GL_QUERY_RESULT, &elapsedNs);
+
+            Uint64 start = nsToTicks((Uint64)((Sint64)startNs + gGpuToCpuOffsetNs));
+            pushEvent(*gGpuRing, query.name, start, start + nsToTicks(elapsedNs), 0);
+        }
+        frame.used = 0;
+    }
+
+    //Copies the events that were not overwritten while reading
+    std::vector<ZoneEvent> snapshotRing(const ZoneRing& ring)
+    {
+        Uint64 head = ring.head.load(std::memory_order_acquire);
+        Uint64 first = head > kRingCapacity ? head - kRingCapacity : 0;
+
+        std::vector<ZoneEvent> events;
+        events.reserve((size_t)(head - first));
+        for (Uint64 i = first; i < head; ++i)
+            events.push_back(ring.events[i & (kRingCapacity - 1)]);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        Uint64 headAfter = ring.head.load(std::memory_order_relaxed);
+        Uint64 firstValid = headAfter >= kRingCapacity ? headAfter - kRingCapacity + 1 : 0;
+        if (firstValid > first)
+            events.erase(events.begin(), events.begin() + (size_t)std::min(firstValid - first, (Uint64)events.size()));
+        return events;
+    }
+
+    void writeJsonString(FILE* out, const char* text)
+    {
+        fputc('"', out);
+        for (const char* c = text ? text : ""; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                fprintf(out, "\\%c", *c);
+            else if ((unsigned char)*c < 0x20)
+                fprintf(out, "\\u%04x", (unsigned char)*c);
+            else
+                fputc(*c, out);
+        }
+        fputc('"', out);
+    }
+}
+
+void profilerInit()
+{
+    if (!gGpuRing)
+        gGpuRing = registerRing("GPU");
+
+    calibrateGpuClock();
+    gGpuFrameIndex = 0;
+    gGpuReady = true;
+}
+
+void profilerShutdown()
+{
+    for (GpuQueryFrame& frame : gGpuFrames)
+    {
+        for (GpuQuery& query : frame.queries)
+        {
+            glDeleteQueries(1, &query.timestamp);
+            glDeleteQueries(1, &query.elapsed);
+        }
+        std::vector<GpuQuery>().swap(frame.queries);
+        frame.used = 0;
+    }
+    gGpuReady = false;
+}
+
+void profilerBeginFrame()
+{
+    if (!gGpuReady)
+        return;
+
+    gGpuFrameIndex++;
+    if (gGpuFrameIndex % kCalibrationInterval == 0)
+        calibrateGpuClock();
+
+    //This set was filled two frames ago
+    resolveGpuFrame(gGpuFrames[gGpuFrameIndex & 1]);
+}
+
+void profilerSetThreadName(const char* name)
+{
+    ZoneRing& ring = threadRing();
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    ring.name = name;
+}
+
+bool profilerWriteChromeTrace(const char* path)
+{
+    FILE* out = fopen(path, "w");
+    if (!out)
+    {
+        SDL_Log("Unable to open trace file %s\n", path);
+        return false;
+    }
+
+    struct Track
+    {
+        int threadId;
+        std::string name;
+        std::vector<ZoneEvent> events;
+    };
+
+    std::vector<Track> tracks;
+    {
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        for (const std::unique_ptr<ZoneRing>& ring : gRings)
+            tracks.push_back({ ring->threadId, ring->name, snapshotRing(*ring) });
+    }
+
+    Uint64 epoch = ~0ull;
+    for (const Track& track : tracks)
+    {
+        for (const ZoneEvent& event : track.events)
+            epoch = std::min(epoch, event.start);
+    }
+
+    const double usPerTick = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+    bool first = true;
+    fprintf(out, "{\"traceEvents\":[\n");
+    for (const Track& track : tracks)
+    {
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", track.threadId);
+        writeJsonString(out, track.name.c_str());
+        fprintf(out, "}}");
+        first = false;
+
+        for (const ZoneEvent& event : track.events)
+        {
+            fprintf(out, ",\n{\"name\":");
+            writeJsonString(out, event.name);
+            fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+                track.name == "GPU" ? "gpu" : "cpu", track.threadId,
+                (double)(event.start - epoch) * usPerTick, (double)(event.end - event.start) * usPerTick, event.depth);
+        }
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"gpuZonesDropped\":%llu}}\n", (unsigned long long)gGpuDropped);
+    fclose(out);
+
+    SDL_Log("Wrote profiler trace to %s\n", path);
+    return true;
+}
+
+ProfileZone::ProfileZone(const char* name)
+    : mName(name)
+{
+    threadRing().depth++;
+    mStart = SDL_GetPerformanceCounter();
+}
+
+ProfileZone::~ProfileZone()
+{
+    Uint64 end = SDL_GetPerformanceCounter();
+    ZoneRing& ring = threadRing();
+    ring.depth--;
+    pushEvent(ring, mName, mStart, end, ring.depth);
+}
+
+GpuProfileZone::GpuProfileZone(const char* name)
+    : mActive(false)
+{
+    //GL_TIME_ELAPSED queries cannot nest
+    if (!gGpuReady || gGpuZoneOpen)
+        return;
+
+    GpuQueryFrame& frame = gGpuFrames[gGpuFrameIndex & 1];
+    if (frame.used == frame.queries.size())
+    {
+        GpuQuery query;
+        glGenQueries(1, &query.timestamp);
+        glGenQueries(1, &query.elapsed);
+        frame.queries.push_back(query);
+    }
+
+    GpuQuery& query = frame.queries[frame.used++];
+    query.name = name;
+    glQueryCounter(query.timestamp, GL_TIMESTAMP);
+    glBeginQuery(GL_TIME_ELAPSED, query.elapsed);
+
+    gGpuZoneOpen = true;
+    mActive = true;
+}
+
+GpuProfileZone::~GpuProfileZone()
+{
+    if (!mActive)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    gGpuZoneOpen = false;
+}
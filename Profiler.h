@@ -0,0 +1,73 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+
+/**
+ * Scoped-zone frame profiler.
+ *
+ * CPU zones are written into a per-thread ring buffer owned by the thread
+ * that records them, so recording never takes a lock. GPU zones wrap draws
+ * in GL_TIME_ELAPSED queries; results are read back two frames later and
+ * dropped instead of waited on when the GPU is not done yet.
+ * Everything recorded can be written out as Chrome trace / Perfetto JSON.
+ *
+ * Define ENGINE_PROFILER to 0 to compile every zone out.
+ */
+#ifndef ENGINE_PROFILER
+#define ENGINE_PROFILER 1
+#endif
+
+//Creates the GPU timer queries, needs a current GL context
+void profilerInit();
+
+//Deletes the GPU timer queries
+void profilerShutdown();
+
+//Collects finished GPU zones and starts a new query frame, call once per frame on the GL thread
+void profilerBeginFrame();
+
+//Names the calling thread in the trace output
+void profilerSetThreadName(const char* name);
+
+//Writes every recorded zone as Chrome trace JSON
+bool profilerWriteChromeTrace(const char* path);
+
+//Records a CPU zone from construction to destruction, name must outlive the profiler
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* mName;
+    Uint64 mStart;
+};
+
+//Times the GL commands issued inside its scope, GPU zones must not nest
+class GpuProfileZone
+{
+public:
+    explicit GpuProfileZone(const char* name);
+    ~GpuProfileZone();
+
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+private:
+    bool mActive;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if ENGINE_PROFILER
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#endif
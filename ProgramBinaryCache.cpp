@@ -0,0 +1,179 @@
+#include "ProgramBinaryCache.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+ProgramBinaryCache gProgramCache;
+
+namespace
+{
+    const Uint32 kMagic = 0x4E494250; // "PBIN"
+    const Uint32 kVersion = 1;
+
+    struct EntryHeader
+    {
+        Uint32 magic;
+        Uint32 version;
+        Uint64 key;
+        Uint64 driverHash;
+        Uint64 payloadHash;
+        Uint32 format;
+        Uint32 length;
+    };
+
+    //FNV-1a, seeded with the running hash so strings can be chained
+    Uint64 hashBytes(const void* data, size_t size, Uint64 hash = 0xCBF29CE484222325ull)
+    {
+        const Uint8* bytes = (const Uint8*)data;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    Uint64 hashString(const char* text, Uint64 hash)
+    {
+        // The terminator separates consecutive strings
+        return hashBytes(text ? text : "", (text ? strlen(text) : 0) + 1, hash);
+    }
+}
+
+void ProgramBinaryCache::init(const char* directory)
+{
+    mDirectory = directory;
+    mCounters = ProgramCacheCounters();
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    mSupported = formats > 0;
+    mEnabled = mSupported;
+    if (!mSupported)
+    {
+        SDL_Log("Driver offers no program binary formats, shader cache disabled.\n");
+        return;
+    }
+
+    Uint64 hash = hashString((const char*)glGetString(GL_VENDOR), 0xCBF29CE484222325ull);
+    hash = hashString((const char*)glGetString(GL_RENDERER), hash);
+    mDriverHash = hashString((const char*)glGetString(GL_VERSION), hash);
+
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+}
+
+Uint64 ProgramBinaryCache::key(const char* const* sources, int count) const
+{
+    Uint64 hash = hashBytes(&kVersion, sizeof(kVersion));
+    for (int i = 0; i < count; ++i)
+        hash = hashString(sources[i], hash);
+    return hash;
+}
+
+std::string ProgramBinaryCache::entryPath(Uint64 key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return mDirectory + "/" + name;
+}
+
+GLuint ProgramBinaryCache::load(Uint64 key)
+{
+    if (!mEnabled)
+        return 0;
+
+    std::string path = entryPath(key);
+    MappedFile file;
+    if (!file.open(path.c_str()))
+    {
+        mCounters.misses++;
+        return 0;
+    }
+
+    // The payload goes to the driver straight from the mapping
+    EntryHeader header = {};
+    const Uint8* payload = nullptr;
+    bool valid = file.size() >= sizeof(header);
+    if (valid)
+    {
+        memcpy(&header, file.data(), sizeof(header));
+        payload = file.data() + sizeof(header);
+        valid = header.magic == kMagic && header.version == kVersion
+            && header.key == key && header.driverHash == mDriverHash
+            && header.length > 0 && file.size() - sizeof(header) == header.length
+            && hashBytes(payload, header.length) == header.payloadHash;
+    }
+
+    GLuint program = 0;
+    if (valid)
+    {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, payload, (GLsizei)header.length);
+
+        // The driver may still refuse a binary it produced, e.g. after a silent update
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    if (!program)
+    {
+        // Unmapped first, Windows refuses to delete a mapped file
+        file.close();
+        mCounters.rejected++;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return 0;
+    }
+
+    mCounters.hits++;
+    return program;
+}
+
+void ProgramBinaryCache::store(Uint64 key, GLuint program)
+{
+    if (!mEnabled)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<Uint8> payload(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, payload.data());
+    if (written <= 0)
+        return;
+    payload.resize(written);
+
+    EntryHeader header = { kMagic, kVersion, key, mDriverHash, hashBytes(payload.data(), payload.size()), format, (Uint32)written };
+
+    // Written under a temporary name so a crash never leaves a truncated entry behind
+    std::string path = entryPath(key);
+    std::string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file)
+        return;
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+    ok = fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(tempPath, path, error);
+    if (!ok || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+    mCounters.stored++;
+}
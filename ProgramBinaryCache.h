@@ -0,0 +1,57 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include <string>
+
+//Lookups since init()
+struct ProgramCacheCounters
+{
+    Uint32 hits = 0;
+    Uint32 misses = 0;
+
+    //Entries that existed but were stale, corrupt or refused by the driver
+    Uint32 rejected = 0;
+    Uint32 stored = 0;
+};
+
+/**
+ * On-disk cache of linked program binaries.
+ *
+ * Entries are keyed by a hash of the final shader sources and stamped with
+ * a hash of the GL vendor, renderer and version strings, so a driver
+ * update silently turns every entry into a miss. A loaded binary must pass
+ * the header checks, a payload checksum and GL_LINK_STATUS; anything else
+ * deletes the file and the caller compiles from source.
+ */
+class ProgramBinaryCache
+{
+public:
+    //Needs a current GL context, disables itself when the driver offers no binary formats
+    void init(const char* directory);
+
+    bool enabled() const { return mEnabled; }
+    void setEnabled(bool enabled) { mEnabled = enabled && mSupported; }
+
+    //Key of a program built from these shader sources, in stage order
+    Uint64 key(const char* const* sources, int count) const;
+
+    //Returns a linked program or 0 when the key is not cached or the entry is unusable
+    GLuint load(Uint64 key);
+
+    //Program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void store(Uint64 key, GLuint program);
+
+    const ProgramCacheCounters& counters() const { return mCounters; }
+
+private:
+    std::string entryPath(Uint64 key) const;
+
+    std::string mDirectory;
+    Uint64 mDriverHash = 0;
+    bool mSupported = false;
+    bool mEnabled = false;
+    ProgramCacheCounters mCounters;
+};
+
+//The program binary cache of the main GL context
+extern ProgramBinaryCache gProgramCache;
@@ -0,0 +1,196 @@
+#include "ProgramReflection.h"
+#include "Profiler.h"
+
+ProgramReflectionCache gProgramReflection;
+
+namespace
+{
+    const char* kindName(ParamKind kind)
+    {
+        switch (kind)
+        {
+        case ParamKind::Uniform: return "uniform";
+        case ParamKind::UniformBlock: return "uniform block";
+        case ParamKind::StorageBlock: return "storage block";
+        case ParamKind::Attribute: return "attribute";
+        }
+        return "resource";
+    }
+
+    //"colors[0]" and "colors" name the same uniform
+    std::string baseName(const char* name)
+    {
+        std::string base = name;
+        size_t bracket = base.find('[');
+        if (bracket != std::string::npos)
+            base.resize(bracket);
+        return base;
+    }
+
+    std::string resourceName(GLuint program, GLenum interface, GLuint index, GLint length)
+    {
+        std::vector<char> name(length > 0 ? length : 1);
+        glGetProgramResourceName(program, interface, index, (GLsizei)name.size(), nullptr, name.data());
+        return baseName(name.data());
+    }
+}
+
+void ProgramReflection::reflect(GLuint program)
+{
+    PROFILE_ZONE("ProgramReflection::reflect");
+
+    mTable.clear();
+    mNames.clear();
+    mCount = 0;
+
+    GLint uniforms = 0, uniformBlocks = 0, storageBlocks = 0, inputs = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniforms);
+    glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &uniformBlocks);
+    glGetProgramInterfaceiv(program, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &storageBlocks);
+    glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &inputs);
+
+    // At most half full keeps probe chains short
+    size_t capacity = 16;
+    while (capacity < 2 * (size_t)(uniforms + uniformBlocks + storageBlocks + inputs))
+        capacity *= 2;
+    mTable.assign(capacity, ProgramParam());
+    mNames.assign(capacity, std::string());
+
+    for (GLint i = 0; i < uniforms; ++i)
+    {
+        const GLenum props[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+        GLint values[5] = {};
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 5, props, 5, nullptr, values);
+
+        ProgramParam param;
+        param.kind = ParamKind::Uniform;
+        param.type = values[1];
+        param.location = values[2];
+        param.arraySize = values[3];
+        param.binding = values[4];
+        insert(resourceName(program, GL_UNIFORM, i, values[0]), param);
+    }
+
+    const GLenum blockInterfaces[] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+    const GLint blockCounts[] = { uniformBlocks, storageBlocks };
+    for (int b = 0; b < 2; ++b)
+    {
+        for (GLint i = 0; i < blockCounts[b]; ++i)
+        {
+            const GLenum props[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING };
+            GLint values[2] = {};
+            glGetProgramResourceiv(program, blockInterfaces[b], i, 2, props, 2, nullptr, values);
+
+            ProgramParam param;
+            param.kind = b == 0 ? ParamKind::UniformBlock : ParamKind::StorageBlock;
+            param.binding = values[1];
+            insert(resourceName(program, blockInterfaces[b], i, values[0]), param);
+        }
+    }
+
+    for (GLint i = 0; i < inputs; ++i)
+    {
+        const GLenum props[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE };
+        GLint values[4] = {};
+        glGetProgramResourceiv(program, GL_PROGRAM_INPUT, i, 4, props, 4, nullptr, values);
+
+        ProgramParam param;
+        param.kind = ParamKind::Attribute;
+        param.type = values[1];
+        param.location = values[2];
+        param.arraySize = values[3];
+        insert(resourceName(program, GL_PROGRAM_INPUT, i, values[0]), param);
+    }
+}
+
+void ProgramReflection::insert(const std::string& name, const ProgramParam& param)
+{
+    ProgramParam entry = param;
+    entry.id = paramId(name.c_str());
+
+    size_t mask = mTable.size() - 1;
+    for (size_t slot = entry.id & mask;; slot = (slot + 1) & mask)
+    {
+        if (mTable[slot].id == 0)
+        {
+            mTable[slot] = entry;
+            mNames[slot] = name;
+            mCount++;
+            return;
+        }
+        if (mTable[slot].id == entry.id && mTable[slot].kind == entry.kind)
+        {
+            // Two names of one kind hashing alike would make one of them unreachable
+            SDL_Log("Reflection: %s %s collides with %s, only the first is reachable.\n", kindName(entry.kind), name.c_str(), mNames[slot].c_str());
+            return;
+        }
+    }
+}
+
+const ProgramParam* ProgramReflection::find(ParamId id, ParamKind kind) const
+{
+    if (mTable.empty())
+        return nullptr;
+
+    size_t mask = mTable.size() - 1;
+    for (size_t slot = id & mask;; slot = (slot + 1) & mask)
+    {
+        const ProgramParam& entry = mTable[slot];
+        if (entry.id == 0)
+            return nullptr;
+        if (entry.id == id && entry.kind == kind)
+            return &entry;
+    }
+}
+
+bool ProgramReflection::validate(const char* programName, const ParamRequirement* requirements, size_t count) const
+{
+    bool valid = true;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ParamRequirement& requirement = requirements[i];
+        const ProgramParam* param = find(requirement.id, requirement.kind);
+        if (!param)
+        {
+            SDL_Log("Program %s has no active %s %s.\n", programName, kindName(requirement.kind), requirement.name);
+            valid = false;
+        }
+        else if (requirement.type != GL_NONE && param->type != requirement.type)
+        {
+            SDL_Log("Program %s declares %s %s as type 0x%04X, expected 0x%04X.\n", programName, kindName(requirement.kind), requirement.name, param->type, requirement.type);
+            valid = false;
+        }
+    }
+
+    // Loose uniforms nobody sets keep their default value, usually a mistake
+    for (size_t slot = 0; slot < mTable.size(); ++slot)
+    {
+        const ProgramParam& param = mTable[slot];
+        if (param.id == 0 || param.kind != ParamKind::Uniform || param.location < 0)
+            continue;
+
+        bool covered = false;
+        for (size_t i = 0; i < count && !covered; ++i)
+            covered = requirements[i].id == param.id && requirements[i].kind == ParamKind::Uniform;
+        if (!covered)
+            SDL_Log("Program %s has uniform %s that nothing sets.\n", programName, mNames[slot].c_str());
+    }
+    return valid;
+}
+
+const ProgramReflection& ProgramReflectionCache::reflect(GLuint program)
+{
+    auto it = mPrograms.find(program);
+    if (it == mPrograms.end())
+    {
+        it = mPrograms.emplace(program, ProgramReflection()).first;
+        if (program != 0)
+            it->second.reflect(program);
+    }
+    return it->second;
+}
+
+void ProgramReflectionCache::forget(GLuint program)
+{
+    mPrograms.erase(program);
+}
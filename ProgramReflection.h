@@ -0,0 +1,120 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Hashed resource name, computed at compile time for names known up front
+typedef Uint32 ParamId;
+
+//FNV-1a of the name, never 0 so 0 can mark empty table slots
+constexpr ParamId paramId(const char* name)
+{
+    Uint32 hash = 0x811C9DC5u;
+    for (; *name; ++name)
+    {
+        hash ^= (Uint8)*name;
+        hash *= 0x01000193u;
+    }
+    return hash ? hash : 1;
+}
+
+enum class ParamKind : Uint8
+{
+    Uniform,
+    UniformBlock,
+    StorageBlock,
+    Attribute
+};
+
+//An active resource of a linked program
+struct ProgramParam
+{
+    ParamId id = 0;
+    ParamKind kind = ParamKind::Uniform;
+
+    //GL_NONE for blocks
+    GLenum type = GL_NONE;
+
+    //Uniform or attribute location, -1 for uniforms inside a block
+    GLint location = -1;
+    GLint arraySize = 1;
+
+    //Binding point of a block, block index of a block member
+    GLint binding = -1;
+};
+
+//A parameter material code sets, checked against the program at load time
+struct ParamRequirement
+{
+    const char* name;
+    ParamId id;
+    ParamKind kind;
+
+    //GL_NONE accepts any type
+    GLenum type;
+
+    constexpr ParamRequirement(const char* name, ParamKind kind, GLenum type = GL_NONE)
+        : name(name), id(paramId(name)), kind(kind), type(type)
+    {
+    }
+};
+
+/**
+ * Active uniforms, uniform blocks, storage blocks and vertex inputs of one
+ * program, enumerated once with the program interface queries.
+ *
+ * Resources sit in a flat open-addressed table keyed by the hash of their
+ * name (array suffixes stripped), so a lookup by a precomputed ParamId is a
+ * couple of compares instead of a glGetUniformLocation string search.
+ */
+class ProgramReflection
+{
+public:
+    //Needs GL 4.3 or ARB_program_interface_query
+    void reflect(GLuint program);
+
+    //nullptr when the program has no such active resource
+    const ProgramParam* find(ParamId id, ParamKind kind) const;
+
+    GLint location(ParamId id) const
+    {
+        const ProgramParam* param = find(id, ParamKind::Uniform);
+        return param ? param->location : -1;
+    }
+
+    //Logs every requirement the program lacks or types differently and every
+    //loose uniform no requirement covers. Returns false when a requirement failed.
+    bool validate(const char* programName, const ParamRequirement* requirements, size_t count) const;
+
+    size_t size() const { return mCount; }
+
+private:
+    void insert(const std::string& name, const ProgramParam& param);
+
+    std::vector<ProgramParam> mTable;
+    std::vector<std::string> mNames;
+    size_t mCount = 0;
+};
+
+/**
+ * Reflection of every program in use, built when a program links and
+ * dropped when it is deleted. Programs never registered are reflected on
+ * their first lookup.
+ */
+class ProgramReflectionCache
+{
+public:
+    const ProgramReflection& reflect(GLuint program);
+    void forget(GLuint program);
+
+    //Forgets every program and frees the table
+    void clear() { std::unordered_map<GLuint, ProgramReflection>().swap(mPrograms); }
+
+private:
+    std::unordered_map<GLuint, ProgramReflection> mPrograms;
+};
+
+//Reflection of the programs of the main GL context
+extern ProgramReflectionCache gProgramReflection;
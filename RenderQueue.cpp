@@ -0,0 +1,278 @@
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+#include "MeshBuilder.h"
+#include "ProgramReflection.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const ParamId kDrawBlock = paramId("DrawBlock");
+
+    //Positive floats order like their bit patterns, the top 24 bits keep a 15-bit mantissa
+    Uint32 depthBits(float depth)
+    {
+        if (!(depth > 0.0f))
+            return 0;
+
+        Uint32 bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 8;
+    }
+
+    //instanceCount 0 issues the non-instanced variant
+    void issueDraw(const DrawCommand& command, GLsizei instanceCount)
+    {
+        if (command.indexType != GL_NONE)
+        {
+            const void* offset = (const void*)((size_t)command.first * indexSize(command.indexType));
+            if (instanceCount > 0)
+                glDrawElementsInstanced(command.primitive, command.vertexCount, command.indexType, offset, instanceCount);
+            else
+                glDrawElements(command.primitive, command.vertexCount, command.indexType, offset);
+        }
+        else if (instanceCount > 0)
+        {
+            glDrawArraysInstanced(command.primitive, command.first, command.vertexCount, instanceCount);
+        }
+        else
+        {
+            glDrawArrays(command.primitive, command.first, command.vertexCount);
+        }
+    }
+}
+
+Uint64 makeSortKey(RenderPass pass, GLuint program, GLuint vertexArray, Uint16 material, float depth)
+{
+    const Uint64 passBits = (Uint64)pass & 0xF;
+    const Uint64 programBits = program & 0xFFF;
+    const Uint64 vertexArrayBits = vertexArray & 0xFFF;
+    const Uint64 materialBits = material & 0xFFF;
+    const Uint64 depth24 = depthBits(depth);
+
+    if (pass == RenderPass::Transparent)
+        return passBits << 60 | (0xFFFFFF - depth24) << 36 | programBits << 24 | vertexArrayBits << 12 | materialBits;
+
+    return passBits << 60 | programBits << 48 | vertexArrayBits << 36 | materialBits << 24 | depth24;
+}
+
+void RenderQueue::reserve(size_t count)
+{
+    mCommands.reserve(count);
+    mEntries.reserve(count);
+    mScratch.reserve(count);
+}
+
+void RenderQueue::clear()
+{
+    mCommands.clear();
+    mEntries.clear();
+}
+
+void RenderQueue::release()
+{
+    std::vector<DrawCommand>().swap(mCommands);
+    std::vector<SortEntry>().swap(mEntries);
+    std::vector<SortEntry>().swap(mScratch);
+    std::vector<const DrawCommand*>().swap(mBatch);
+}
+
+void RenderQueue::push(Uint64 key, const DrawCommand& command)
+{
+    mEntries.push_back({ key, (Uint32)mCommands.size() });
+    mCommands.push_back(command);
+}
+
+void RenderQueue::push(RenderPass pass, Uint16 material, const DrawCommand& command)
+{
+    // The camera looks down -Z
+    float depth = -command.modelView.m[2][3];
+    push(makeSortKey(pass, command.program, command.vertexArray, material, depth), command);
+}
+
+void RenderQueue::sort()
+{
+    const size_t count = mEntries.size();
+    if (count < 2)
+        return;
+
+    // Small queues are not worth eight histogram passes
+    if (count <= 256)
+    {
+        std::stable_sort(mEntries.begin(), mEntries.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+        return;
+    }
+
+    // Histograms of all eight key bytes in one read of the keys
+    static thread_local Uint32 histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (const SortEntry& entry : mEntries)
+    {
+        for (int byte = 0; byte < 8; ++byte)
+            histograms[byte][(entry.key >> (byte * 8)) & 0xFF]++;
+    }
+
+    mScratch.resize(count);
+    SortEntry* src = mEntries.data();
+    SortEntry* dst = mScratch.data();
+    for (int byte = 0; byte < 8; ++byte)
+    {
+        // A byte every key shares does not change the order
+        Uint32* histogram = histograms[byte];
+        if (histogram[(src[0].key >> (byte * 8)) & 0xFF] == count)
+            continue;
+
+        Uint32 offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket)
+        {
+            Uint32 bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        const int shift = byte * 8;
+        for (size_t i = 0; i < count; ++i)
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        std::swap(src, dst);
+    }
+
+    if (src != mEntries.data())
+        mEntries.swap(mScratch);
+}
+
+RenderQueueStats RenderQueue::submit(RenderBackend& backend)
+{
+    RenderQueueStats stats;
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    bool first = true;
+
+    const size_t count = mEntries.size();
+    size_t i = 0;
+    while (i < count)
+    {
+        const DrawCommand& command = mCommands[mEntries[i].index];
+        if (first || command.program != program)
+        {
+            backend.setProgram(command.program);
+            program = command.program;
+            stats.programChanges++;
+        }
+        if (first || command.vertexArray != vertexArray)
+        {
+            backend.setVertexArray(command.vertexArray);
+            vertexArray = command.vertexArray;
+            stats.vertexArrayChanges++;
+        }
+        first = false;
+
+        // Gather the run of draws that only differ in their per-draw data
+        mBatch.clear();
+        mBatch.push_back(&command);
+        for (++i; i < count && command.instanceCount == 0; ++i)
+        {
+            const DrawCommand& next = mCommands[mEntries[i].index];
+            if (next.program != command.program || next.vertexArray != command.vertexArray || next.primitive != command.primitive
+                || next.first != command.first || next.vertexCount != command.vertexCount || next.indexType != command.indexType
+                || next.instanceCount != 0)
+                break;
+            mBatch.push_back(&next);
+        }
+
+        stats.drawCalls += backend.draw(mBatch.data(), mBatch.size());
+        for (const DrawCommand* batched : mBatch)
+        {
+            Uint64 instances = batched->instanceCount > 0 ? batched->instanceCount : 1;
+            stats.draws++;
+            stats.instances += instances;
+            stats.vertices += instances * batched->vertexCount;
+        }
+    }
+    return stats;
+}
+
+void GLRenderBackend::setRingBuffer(FrameRingBuffer* ring)
+{
+    mRing = ring;
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    mAlignment = std::max<GLsizeiptr>(alignment, 16);
+}
+
+void GLRenderBackend::setProgram(GLuint program)
+{
+    const ProgramParam* block = gProgramReflection.reflect(program).find(kDrawBlock, ParamKind::StorageBlock);
+    mUsesDrawData = block && block->binding == 0;
+    gStateCache.useProgram(program);
+}
+
+void GLRenderBackend::setVertexArray(GLuint vertexArray)
+{
+    gStateCache.bindVertexArray(vertexArray);
+}
+
+Uint32 GLRenderBackend::draw(const DrawCommand* const* commands, size_t count)
+{
+    const DrawCommand& command = *commands[0];
+    Uint32 drawCalls = 0;
+
+    if (!mUsesDrawData || !mRing)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            issueDraw(*commands[i], commands[i]->instanceCount);
+            drawCalls++;
+        }
+        return drawCalls;
+    }
+
+    if (!mBatching && count > 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            drawCalls += draw(commands + i, 1);
+        return drawCalls;
+    }
+
+    // Split batches that do not fit what is left of the frame's ring region
+    const size_t maxPerChunk = std::max<size_t>(1, (size_t)(mRing->frameSize() / sizeof(DrawData)));
+    size_t done = 0;
+    while (done < count)
+    {
+        size_t chunk = std::min(count - done, maxPerChunk);
+        RingAllocation allocation = mRing->allocate(chunk * sizeof(DrawData), mAlignment);
+        if (!allocation.data)
+        {
+            if (!mReportedFull)
+                SDL_Log("Frame ring buffer full, dropping %zu draws\n", count - done);
+            mReportedFull = true;
+            break;
+        }
+
+        DrawData* out = (DrawData*)allocation.data;
+        for (size_t i = 0; i < chunk; ++i)
+        {
+            const DrawCommand& source = *commands[done + i];
+            const Affine& a = source.modelView;
+            DrawData data;
+            for (int c = 0; c < 4; ++c)
+            {
+                data.modelView[c * 4 + 0] = a.m[0][c];
+                data.modelView[c * 4 + 1] = a.m[1][c];
+                data.modelView[c * 4 + 2] = a.m[2][c];
+                data.modelView[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+            }
+            memcpy(data.color, &source.color, sizeof(data.color));
+
+            // One sequential store per entry, the mapping may be write-combined
+            memcpy(out + i, &data, sizeof(data));
+        }
+        mRing->commit(allocation);
+
+        gStateCache.bindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, mRing->buffer(), allocation.offset, allocation.size);
+        issueDraw(command, (GLsizei)chunk);
+        drawCalls++;
+        done += chunk;
+    }
+    return drawCalls;
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include "AffineMath.h"
+#include "FrameRingBuffer.h"
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+//Passes are submitted in this order
+enum class RenderPass : Uint8
+{
+    Opaque,
+    Transparent
+};
+
+//Everything needed to issue one draw, referenced by a sort key
+struct DrawCommand
+{
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    GLenum primitive = GL_TRIANGLES;
+    GLint first = 0;
+    GLsizei vertexCount = 0;
+
+    //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT draws from the element buffer, first and vertexCount then count indices
+    GLenum indexType = GL_NONE;
+
+    //0 issues glDrawArrays, anything else glDrawArraysInstanced
+    GLsizei instanceCount = 0;
+
+    Affine modelView;
+    glm::vec4 color = glm::vec4(1.0f);
+};
+
+//std430 layout of one entry of the DrawBlock shader storage buffer
+struct DrawData
+{
+    //Column-major like glm::mat4
+    float modelView[16];
+    float color[4];
+};
+
+//Work done by one RenderQueue::submit call
+struct RenderQueueStats
+{
+    //Commands submitted and the GL draw calls the backend turned them into
+    Uint32 draws = 0;
+    Uint32 drawCalls = 0;
+    Uint64 instances = 0;
+    Uint64 vertices = 0;
+    Uint32 programChanges = 0;
+    Uint32 vertexArrayChanges = 0;
+};
+
+//Receives the sorted draws, the GL implementation is GLRenderBackend
+class RenderBackend
+{
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual void setProgram(GLuint program) = 0;
+    virtual void setVertexArray(GLuint vertexArray) = 0;
+
+    //Draws commands that share program, vertex array and vertex range, returns the GL draw calls issued
+    virtual Uint32 draw(const DrawCommand* const* commands, size_t count) = 0;
+};
+
+/**
+ * 64-bit sort key of a draw.
+ *
+ * Opaque:      pass:4 | program:12 | vertex array:12 | material:12 | depth:24
+ * Transparent: pass:4 | inverted depth:24 | program:12 | vertex array:12 | material:12
+ *
+ * Opaque draws are grouped by state and drawn front to back within a group,
+ * transparent draws are drawn back to front. Program and vertex array names
+ * keep their low 12 bits, which is plenty for GL's small sequential names.
+ * depth is the view-space distance in front of the camera.
+ */
+Uint64 makeSortKey(RenderPass pass, GLuint program, GLuint vertexArray, Uint16 material, float depth);
+
+/**
+ * Per-frame list of draws.
+ *
+ * Gameplay and render code push draws in any order; sort() radix-sorts
+ * the keys and submit() walks them, only switching program and vertex
+ * array when the next draw needs a different one. Consecutive draws of the
+ * same vertex range reach the backend as one batch.
+ */
+class RenderQueue
+{
+public:
+    void reserve(size_t count);
+    void clear();
+
+    //Empties the queue and frees its storage
+    void release();
+
+    size_t size() const { return mCommands.size(); }
+
+    void push(Uint64 key, const DrawCommand& command);
+
+    //Builds the key from the command, depth is taken from the model-view translation
+    void push(RenderPass pass, Uint16 material, const DrawCommand& command);
+
+    //LSD radix sort over the key bytes that differ between draws, equal keys keep their push order
+    void sort();
+
+    RenderQueueStats submit(RenderBackend& backend);
+
+    //Sorted key and command of draw i, valid after sort()
+    Uint64 key(size_t i) const { return mEntries[i].key; }
+    const DrawCommand& command(size_t i) const { return mCommands[mEntries[i].index]; }
+
+private:
+    struct SortEntry
+    {
+        Uint64 key;
+        Uint32 index;
+    };
+
+    std::vector<DrawCommand> mCommands;
+    std::vector<SortEntry> mEntries;
+    std::vector<SortEntry> mScratch;
+    std::vector<const DrawCommand*> mBatch;
+};
+
+/**
+ * Submits through gStateCache.
+ *
+ * Programs whose reflection has a DrawBlock storage block at binding 0 read
+ * their model-view matrix and color from its DrawData entries, indexed by
+ * gl_InstanceID. A batch of them is written into the frame ring
+ * buffer and drawn with a single glDrawArraysInstanced. Other programs, and
+ * every program while batching is off, get one draw call per command.
+ */
+class GLRenderBackend : public RenderBackend
+{
+public:
+    //Needs a current GL context to query the storage buffer offset alignment
+    void setRingBuffer(FrameRingBuffer* ring);
+
+    //Whether a batch becomes one instanced draw, on by default; off, each command gets its own DrawData entry and draw call
+    void setBatching(bool enabled) { mBatching = enabled; }
+
+    void setProgram(GLuint program) override;
+    void setVertexArray(GLuint vertexArray) override;
+    Uint32 draw(const DrawCommand* const* commands, size_t count) override;
+
+private:
+    FrameRingBuffer* mRing = nullptr;
+    GLsizeiptr mAlignment = 256;
+    bool mUsesDrawData = false;
+    bool mBatching = true;
+    bool mReportedFull = false;
+};
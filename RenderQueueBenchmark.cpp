@@ -0,0 +1,126 @@
+#include "BenchmarkCommon.h"
+#include "RenderQueue.h"
+#include <random>
+
+using namespace bench;
+
+namespace
+{
+    //Counts what a GL backend would have to issue without touching GL
+    class NullBackend : public RenderBackend
+    {
+    public:
+        void setProgram(GLuint program) override { mChecksum += program; }
+        void setVertexArray(GLuint vertexArray) override { mChecksum += vertexArray; }
+        Uint32 draw(const DrawCommand* const* commands, size_t count) override
+        {
+            mChecksum += commands[0]->vertexCount * count;
+            return 1;
+        }
+
+        Uint64 checksum() const { return mChecksum; }
+
+    private:
+        Uint64 mChecksum = 0;
+    };
+
+    //Draws spread over a few programs, meshes and materials in random order
+    std::vector<DrawCommand> makeDraws(size_t count, std::vector<Uint16>& materials)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<int> program(1, 4);
+        std::uniform_int_distribution<int> vertexArray(1, 8);
+        std::uniform_int_distribution<int> material(0, 15);
+        std::uniform_real_distribution<float> depth(0.5f, 500.0f);
+
+        std::vector<DrawCommand> draws(count);
+        materials.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            draws[i].program = program(rng);
+            draws[i].vertexArray = vertexArray(rng);
+            draws[i].vertexCount = 36;
+            draws[i].modelView = affineTranslation(glm::vec3(0.0f, 0.0f, -depth(rng)));
+            materials[i] = (Uint16)material(rng);
+        }
+        return draws;
+    }
+
+    //Best-of-trials nanoseconds per draw
+    template <typename Fn>
+    double timeNsPerDraw(size_t count, int repetitions, Fn&& fn)
+    {
+        double best = 1e300;
+        for (int trial = 0; trial < 5; ++trial)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int r = 0; r < repetitions; ++r)
+                fn();
+            double ms = elapsedMs(start, SDL_GetPerformanceCounter());
+            best = std::min(best, ms * 1e6 / ((double)count * repetitions));
+        }
+        return best;
+    }
+}
+
+int runRenderQueueBenchmark(int argc, char* args[])
+{
+    //Draws processed per trial, small queues are repeated to reach it
+    const double workPerTrial = (double)std::max(1, intArg(argc, args, "--work", 2000000));
+    const char* outPath = findArg(argc, args, "--out");
+    const size_t sizes[] = { 100, 10000, 100000, 1000000 };
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        return 1;
+    }
+
+    bool sorted = true;
+    fprintf(out, "{\n  \"benchmark\": \"render_queue\",\n  \"results\": [\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        const size_t count = sizes[s];
+        const int repetitions = std::max(1, (int)(workPerTrial / (double)count));
+        std::vector<Uint16> materials;
+        std::vector<DrawCommand> draws = makeDraws(count, materials);
+
+        RenderQueue queue;
+        queue.reserve(count);
+        auto fill = [&]
+        {
+            queue.clear();
+            for (size_t i = 0; i < count; ++i)
+                queue.push(RenderPass::Opaque, materials[i], draws[i]);
+        };
+
+        double pushNs = timeNsPerDraw(count, repetitions, fill);
+        double sortNs = timeNsPerDraw(count, repetitions, [&] { fill(); queue.sort(); }) - pushNs;
+
+        //std::sort of the same keys as the comparison baseline
+        std::vector<Uint64> keys(count);
+        for (size_t i = 0; i < count; ++i)
+            keys[i] = makeSortKey(RenderPass::Opaque, draws[i].program, draws[i].vertexArray, materials[i], -draws[i].modelView.m[2][3]);
+        std::vector<Uint64> keysScratch;
+        double stdSortNs = timeNsPerDraw(count, repetitions, [&] { keysScratch = keys; std::sort(keysScratch.begin(), keysScratch.end()); });
+
+        NullBackend backend;
+        RenderQueueStats stats;
+        double submitNs = timeNsPerDraw(count, repetitions, [&] { stats = queue.submit(backend); });
+
+        //The radix sort must agree with std::sort
+        for (size_t i = 0; i < count; ++i)
+            sorted = sorted && queue.key(i) == keysScratch[i];
+
+        fprintf(out, "    {\"draws\": %zu, \"push_ns_per_draw\": %.3f, \"radix_sort_ns_per_draw\": %.3f, \"std_sort_ns_per_draw\": %.3f, "
+            "\"submit_ns_per_draw\": %.3f, \"batches\": %u, \"program_changes\": %u, \"vertex_array_changes\": %u, \"checksum\": %llu}%s\n",
+            count, pushNs, std::max(sortNs, 0.0), stdSortNs, submitNs, stats.drawCalls, stats.programChanges, stats.vertexArrayChanges,
+            (unsigned long long)backend.checksum(), s + 1 < sizeof(sizes) / sizeof(sizes[0]) ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"sorted\": %s\n}\n", sorted ? "true" : "false");
+
+    if (out != stdout)
+        fclose(out);
+    return sorted ? 0 : 1;
+}
@@ -1,48 +1,85 @@
-#include <SDL3/SDL.h>
+#include "SDLEngine.h"
+#include "AffineMath.h"
+#include "TransformStore.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "FrameRingBuffer.h"
+#include "MeshBuilder.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderManager.h"
+#include "FileWatcher.h"
+#include "FramePacket.h"
+#include "JobSystem.h"
+#include "LinearArena.h"
+#include "MemoryTracker.h"
+#include "ShaderPreprocessor.h"
+#include "ProgramReflection.h"
+#include "AssetArchive.h"
+#include "TextureContainer.h"
+#include "TextureManager.h"
 #include <SDL3/SDL_main.h>
-#include <GL/glew.h>
 #include <SDL3/SDL_opengl.h>
 #include <string>
 #include <iostream>
-#include <sstream>
-#include <fstream>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <numbers>
 #include <vector>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
 
-#define numVAOs 1
-#define numVBOs 2
+#define numVAOs 3
+#define numVBOs 3
 
-glm::vec3 camera;
-glm::vec3 cube;
+//Every object in the scene, the camera included
+TransformStore gTransforms;
+TransformId gCameraId, gCubeId, gPyramidId;
 
-//Screen dimension constants
-const int SCREEN_WIDTH = 1940;
-const int SCREEN_HEIGHT = 1080;
-
-//Starts up SDL, creates window, and initializes OpenGL
-bool init();
+//The benchmark grid occupies [gGridFirst, gGridFirst + gObjectCount) in gTransforms
+TransformId gGridFirst = 0;
 
 //Initializes rendering program and clear color
 bool initGL();
 
-//Input handler
-void handleKeys(SDL_Scancode key);
+//Builds the cube grid used by the PerObject and Instanced modes
+void setupObjectGrid(int count);
+
+//Copies grid world matrices into the instance buffer, first counts from the start of the grid
+void uploadGridTransforms(Uint32 first, const Affine* transforms, size_t count);
+
+//Advances the scene by one fixed tick
+void simulateTick(float tickSeconds);
+
+//Fills the packet render code draws from the scene update() just simulated, alpha of a tick past the last one
+void buildFramePacket(FramePacket& packet, const TransformUpdate& update, float alpha);
+
+//Issues the GL work of a packet, on whichever thread owns the context
+void drawFramePacket(const FramePacket& packet);
 
-//Per frame update
-void update(float deltaTime);
+//Swaps the window and records when the frame drawn last was presented
+void presentDrawnFrame();
 
-//Renders quad to the screen
-void render(float deltaTime);
+//Prints the vertex counts and cache efficiency of a built mesh
+void logMeshReport(const char* name, const MeshBuildReport& report);
 
-//Frees media and shuts down SDL
-void close();
+//Shows frame rate and the counters of the last frame in the window title
+void updateDebugOverlay(float deltaTime);
 
-//Shader loading utility programs
-void printProgramLog(GLuint program);
-void printShaderLog(GLuint shader);
+//Re-reads the current programs and their uniform locations from gShaders
+void resolvePrograms();
+
+//Starts rebuilds for the shader files the watcher reported
+void reloadChangedShaders();
+
+//Every file the file shaders expand to, includes too
+std::vector<std::string> shaderFilePaths();
 
 //The window we'll be rendering to
 SDL_Window* gWindow = nullptr;
@@ -50,31 +87,163 @@ SDL_Window* gWindow = nullptr;
 //OpenGL context
 SDL_GLContext gContext;
 
+//Draw statistics of the current frame
+FrameCounters gFrameCounters;
+
 //Render flag
 bool gRenderQuad = true;
 
+//Submission mode and cube count of the benchmark grid
+RenderMode gRenderMode = RenderMode::Scene;
+int gObjectCount = 0;
+bool gAnimateObjects = false;
+bool gUseShaderCache = true;
+bool gWatchShaders = false;
+Uint64 gTextureBudget = 0;
+
+//update() fills a packet and render() draws it, or hands it to gRenderThread which presents it too
+FramePacketQueue gFramePackets;
+FramePacket* gWritingPacket = nullptr;
+Uint64 gFrameIndex = 0;
+std::thread gRenderThread;
+bool gFinishFrames = false;
+
+//update() simulates in fixed ticks and renders moving objects between the last two
+FixedTimestep gSimulationClock;
+bool gInterpolate = true;
+
+//Decides when the main loop starts a frame, present() reports back when it was shown
+FramePacer gFramePacer;
+int gSwapInterval = 0;
+
+//Oldest input not yet stamped onto a packet, in SDL_GetPerformanceCounter ticks
+Uint64 gPendingInput = 0;
+
+//Set where programs are resolved, read by update() to choose between the grid modes
+std::atomic<bool> gInstancedReady = false;
+
+//Grid matrices changed while the instance buffer was not drawn, the next instanced packet carries the whole grid
+bool gInstanceBufferStale = false;
+
+//Timing of the frame drawn last, owned by the thread that draws; presented frames wait in gFrameTimings
+FrameTiming gDrawnFrame;
+std::mutex gFrameTimingMutex;
+std::vector<FrameTiming> gFrameTimings;
+
+//Scratch of the thread that draws, emptied at the start of every drawn frame
+LinearArena gRenderArena;
+
+//Draws of the current frame, sorted by state before submission
+RenderQueue gRenderQueue;
+GLRenderBackend gRenderBackend;
+
+//Triple-buffered per-draw data the render queue writes into
+FrameRingBuffer gFrameRing;
+
+//Index range of a mesh in gIBO
+struct MeshDraw
+{
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    GLint firstIndex = 0;
+    GLsizei indexCount = 0;
+};
+MeshDraw gCubeMesh, gPyramidMesh;
+
 //Graphics program
 GLuint gProgramID = 0;
 GLint gVertexPos2DLocation = -1;
 GLuint gVBO = 0;
 GLuint gIBO = 0;
 
+//Programs build asynchronously, renderingProgram and instancedProgram are whatever gShaders currently returns
+ShaderManager gShaders;
+ProgramHandle gRenderingHandle = kInvalidProgram;
+ProgramHandle gInstancedHandle = kInvalidProgram;
 GLuint renderingProgram;
+GLuint instancedProgram;
+
+//Source files and permutation of every program built from files, watched in development mode
+struct ShaderFiles
+{
+    ProgramHandle handle;
+    const char* vertPath;
+    const char* fragPath;
+    ShaderDefines defines;
+};
+ShaderPreprocessor gShaderSources;
+std::vector<ShaderFiles> gShaderFiles;
+std::vector<std::string> gShaderWatchPaths;
+FileWatcher gShaderWatcher;
+
+//Decoded and uploaded in the background, the placeholder is bound until it is resident
+TextureManager gTextures;
+TextureHandle gBaseTexture = kInvalidTexture;
 GLuint vao[numVAOs];
 GLuint vbo[numVBOs];
-GLuint mvLoc, pLoc, vLoc, uColorLoc;
-GLuint tfLoc;
+GLint pLoc, vLoc;
+GLint tfLoc, projLoc;
+
+//What the render loop sets on each program, checked when a program is resolved
+const ParamId kPMatrix = paramId("p_matrix");
+const ParamId kVMatrix = paramId("v_matrix");
+const ParamId kProjMatrix = paramId("proj_matrix");
+const ParamId kTimeFactor = paramId("tf");
+
+const ParamRequirement kRenderingParams[] = {
+    { "p_matrix", ParamKind::Uniform, GL_FLOAT_MAT4 },
+    { "DrawBlock", ParamKind::StorageBlock },
+    { "baseTexture", ParamKind::Uniform, GL_SAMPLER_2D },
+    { "position", ParamKind::Attribute, GL_FLOAT_VEC3 },
+};
+
+const ParamRequirement kInstancedParams[] = {
+    { "v_matrix", ParamKind::Uniform, GL_FLOAT_MAT4 },
+    { "proj_matrix", ParamKind::Uniform, GL_FLOAT_MAT4 },
+    { "tf", ParamKind::Uniform, GL_FLOAT },
+    { "position", ParamKind::Attribute, GL_FLOAT_VEC3 },
+    { "instance_row0", ParamKind::Attribute, GL_FLOAT_VEC4 },
+    { "instance_row1", ParamKind::Attribute, GL_FLOAT_VEC4 },
+    { "instance_row2", ParamKind::Attribute, GL_FLOAT_VEC4 },
+};
 float aspect, timeFactor = 0.0f;
 glm::mat4 pMat, vMat, tMat, rMat, mMat, mvMat;
-float cubeLocX, cubeLocY, cubeLocZ;
 
-bool init()
+bool init(const InitOptions& options)
 {
     //Initialization flag
     bool success = true;
 
+    gRenderMode = options.renderMode;
+    gObjectCount = options.objectCount;
+    gAnimateObjects = options.animateObjects;
+    gUseShaderCache = options.shaderCache;
+    gWatchShaders = options.watchShaders;
+    gTextureBudget = (Uint64)std::max(options.textureBudgetMB, 0) << 20;
+
+    //Start the workers before anything hands them work
+    gJobs.init(options.jobThreads);
+    gFramePackets.init(1);
+    gWritingPacket = nullptr;
+    gFinishFrames = options.finishFrames;
+    gSimulationClock.setTickRate(options.tickRate, options.maxTicksPerFrame);
+    gInterpolate = options.interpolate;
+    gTransforms.setInterpolation(options.interpolate);
+
+    //Headless runs use the offscreen driver (EGL surfaceless on Mesa) when available
+    bool sdlReady = false;
+    if (options.headless)
+    {
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        sdlReady = SDL_Init(SDL_INIT_VIDEO);
+        if (!sdlReady)
+        {
+            SDL_Log("Offscreen video driver unavailable, using a hidden window. SDL Error: %s\n", SDL_GetError());
+            SDL_ResetHint(SDL_HINT_VIDEO_DRIVER);
+        }
+    }
+
     //Initialize SDL
-    if (!SDL_Init(SDL_INIT_VIDEO)) // Fixed: SDL3 returns true on success
+    if (!sdlReady && !SDL_Init(SDL_INIT_VIDEO)) // Fixed: SDL3 returns true on success
     {
         SDL_Log("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
         success = false;
@@ -87,7 +256,10 @@ bool init()
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
         //Create window
-        gWindow = SDL_CreateWindow("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL);
+        SDL_WindowFlags windowFlags = SDL_WINDOW_OPENGL;
+        if (options.headless)
+            windowFlags |= SDL_WINDOW_HIDDEN;
+        gWindow = SDL_CreateWindow("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT, windowFlags);
         if (gWindow == nullptr)
         {
             SDL_Log("Window could not be created! SDL Error: %s\n", SDL_GetError());
@@ -107,17 +279,35 @@ bool init()
                 //Initialize GLEW
                 glewExperimental = GL_TRUE;
                 GLenum glewError = glewInit();
+                //GLX is missing on EGL contexts, but the GL entry points are loaded anyway
+                if (options.headless && glewError == GLEW_ERROR_NO_GLX_DISPLAY)
+                    glewError = GLEW_OK;
                 if (glewError != GLEW_OK)
                 {
                     SDL_Log("Error initializing GLEW! %s\n", glewGetErrorString(glewError));
                     success = false;
                 }
 
-                //Use Vsync
-                if (!SDL_GL_SetSwapInterval(1)) // Fixed: Enable vsync
+                //Use Vsync unless the caller asked otherwise
+                if (!SDL_GL_SetSwapInterval(options.swapInterval)) // Fixed: Enable vsync
+                {
+                    //Adaptive vsync presents late frames at once instead of a refresh later, not every driver has it
+                    if (options.swapInterval < 0 && SDL_GL_SetSwapInterval(1))
+                        SDL_Log("Adaptive VSync unsupported, using VSync.\n");
+                    else
+                        SDL_Log("Warning: Unable to set VSync! SDL Error: %s\n", SDL_GetError());
+                }
+                if (!SDL_GL_GetSwapInterval(&gSwapInterval))
+                    gSwapInterval = options.swapInterval;
+
+                //Deadlines follow the target rate, or the refresh rate when vsync or a pacing mode needs one
+                double pacingRate = options.targetFps;
+                if (pacingRate <= 0.0 && (gSwapInterval != 0 || options.pacing != PacingMode::Off))
                 {
-                    SDL_Log("Warning: Unable to set VSync! SDL Error: %s\n", SDL_GetError());
+                    const SDL_DisplayMode* displayMode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(gWindow));
+                    pacingRate = displayMode && displayMode->refresh_rate > 0.0f ? displayMode->refresh_rate : 60.0;
                 }
+                gFramePacer.configure(options.pacing, pacingRate, gSwapInterval != 0, options.pacingMarginMs);
 
                 //Initialize OpenGL
                 if (!initGL())
@@ -134,54 +324,51 @@ bool init()
 
 // Default vertex shader if file doesn't exist
 const char* defaultVertexShader = R"(
-#version 410
+#version 430
 layout (location = 0) in vec3 position;
 
-uniform mat4 mv_matrix;
+out vec4 misturaColor;
+flat out vec4 drawColor;
+
+struct DrawData
+{
+    mat4 mv_matrix;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBlock
+{
+    DrawData draws[];
+};
+
 uniform mat4 p_matrix;
 
 void main()
 {
-    gl_Position = p_matrix * mv_matrix * vec4(position, 1.0);
+    DrawData draw = draws[gl_InstanceID];
+    gl_Position = p_matrix * draw.mv_matrix * vec4(position, 1.0);
+    misturaColor = vec4(position, 1.0);
+    drawColor = draw.color;
 }
 )";
 
 // Default fragment shader if file doesn't exist
 const char* defaultFragmentShader = R"(
-#version 410
-uniform vec4 uColor;
+#version 430
+flat in vec4 drawColor;
+in vec4 misturaColor;
 out vec4 outColor;
+uniform sampler2D baseTexture;
 
 void main()
 {
-    outColor = uColor;
+    outColor = drawColor * texture(baseTexture, misturaColor.xy * 0.5 + 0.5);
 }
 )";
 
-char* readShaderSource(const char* filename)
-{
-    std::ifstream file(filename);
-    if (!file)
-    {
-        std::cerr << "Failed to open file: " << filename << ", using default shader\n";
-        return nullptr;
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
-
-    std::string content = buffer.str();
-
-    char* result = new char[content.size() + 1];
-    std::copy(content.begin(), content.end(), result);
-    result[content.size()] = '\0';
-
-    return result;
-}
-
 void setupVertices()
 {
+    MemoryTagScope memoryTag(MemoryTag::Render);
     float vertexPositions[108] = {
         -1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f,
         1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f,
@@ -204,204 +391,579 @@ void setupVertices()
      -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, // base  left front
      1.0f, -1.0f, 1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f };
 
+    // Weld the triangle soups into indexed meshes
+    MeshBuildReport cubeReport, pyramidReport;
+    MeshData cube = buildMesh((const glm::vec3*)vertexPositions, 36, &cubeReport);
+    MeshData pyramid = buildMesh((const glm::vec3*)pyramidPositions, 18, &pyramidReport);
+    logMeshReport("Cube", cubeReport);
+    logMeshReport("Pyramid", pyramidReport);
+
+    // Both index lists share gIBO, each starting on a 4-byte boundary
+    std::vector<Uint8> indexData, packed;
+    gCubeMesh.indexType = packIndices(cube.indices, cube.positions.size(), indexData);
+    gCubeMesh.indexCount = (GLsizei)cube.indices.size();
+
+    indexData.resize((indexData.size() + 3) & ~(size_t)3);
+    gPyramidMesh.indexType = packIndices(pyramid.indices, pyramid.positions.size(), packed);
+    gPyramidMesh.firstIndex = (GLint)(indexData.size() / indexSize(gPyramidMesh.indexType));
+    gPyramidMesh.indexCount = (GLsizei)pyramid.indices.size();
+    indexData.insert(indexData.end(), packed.begin(), packed.end());
+
     glGenVertexArrays(numVAOs, vao);
-    glBindVertexArray(vao[0]);
     glGenBuffers(numVBOs, vbo);
+    glGenBuffers(1, &gIBO);
 
+    // vao[0] draws the cube and vao[2] the pyramid, their attribute layout is set once here
+    glBindVertexArray(vao[0]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
+    trackGpuMemory(MemoryDomain::GpuBuffer, gIBO, indexData.size(), MemoryTag::Render, GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, cube.positions.size() * sizeof(glm::vec3), cube.positions.data(), GL_STATIC_DRAW);
+    trackGpuMemory(MemoryDomain::GpuBuffer, vbo[0], cube.positions.size() * sizeof(glm::vec3), MemoryTag::Render, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
 
+    glBindVertexArray(vao[2]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIBO);
     glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidPositions), pyramidPositions, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, pyramid.positions.size() * sizeof(glm::vec3), pyramid.positions.data(), GL_STATIC_DRAW);
+    trackGpuMemory(MemoryDomain::GpuBuffer, vbo[1], pyramid.positions.size() * sizeof(glm::vec3), MemoryTag::Render, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
 }
 
-GLuint createShaderProgram()
+void logMeshReport(const char* name, const MeshBuildReport& report)
 {
-    const char* vertexShaderSrc = readShaderSource("defaultVertexShader.glsl");
-    const char* fragShaderSrc = readShaderSource("defaultFragShader.glsl");
+    SDL_Log("%s mesh: %zu -> %zu vertices, %zu triangles, ACMR %.2f -> %.2f, ATVR %.2f -> %.2f\n", name,
+        report.inputVertices, report.outputVertices, report.triangles, report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+}
+
+void setupObjectGrid(int count)
+{
+    // Lay the cubes out in a cube-shaped grid in front of the camera
+    int side = (int)std::ceil(std::cbrt((double)std::max(count, 1)));
+    const float spacing = 4.0f;
+    float half = (side - 1) * spacing * 0.5f;
+
+    count = std::max(count, 0);
+    gGridFirst = (TransformId)gTransforms.size();
+    gTransforms.reserve(gTransforms.size() + count);
+    for (int i = 0; i < count; ++i)
+    {
+        int x = i % side;
+        int y = (i / side) % side;
+        int z = i / (side * side);
+        gTransforms.create(glm::vec3(x * spacing - half, y * spacing - half, -10.0f - z * spacing));
+    }
+
+    // Per-instance world matrices, filled by uploadGridTransforms
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[2]);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(Affine), nullptr, GL_DYNAMIC_DRAW);
+    trackGpuMemory(MemoryDomain::GpuBuffer, vbo[2], count * sizeof(Affine), MemoryTag::Render, GL_DYNAMIC_DRAW);
+
+    glBindVertexArray(vao[1]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIBO);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+
+    // The three rows of an Affine take locations 1-3
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[2]);
+    for (int row = 0; row < 3; ++row)
+    {
+        GLuint location = 1 + row;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Affine), (void*)(sizeof(float) * 4 * row));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void uploadGridTransforms(Uint32 first, const Affine* transforms, size_t count)
+{
+    if (count == 0)
+        return;
+
+    gStateCache.bindBuffer(GL_ARRAY_BUFFER, vbo[2]);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Affine), count * sizeof(Affine), transforms);
+}
+
+ProgramHandle requestShaderProgram(const char* name, const char* vertPath, const char* fragPath, const ShaderDefines& defines, const char* vertFallback, const char* fragFallback, GLuint fallbackProgram)
+{
+    const ShaderSource* vertexSource = gShaderSources.expand(vertPath, defines);
+    const ShaderSource* fragmentSource = gShaderSources.expand(fragPath, defines);
 
     // Use default shaders if files don't exist
-    if (!vertexShaderSrc)
-        vertexShaderSrc = defaultVertexShader;
-    if (!fragShaderSrc)
-        fragShaderSrc = defaultFragmentShader;
-
-    GLuint vShader = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(vShader, 1, &vertexShaderSrc, nullptr);
-    glShaderSource(fShader, 1, &fragShaderSrc, nullptr);
-    glCompileShader(vShader);
-    glCompileShader(fShader);
-
-    // Check for shader compilation errors
-    GLint success;
-    glGetShaderiv(vShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        printShaderLog(vShader);
-        glDeleteShader(vShader);
-        glDeleteShader(fShader);
-        if (vertexShaderSrc != defaultVertexShader)
-            delete[] vertexShaderSrc;
-        if (fragShaderSrc != defaultFragmentShader)
-            delete[] fragShaderSrc;
-        return 0;
-    }
-
-    glGetShaderiv(fShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        printShaderLog(fShader);
-        glDeleteShader(vShader);
-        glDeleteShader(fShader);
-        if (vertexShaderSrc != defaultVertexShader)
-            delete[] vertexShaderSrc;
-        if (fragShaderSrc != defaultFragmentShader)
-            delete[] fragShaderSrc;
-        return 0;
-    }
-
-    GLuint vfProgram = glCreateProgram();
-    glAttachShader(vfProgram, vShader);
-    glAttachShader(vfProgram, fShader);
-    glLinkProgram(vfProgram);
-
-    // Check for program linking errors
-    glGetProgramiv(vfProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        printProgramLog(vfProgram);
-        glDeleteProgram(vfProgram);
-        glDeleteShader(vShader);
-        glDeleteShader(fShader);
-        if (vertexShaderSrc != defaultVertexShader)
-            delete[] vertexShaderSrc;
-        if (fragShaderSrc != defaultFragmentShader)
-            delete[] fragShaderSrc;
-        return 0;
-    }
-
-    glDeleteShader(vShader);
-    glDeleteShader(fShader);
-    if (vertexShaderSrc != defaultVertexShader)
-        delete[] vertexShaderSrc;
-    if (fragShaderSrc != defaultFragmentShader)
-        delete[] fragShaderSrc;
-
-    return vfProgram;
+    const char* vertexShaderSrc = vertexSource ? vertexSource->text.c_str() : vertFallback;
+    const char* fragShaderSrc = fragmentSource ? fragmentSource->text.c_str() : fragFallback;
+    if (!vertexSource)
+        std::cerr << "Failed to load shader: " << vertPath << ", using default shader\n";
+    if (!fragmentSource)
+        std::cerr << "Failed to load shader: " << fragPath << ", using default shader\n";
+
+    // Nothing to compile without a source or a fallback
+    ProgramHandle handle = kInvalidProgram;
+    if (vertexShaderSrc && fragShaderSrc)
+        handle = gShaders.request(name, vertexShaderSrc, fragShaderSrc, fallbackProgram);
+
+    if (handle != kInvalidProgram && vertexSource && fragmentSource)
+        gShaderFiles.push_back({ handle, vertPath, fragPath, defines });
+    return handle;
+}
+
+std::vector<std::string> shaderFilePaths()
+{
+    std::vector<std::string> paths;
+    for (const ShaderFiles& files : gShaderFiles)
+    {
+        for (const char* path : { files.vertPath, files.fragPath })
+        {
+            const ShaderSource* source = gShaderSources.expand(path, files.defines);
+            if (!source)
+                continue;
+            for (const std::string& file : source->files)
+            {
+                if (std::find(paths.begin(), paths.end(), file) == paths.end())
+                    paths.push_back(file);
+            }
+        }
+    }
+    return paths;
 }
 
 bool initGL()
 {
-    renderingProgram = createShaderProgram();
-    if (renderingProgram == 0)
+    profilerInit();
+
+    gProgramCache.init("shadercache");
+    gProgramCache.setEnabled(gUseShaderCache);
+
+    // Packed assets win over loose files, except while editing shaders
+    if (!gWatchShaders && gAssets.open("assets.pak"))
+        SDL_Log("Loading assets from assets.pak (%d files).\n", (int)gAssets.count());
+
+    gShaders.init();
+
+    // The built-in shaders are small and built up front, they draw the scene until the file shaders are ready
+    ProgramHandle fallbackHandle = gShaders.request("built-in", defaultVertexShader, defaultFragmentShader);
+    gShaders.wait(fallbackHandle);
+    GLuint fallbackProgram = gShaders.program(fallbackHandle);
+    if (fallbackProgram == 0)
     {
         SDL_Log("Failed to create shader program.\n");
         return false;
     }
 
-    // Initialize camera and cube positions
-    camera = glm::vec3(0.0f, 0.0f, 8.0f);
-    cube = glm::vec3(0.0f, -2.0f, 0.0f);
+    gRenderingHandle = requestShaderProgram("default", "defaultVertexShader.glsl", "defaultFragShader.glsl", ShaderDefines(), defaultVertexShader, defaultFragmentShader, fallbackProgram);
 
-    // Cache uniform locations
-    pLoc = glGetUniformLocation(renderingProgram, "p_matrix");
-    mvLoc = glGetUniformLocation(renderingProgram, "mv_matrix");
-    uColorLoc = glGetUniformLocation(renderingProgram, "uColor");
+    // The instanced program has no built-in fallback, PerObject is drawn until it is ready
+    gInstancedHandle = requestShaderProgram("instanced", "vertShader.glsl", "fragShader.glsl", ShaderDefines(), nullptr, nullptr, 0);
+    if (gInstancedHandle == kInvalidProgram)
+    {
+        SDL_Log("Instanced shader program unavailable, instanced mode disabled.\n");
+    }
+
+    if (gWatchShaders)
+    {
+        gShaderWatchPaths = shaderFilePaths();
+        gShaderWatcher.start(gShaderWatchPaths);
+        SDL_Log("Watching %d shader files for changes (%s).\n", (int)gShaderWatchPaths.size(), gShaderWatcher.usesInotify() ? "inotify" : "polling");
+    }
+
+    // Initialize camera and scene objects, negative angles keep the clockwise turn the scene was authored with
+    gTransforms.clear();
+    gCameraId = gTransforms.create(glm::vec3(0.0f, 0.0f, 8.0f));
+    gCubeId = gTransforms.create(glm::vec3(0.0f, -2.0f, 0.0f), glm::vec3(0.0f, -glm::radians(40.0f), 0.0f));
+    gPyramidId = gTransforms.create(glm::vec3(2.0f, 1.0f, 1.0f), glm::vec3(-glm::radians(30.0f), 0.0f, 0.0f)); // Fixed: Better positioning
+
+    resolvePrograms();
 
     // Build perspective matrix
     aspect = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
     pMat = glm::perspective(glm::radians(60.0f), aspect, 0.1f, 1000.0f);
 
     setupVertices();
+    setupObjectGrid(gObjectCount);
+    gRenderQueue.reserve(gObjectCount + 2);
+
+    // Room for one DrawData per object per frame, at its own aligned offset when per-object draws are not batched
+    GLint drawDataAlignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &drawDataAlignment);
+    GLsizeiptr drawDataSize = (GLsizeiptr)sizeof(DrawData);
+    if (drawDataAlignment > 0)
+        drawDataSize = (drawDataSize + drawDataAlignment - 1) / drawDataAlignment * drawDataAlignment;
+    if (!gFrameRing.create((GLsizeiptr)(gObjectCount + 64) * drawDataSize))
+    {
+        SDL_Log("Failed to create the frame ring buffer.\n");
+        return false;
+    }
+    gRenderBackend.setRingBuffer(&gFrameRing);
+
+    if (!gTextures.init())
+    {
+        SDL_Log("Failed to initialize texture loading.\n");
+        return false;
+    }
+    if (gTextureBudget > 0)
+        gTextures.setBudget(gTextureBudget);
+    gBaseTexture = gTextures.load("hello-sdl3.bmp");
+
+    // Setup code above binds through GL directly
+    gStateCache.invalidate();
+    gStateCache.enable(GL_DEPTH_TEST);
+    gStateCache.depthFunc(GL_LEQUAL);
+
+    gTransforms.updateWorldMatrices();
+    uploadGridTransforms(0, gTransforms.worldData() + gGridFirst, gObjectCount);
+    gInstanceBufferStale = false;
 
     return true;
 }
 
+void resolvePrograms()
+{
+    GLuint previousRendering = renderingProgram;
+    GLuint previousInstanced = instancedProgram;
+    renderingProgram = gShaders.program(gRenderingHandle);
+    instancedProgram = gShaders.program(gInstancedHandle);
+
+    // Locations come from the reflection built at link time, no string lookups
+    const ProgramReflection& rendering = gProgramReflection.reflect(renderingProgram);
+    pLoc = rendering.location(kPMatrix);
+    if (renderingProgram != previousRendering)
+        rendering.validate("default", kRenderingParams, SDL_arraysize(kRenderingParams));
+
+    if (instancedProgram != 0)
+    {
+        const ProgramReflection& instanced = gProgramReflection.reflect(instancedProgram);
+        vLoc = instanced.location(kVMatrix);
+        projLoc = instanced.location(kProjMatrix);
+        tfLoc = instanced.location(kTimeFactor);
+        if (instancedProgram != previousInstanced)
+            instanced.validate("instanced", kInstancedParams, SDL_arraysize(kInstancedParams));
+    }
+    gInstancedReady = instancedProgram != 0;
+}
+
+void reloadChangedShaders()
+{
+    std::vector<FileChange> changes = gShaderWatcher.takeChanges();
+    if (changes.empty())
+        return;
+
+    PROFILE_ZONE("reloadChangedShaders");
+
+    // Find the programs that include a changed file before the edits drop their permutations
+    ArenaScope scope(gRenderArena);
+    std::pmr::vector<const ShaderFiles*> affected(scope.resource());
+    for (const ShaderFiles& files : gShaderFiles)
+    {
+        bool changed = false;
+        for (const char* path : { files.vertPath, files.fragPath })
+        {
+            const ShaderSource* source = gShaderSources.expand(path, files.defines);
+            for (const FileChange& change : changes)
+                changed = changed || (source && std::find(source->files.begin(), source->files.end(), change.path) != source->files.end());
+        }
+        if (changed)
+            affected.push_back(&files);
+    }
+
+    // The watcher already read the saved files
+    for (const FileChange& change : changes)
+        gShaderSources.updateFile(change.path, change.contents);
+
+    for (const ShaderFiles* files : affected)
+    {
+        const ShaderSource* vertexSource = gShaderSources.expand(files->vertPath, files->defines);
+        const ShaderSource* fragmentSource = gShaderSources.expand(files->fragPath, files->defines);
+        if (!vertexSource || !fragmentSource)
+            continue;
+
+        SDL_Log("Shader source changed, rebuilding %s + %s.\n", files->vertPath, files->fragPath);
+        gShaders.reload(files->handle, vertexSource->text, fragmentSource->text);
+    }
+
+    // An edit may have added or removed an #include
+    std::vector<std::string> paths = shaderFilePaths();
+    if (paths != gShaderWatchPaths)
+    {
+        gShaderWatchPaths = paths;
+        gShaderWatcher.start(paths);
+    }
+}
+
 void handleKeys(SDL_Scancode key)
 {
     if (key == SDL_SCANCODE_Q)
     {
         gRenderQuad = !gRenderQuad;
     }
+    else if (key == SDL_SCANCODE_I)
+    {
+        // Cycle Scene -> PerObject -> Instanced
+        gRenderMode = (RenderMode)(((int)gRenderMode + 1) % 3);
+    }
+    else if (key == SDL_SCANCODE_F9)
+    {
+        profilerWriteChromeTrace("profile.json");
+    }
 }
 
-void update(float deltaTime)
+void update(Uint64 elapsedNs)
 {
-    timeFactor += deltaTime;
+    PROFILE_ZONE("update");
+    MemoryTagScope memoryTag(MemoryTag::Render);
+
+    // Blocks while the render thread still holds every packet, a second update() without render() refills the same one
+    if (!gWritingPacket)
+        gWritingPacket = gFramePackets.beginWrite();
+    if (!gWritingPacket)
+        return;
+    gWritingPacket->updateStart = SDL_GetPerformanceCounter();
+
+    // As many whole ticks as the elapsed time covers, the frame then shows the scene alpha of the way to the next one
+    int ticks = gSimulationClock.advance(elapsedNs);
+    for (int tick = 0; tick < ticks; ++tick)
+        simulateTick(gSimulationClock.tickSeconds());
+    float alpha = gInterpolate ? gSimulationClock.alpha() : 1.0f;
+
+    // Only objects moved since the last frame are rebuilt and re-uploaded
+    buildFramePacket(*gWritingPacket, gTransforms.updateWorldMatrices(alpha), alpha);
 }
 
-glm::mat4 buildRotateZ(float rad) {
-    glm::mat4 zrot = glm::mat4(cos(rad), -sin(rad), 0.0, 0.0,
-        sin(rad), cos(rad), 0.0, 0.0,
-        0.0, 0.0, 1.0, 0.0,
-        0.0, 0.0, 0.0, 1.0);
-    return zrot;
+void simulateTick(float tickSeconds)
+{
+    PROFILE_ZONE("Tick");
+
+    gTransforms.beginTick();
+    timeFactor += tickSeconds;
+
+    if (gAnimateObjects)
+    {
+        for (int i = 0; i < gObjectCount; ++i)
+            gTransforms.setRotation(gGridFirst + i, glm::vec3(0.0f, timeFactor + i * 0.01f, 0.0f));
+    }
 }
 
-glm::mat4 buildRotateX(float rad) {
-    glm::mat4 xrot = glm::mat4(1.0, 0.0, 0.0, 0.0,
-        0.0, cos(rad), -sin(rad), 0.0,
-        0.0, sin(rad), cos(rad), 0.0,
-        0.0, 0.0, 0.0, 1.0);
-    return xrot;
+void buildFramePacket(FramePacket& packet, const TransformUpdate& update, float alpha)
+{
+    PROFILE_ZONE("Build packet");
+
+    // The lists start over in the emptied packet arena, each is sized once so it takes a single block
+    packet.reset();
+    packet.frame = ++gFrameIndex;
+    packet.input = gPendingInput;
+    gPendingInput = 0;
+    packet.timeFactor = timeFactor - (1.0f - alpha) * gSimulationClock.tickSeconds();
+    packet.drawScene = gRenderQuad;
+    packet.view = affineInverse(gTransforms.world(gCameraId));
+    packet.gridInstances = 0;
+    packet.gridUpdateFirst = 0;
+
+    // The instance buffer only has to be current while it is drawn, switching to it uploads the whole grid
+    const bool instanced = gRenderMode == RenderMode::Instanced && gInstancedReady;
+    TransformId gridLast = gGridFirst + (TransformId)gObjectCount - 1;
+    bool gridRebuilt = update.rebuilt > 0 && gObjectCount > 0 && update.last >= gGridFirst && update.first <= gridLast;
+    if (!instanced)
+    {
+        gInstanceBufferStale = gInstanceBufferStale || gridRebuilt;
+    }
+    else if (gInstanceBufferStale || gridRebuilt)
+    {
+        // Clip the rebuilt range to the grid
+        TransformId first = gInstanceBufferStale ? gGridFirst : std::max(update.first, gGridFirst);
+        TransformId last = gInstanceBufferStale ? gridLast : std::min(update.last, gridLast);
+        packet.gridUpdateFirst = first - gGridFirst;
+        packet.gridUpdate.assign(gTransforms.worldData() + first, gTransforms.worldData() + last + 1);
+        gInstanceBufferStale = false;
+    }
+
+    if (!gRenderQuad)
+        return;
+
+    if (instanced)
+    {
+        packet.gridInstances = gObjectCount;
+    }
+    else if (gRenderMode != RenderMode::Scene)
+    {
+        packet.gridModelViews.resize(gObjectCount);
+        gJobs.parallelFor(packet.gridModelViews.size(), kTransformGrain, [&](size_t begin, size_t end)
+        {
+            affineMultiplyBatch(packet.view, gTransforms.worldData() + gGridFirst + begin, packet.gridModelViews.data() + begin, end - begin);
+        });
+    }
+    else
+    {
+        packet.draws.reserve(2);
+
+        PacketDraw draw;
+        draw.mesh = PacketMesh::Cube;
+        draw.modelView = affineMultiply(packet.view, gTransforms.world(gCubeId));
+        draw.color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f); // Red color for cube
+        packet.draws.push_back(draw);
+
+        draw.mesh = PacketMesh::Pyramid;
+        draw.modelView = affineMultiply(packet.view, gTransforms.world(gPyramidId));
+        draw.color = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f); // Green color for pyramid
+        packet.draws.push_back(draw);
+    }
 }
 
-// builds and returns a matrix that performs a rotation around the Y axis
-glm::mat4 buildRotateY(float rad) {
-    glm::mat4 yrot = glm::mat4(cos(rad), 0.0, sin(rad), 0.0,
-        0.0, 1.0, 0.0, 0.0,
-        -sin(rad), 0.0, cos(rad), 0.0,
-        0.0, 0.0, 0.0, 1.0);
-    return yrot;
+void setMeshDraw(DrawCommand& command, const MeshDraw& mesh)
+{
+    command.indexType = mesh.indexType;
+    command.first = mesh.firstIndex;
+    command.vertexCount = mesh.indexCount;
+}
+
+void queueScene(const FramePacket& packet)
+{
+    DrawCommand command;
+    command.program = renderingProgram;
+    for (const PacketDraw& draw : packet.draws)
+    {
+        bool cube = draw.mesh == PacketMesh::Cube;
+        command.vertexArray = cube ? vao[0] : vao[2];
+        setMeshDraw(command, cube ? gCubeMesh : gPyramidMesh);
+        command.modelView = draw.modelView;
+        command.color = draw.color;
+        gRenderQueue.push(RenderPass::Opaque, (Uint16)draw.mesh, command);
+    }
+}
+
+void queuePerObject(const FramePacket& packet)
+{
+    // One draw per cube
+    DrawCommand command;
+    command.program = renderingProgram;
+    command.vertexArray = vao[0];
+    setMeshDraw(command, gCubeMesh);
+    command.color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    for (const Affine& modelView : packet.gridModelViews)
+    {
+        command.modelView = modelView;
+        gRenderQueue.push(RenderPass::Opaque, 0, command);
+    }
+}
+
+void queueInstanced(const FramePacket& packet)
+{
+    // Every cube in one call, model matrices come from the instance buffer
+    DrawCommand command;
+    command.program = instancedProgram;
+    command.vertexArray = vao[1];
+    setMeshDraw(command, gCubeMesh);
+    command.instanceCount = (GLsizei)packet.gridInstances;
+    command.modelView = affineIdentity();
+    if (command.instanceCount > 0 && instancedProgram != 0)
+        gRenderQueue.push(RenderPass::Opaque, 0, command);
 }
 
 void render(float deltaTime)
 {
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // Fixed: Clear both buffers at once
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    PROFILE_ZONE("render");
 
-    if (!gRenderQuad)
+    if (!gWritingPacket)
         return;
+    FramePacket* packet = gWritingPacket;
+    gWritingPacket = nullptr;
+    gFramePackets.endWrite(packet);
 
-    glUseProgram(renderingProgram);
+    // The render thread picks the packet up, otherwise it is the only one queued
+    if (gRenderThread.joinable())
+        return;
+    packet = gFramePackets.beginRead();
+    drawFramePacket(*packet);
+    gFramePackets.endRead(packet);
+}
 
-    // Update view matrix
-    vMat = glm::translate(glm::mat4(1.0f), -camera);
+void drawFramePacket(const FramePacket& packet)
+{
+    PROFILE_ZONE("Draw packet");
+    MemoryTagScope memoryTag(MemoryTag::Render);
 
-    // Bind VAO
-    glBindVertexArray(vao[0]);
+    profilerBeginFrame();
+    gRenderArena.reset();
+    gDrawnFrame = FrameTiming();
+    gDrawnFrame.frame = packet.frame;
+    gDrawnFrame.updateStart = packet.updateStart;
+    gDrawnFrame.input = packet.input;
 
-    // Draw cube
-    mMat = glm::translate(glm::mat4(1.0f), cube);
-    mvMat = vMat * mMat * buildRotateY(glm::radians(40.0f));
+    gFrameCounters = FrameCounters();
+    gStateCache.resetCounters();
 
-    glUniformMatrix4fv(pLoc, 1, GL_FALSE, glm::value_ptr(pMat));
-    glUniformMatrix4fv(mvLoc, 1, GL_FALSE, glm::value_ptr(mvMat));
-    glUniform4f(uColorLoc, 1.0f, 0.0f, 0.0f, 1.0f); // Red color for cube
+    gFrameRing.beginFrame();
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
+    // Switch to programs that finished building since the last frame, edited shaders swap in here too
+    if (gWatchShaders)
+        reloadChangedShaders();
+    if (gShaders.update())
+        resolvePrograms();
+    gTextures.update();
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    // Textures over their budget are evicted here, between frames of GL work
+    enforceMemoryBudgets();
 
-    // Draw pyramid
-    mMat = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 1.0f, 1.0f)); // Fixed: Better positioning
-    mvMat = vMat * mMat * buildRotateX(glm::radians(30.0f));
+    uploadGridTransforms(packet.gridUpdateFirst, packet.gridUpdate.data(), packet.gridUpdate.size());
 
-    glUniformMatrix4fv(mvLoc, 1, GL_FALSE, glm::value_ptr(mvMat));
-    glUniformMatrix4fv(pLoc, 1, GL_FALSE, glm::value_ptr(pMat));
-    glUniform4f(uColorLoc, 0.0f, 1.0f, 0.0f, 1.0f); // Green color for pyramid
+    gStateCache.clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // Fixed: Clear both buffers at once
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
+    if (packet.drawScene)
+    {
+        vMat = affineToMat4(packet.view);
+
+        gRenderQueue.clear();
+        if (packet.gridInstances > 0)
+            queueInstanced(packet);
+        else if (!packet.gridModelViews.empty())
+            queuePerObject(packet);
+        else
+            queueScene(packet);
+
+        {
+            PROFILE_ZONE("Sort queue");
+            gRenderQueue.sort();
+        }
 
-    glDrawArrays(GL_TRIANGLES, 0, 18);
+        // Per-frame uniforms, per-draw data goes through gFrameRing
+        gStateCache.enable(GL_DEPTH_TEST);
+        gStateCache.depthFunc(GL_LEQUAL);
+        gStateCache.bindTexture(0, GL_TEXTURE_2D, gTextures.texture(gBaseTexture));
+        gStateCache.useProgram(renderingProgram);
+        gStateCache.uniformMatrix4fv(pLoc, glm::value_ptr(pMat));
+        if (instancedProgram != 0)
+        {
+            gStateCache.useProgram(instancedProgram);
+            gStateCache.uniformMatrix4fv(vLoc, glm::value_ptr(vMat));
+            gStateCache.uniformMatrix4fv(projLoc, glm::value_ptr(pMat));
+            gStateCache.uniform1f(tfLoc, packet.timeFactor);
+        }
+
+        // Per-object mode is the one-draw-per-cube baseline instanced mode is compared against, its draws stay separate
+        gRenderBackend.setBatching(packet.gridModelViews.empty());
+
+        RenderQueueStats stats;
+        {
+            PROFILE_ZONE("Submit queue");
+            PROFILE_GPU_ZONE("Draw queue");
+            stats = gRenderQueue.submit(gRenderBackend);
+        }
+        gFrameCounters.drawCalls = stats.drawCalls;
+        gFrameCounters.instances = stats.instances;
+        gFrameCounters.vertices = stats.vertices;
+    }
+
+    gFrameRing.endFrame();
+
+    gFrameCounters.stateCallsIssued = gStateCache.counters().issued;
+    gFrameCounters.stateCallsFiltered = gStateCache.counters().filtered;
+    gDrawnFrame.counters = gFrameCounters;
 
     // Check for OpenGL errors
     GLenum err;
@@ -411,93 +973,265 @@ void render(float deltaTime)
     }
 }
 
-void close()
+void presentDrawnFrame()
 {
-    // Deallocate OpenGL resources
-    glDeleteProgram(renderingProgram);
-    glDeleteVertexArrays(numVAOs, vao);
-    glDeleteBuffers(numVBOs, vbo);
+    {
+        PROFILE_ZONE("SwapWindow");
+        SDL_GL_SwapWindow(gWindow);
+        if (gFinishFrames)
+            glFinish();
+    }
+    gDrawnFrame.presented = SDL_GetPerformanceCounter();
 
-    // Destroy window
-    SDL_DestroyWindow(gWindow);
-    gWindow = nullptr;
+    // Nobody may be collecting, keep the newest frames only; the list keeps its capacity so presenting never allocates
+    std::lock_guard<std::mutex> lock(gFrameTimingMutex);
+    if (gFrameTimings.size() >= 4096)
+        gFrameTimings.erase(gFrameTimings.begin(), gFrameTimings.begin() + 2048);
+    gFrameTimings.push_back(gDrawnFrame);
+}
 
-    // Quit SDL subsystems
-    SDL_Quit();
+void present()
+{
+    Uint64 submitted = SDL_GetPerformanceCounter();
+
+    // The render thread presents every frame it draws, the pacer then sees when this thread handed the frame over
+    if (!gRenderThread.joinable())
+        presentDrawnFrame();
+    gFramePacer.endFrame(submitted, SDL_GetPerformanceCounter());
+}
+
+void waitForNextFrame()
+{
+    PROFILE_ZONE("Pacing");
+    gFramePacer.waitForFrame();
 }
 
-void printProgramLog(GLuint program)
+void noteInput(Uint64 timestampNs)
 {
-    if (glIsProgram(program))
+    // Event timestamps are SDL_GetTicksNS, frame timings count performance counter ticks
+    Uint64 nowNs = SDL_GetTicksNS();
+    Uint64 age = nowNs > timestampNs ? nowNs - timestampNs : 0;
+    Uint64 ticks = SDL_GetPerformanceCounter() - age * SDL_GetPerformanceFrequency() / 1000000000ull;
+    if (gPendingInput == 0)
+        gPendingInput = ticks;
+}
+
+void takeFrameTimings(std::vector<FrameTiming>& timings)
+{
+    std::lock_guard<std::mutex> lock(gFrameTimingMutex);
+    timings.insert(timings.end(), gFrameTimings.begin(), gFrameTimings.end());
+    gFrameTimings.clear();
+}
+
+void renderThreadLoop()
+{
+    profilerSetThreadName("Render");
+    SDL_GL_MakeCurrent(gWindow, gContext);
+
+    // Packets are released before the swap so update() can fill the next one while it blocks
+    while (FramePacket* packet = gFramePackets.beginRead())
     {
-        int infoLogLength = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
-        if (infoLogLength > 0)
-        {
-            std::vector<char> infoLog(infoLogLength);
-            glGetProgramInfoLog(program, infoLogLength, nullptr, infoLog.data());
-            SDL_Log("Program Log: %s\n", infoLog.data());
-        }
+        PROFILE_ZONE("Frame");
+        drawFramePacket(*packet);
+        gFramePackets.endRead(packet);
+        presentDrawnFrame();
     }
-    else
+
+    SDL_GL_MakeCurrent(gWindow, nullptr);
+}
+
+bool startRenderThread(int packets)
+{
+    if (gRenderThread.joinable() || gWritingPacket)
+        return false;
+
+    // The context can only be current on one thread
+    if (!SDL_GL_MakeCurrent(gWindow, nullptr))
     {
-        SDL_Log("Name %d is not a program\n", program);
+        SDL_Log("Unable to release the OpenGL context! SDL Error: %s\n", SDL_GetError());
+        return false;
     }
+    gFramePackets.init(std::max(packets, 2));
+    gRenderThread = std::thread(renderThreadLoop);
+    return true;
+}
+
+void stopRenderThread()
+{
+    if (!gRenderThread.joinable())
+        return;
+
+    // Queued packets are still drawn and presented, a packet update() filled without render() is dropped
+    gFramePackets.close();
+    gRenderThread.join();
+    gWritingPacket = nullptr;
+    gFramePackets.init(1);
+    SDL_GL_MakeCurrent(gWindow, gContext);
 }
 
-void printShaderLog(GLuint shader)
+void updateDebugOverlay(float deltaTime)
 {
-    if (glIsShader(shader))
+    static float elapsed = 0.0f;
+    static int frames = 0;
+    static double inputLatencyMs = 0.0;
+    static FrameCounters counters;
+    static std::vector<FrameTiming> presented;
+
+    // Counts presented frames, which trail update() by a frame with the render thread
+    presented.clear();
+    takeFrameTimings(presented);
+    for (const FrameTiming& timing : presented)
     {
-        int infoLogLength = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
-        if (infoLogLength > 0)
-        {
-            std::vector<char> infoLog(infoLogLength);
-            glGetShaderInfoLog(shader, infoLogLength, nullptr, infoLog.data());
-            SDL_Log("Shader Log: %s\n", infoLog.data());
-        }
+        frames++;
+        counters = timing.counters;
+        if (timing.input != 0)
+            inputLatencyMs = (double)(timing.presented - timing.input) * 1000.0 / (double)SDL_GetPerformanceFrequency();
     }
-    else
+
+    elapsed += deltaTime;
+    if (elapsed < 0.5f)
+        return;
+
+    // Refreshed twice a second so the title stays readable
+    char title[256];
+    const FramePacingStats& pacing = gFramePacer.stats();
+    SDL_snprintf(title, sizeof(title), "SDL Tutorial | %.1f fps | input %.1f ms | %s, %llu missed | %u draws | state calls %u issued, %u filtered",
+        frames / elapsed, inputLatencyMs, pacingModeName(gFramePacer.mode()), (unsigned long long)pacing.missedDeadlines,
+        counters.drawCalls, counters.stateCallsIssued, counters.stateCallsFiltered);
+    SDL_SetWindowTitle(gWindow, title);
+
+    elapsed = 0.0f;
+    frames = 0;
+}
+
+void close()
+{
+    // Frames in flight are presented and the context comes back to this thread
+    stopRenderThread();
+
+    // Deallocate OpenGL resources
+    gShaderWatcher.stop();
+    profilerShutdown();
+    gTextures.shutdown();
+    gJobs.shutdown();
+    gFrameRing.destroy();
+    gAssets.close();
+    gShaders.shutdown();
+    glDeleteVertexArrays(numVAOs, vao);
+    for (GLuint buffer : vbo)
+        untrackGpuMemory(MemoryDomain::GpuBuffer, buffer);
+    untrackGpuMemory(MemoryDomain::GpuBuffer, gIBO);
+    glDeleteBuffers(numVBOs, vbo);
+    glDeleteBuffers(1, &gIBO);
+
+    // What the frames grew goes too, so anything a tag still holds below is a leak
+    gTransforms.release();
+    gFramePackets.release();
+    gWritingPacket = nullptr;
+    gRenderQueue.release();
+    gRenderArena.reserve(0);
+    gProgramReflection.clear();
+    gStateCache.invalidate();
     {
-        SDL_Log("Name %d is not a shader\n", shader);
+        std::lock_guard<std::mutex> lock(gFrameTimingMutex);
+        std::vector<FrameTiming>().swap(gFrameTimings);
     }
+
+    // Every tagged allocation and GL object should be released by now, the context goes with the window
+    reportMemoryLeaks();
+
+    // Destroy window
+    SDL_DestroyWindow(gWindow);
+    gWindow = nullptr;
+
+    // Quit SDL subsystems
+    SDL_Quit();
 }
 
 int main(int argc, char* args[])
 {
-    if (!init())
+    int benchmarkResult = 0;
+    if (runPackerFromArgs(argc, args, benchmarkResult))
+        return benchmarkResult;
+    if (runTextureCompressorFromArgs(argc, args, benchmarkResult))
+        return benchmarkResult;
+    if (runBenchmarkFromArgs(argc, args, benchmarkResult))
+        return benchmarkResult;
+
+    profilerSetThreadName("Main");
+
+    InitOptions options;
+    bool renderThread = false;
+    int framePackets = 2;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(args[i], "--watch-shaders") == 0)
+            options.watchShaders = true;
+        else if (strcmp(args[i], "--render-thread") == 0)
+            renderThread = true;
+        else if (strcmp(args[i], "--frame-packets") == 0 && i + 1 < argc)
+            framePackets = atoi(args[++i]);
+        else if (strcmp(args[i], "--tick-rate") == 0 && i + 1 < argc)
+            options.tickRate = atof(args[++i]);
+        else if (strcmp(args[i], "--no-interpolation") == 0)
+            options.interpolate = false;
+        else if (strcmp(args[i], "--pacing") == 0 && i + 1 < argc)
+        {
+            if (!parsePacingMode(args[++i], options.pacing))
+                SDL_Log("Unknown pacing mode %s, expected off, limit or jit.\n", args[i]);
+        }
+        else if (strcmp(args[i], "--target-fps") == 0 && i + 1 < argc)
+            options.targetFps = atof(args[++i]);
+        else if (strcmp(args[i], "--swap-interval") == 0 && i + 1 < argc)
+            options.swapInterval = atoi(args[++i]);
+        else if (strcmp(args[i], "--texture-budget") == 0 && i + 1 < argc)
+            options.textureBudgetMB = atoi(args[++i]);
+    }
+
+    if (!init(options))
     {
         SDL_Log("Failed to initialize!\n");
         return 1;
     }
+    if (renderThread && !startRenderThread(framePackets))
+        SDL_Log("Rendering on the main thread instead.\n");
 
     bool quit = false;
     SDL_Event e;
-    Uint32 lastTime = SDL_GetTicks();
+    Uint64 lastTime = SDL_GetTicksNS();
 
     while (!quit)
     {
+        // Input is polled right after the pacer releases the frame, as late as JustInTime can afford
+        waitForNextFrame();
+
         // Calculate delta time
-        Uint32 currentTime = SDL_GetTicks();
-        float deltaTime = (currentTime - lastTime) / 1000.0f;
+        Uint64 currentTime = SDL_GetTicksNS();
+        Uint64 elapsedNs = currentTime - lastTime;
+        float deltaTime = (float)((double)elapsedNs / 1e9);
         lastTime = currentTime;
 
-        while (SDL_PollEvent(&e))
+        PROFILE_ZONE("Frame");
         {
-            if (e.type == SDL_EVENT_QUIT)
-            {
-                quit = true;
-            }
-            else if (e.type == SDL_EVENT_KEY_DOWN)
+            PROFILE_ZONE("PollEvents");
+            while (SDL_PollEvent(&e))
             {
-                handleKeys(e.key.scancode);
+                if (e.type == SDL_EVENT_QUIT)
+                {
+                    quit = true;
+                }
+                else if (e.type == SDL_EVENT_KEY_DOWN)
+                {
+                    noteInput(e.key.timestamp);
+                    handleKeys(e.key.scancode);
+                }
             }
         }
 
-        update(deltaTime);
+        update(elapsedNs);
         render(deltaTime);
-        SDL_GL_SwapWindow(gWindow);
+        present();
+        updateDebugOverlay(deltaTime);
     }
 
     close();
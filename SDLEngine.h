@@ -0,0 +1,149 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include "FixedTimestep.h"
+#include "FramePacer.h"
+#include <vector>
+
+//Screen dimension constants
+const int SCREEN_WIDTH = 1940;
+const int SCREEN_HEIGHT = 1080;
+
+//How the scene objects are submitted
+enum class RenderMode
+{
+    //The cube and pyramid scene
+    Scene,
+
+    //A grid of cubes with one draw call per cube
+    PerObject,
+
+    //The same grid of cubes in a single instanced draw call
+    Instanced
+};
+
+//Startup options
+struct InitOptions
+{
+    //Render to an offscreen surface instead of a visible window
+    bool headless = false;
+
+    //Value passed to SDL_GL_SetSwapInterval: 1 vsync, -1 adaptive vsync (vsync where unsupported), 0 off
+    int swapInterval = 1;
+
+    //How the main loop paces frames on top of the swap interval; targetFps 0 paces to the display refresh rate
+    PacingMode pacing = PacingMode::Off;
+    double targetFps = 0.0;
+
+    //Time JustInTime leaves between submitting the slowest recent frame and its deadline
+    double pacingMarginMs = 2.0;
+
+    RenderMode renderMode = RenderMode::Scene;
+
+    //Number of cubes drawn by the PerObject and Instanced modes
+    int objectCount = 100000;
+
+    //Rotate every grid cube in update(), rebuilding all of their world matrices each frame
+    bool animateObjects = false;
+
+    //Load and store linked programs in the shadercache directory
+    bool shaderCache = true;
+
+    //Development mode, rebuild programs whenever their .glsl files are saved
+    bool watchShaders = false;
+
+    //Threads of gJobs, the main thread included, 0 uses one per core
+    int jobThreads = 0;
+
+    //glFinish after every swap so present times include the GPU work
+    bool finishFrames = false;
+
+    //Simulation ticks per second; update() runs as many as the elapsed time covers, at most maxTicksPerFrame
+    double tickRate = 60.0;
+    int maxTicksPerFrame = 8;
+
+    //Draw moving objects between the last two ticks rather than where the last one left them
+    bool interpolate = true;
+
+    //Video memory textures may take before the least recently drawn are evicted, 0 for no limit
+    int textureBudgetMB = 0;
+};
+
+//Counters reset at the start of every render() call
+struct FrameCounters
+{
+    Uint32 drawCalls = 0;
+    Uint64 instances = 0;
+    Uint64 vertices = 0;
+
+    //GL state changes forwarded by gStateCache and the redundant ones it dropped
+    Uint32 stateCallsIssued = 0;
+    Uint32 stateCallsFiltered = 0;
+};
+
+//When a frame was simulated and presented, in SDL_GetPerformanceCounter ticks
+struct FrameTiming
+{
+    Uint64 frame = 0;
+    Uint64 updateStart = 0;
+    Uint64 presented = 0;
+
+    //Oldest input the frame was the first to see, 0 when there was none
+    Uint64 input = 0;
+
+    FrameCounters counters;
+};
+
+//Starts up SDL, creates window, and initializes OpenGL
+bool init(const InitOptions& options = InitOptions());
+
+//Input handler
+void handleKeys(SDL_Scancode key);
+
+//Blocks until the frame pacer lets the next frame start, call before sampling input
+void waitForNextFrame();
+
+//Stamps an input event (SDL_GetTicksNS time) onto the next frame, its FrameTiming then gives the input latency
+void noteInput(Uint64 timestampNs);
+
+//Per frame update, runs the fixed ticks elapsedNs (SDL_GetTicksNS time since the last frame) covers and fills a frame packet; with the render thread it waits for a free packet first
+void update(Uint64 elapsedNs);
+
+//Renders the packet update() filled, or hands it to the render thread
+void render(float deltaTime);
+
+//Swaps the window and ends the frame for the pacer; the render thread presents what it renders, so this only ends the frame while it runs
+void present();
+
+/**
+ * Moves rendering and presenting onto a thread that takes over the GL
+ * context. render() then only queues the packet update() filled, and the
+ * render thread submits frame N while the calling thread simulates frame
+ * N+1. packets (2 or 3) bounds how far simulation runs ahead. Call between
+ * frames; no GL calls may be made on other threads until stopRenderThread().
+ */
+bool startRenderThread(int packets = 2);
+
+//Presents the frames in flight and makes the GL context current on the calling thread again
+void stopRenderThread();
+
+//Appends the frames presented since the last call to timings, oldest first
+void takeFrameTimings(std::vector<FrameTiming>& timings);
+
+//Frees media and shuts down SDL
+void close();
+
+//The window we'll be rendering to
+extern SDL_Window* gWindow;
+
+//Counters of the last rendered frame, written by the thread that renders
+extern FrameCounters gFrameCounters;
+
+//Clock of the simulation ticks update() runs
+extern FixedTimestep gSimulationClock;
+
+//Paces the frames of the main loop, its stats() count missed deadlines
+extern FramePacer gFramePacer;
+
+//Swap interval in effect after init()
+extern int gSwapInterval;
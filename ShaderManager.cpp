@@ -0,0 +1,357 @@
+#include "ShaderManager.h"
+#include "GLStateCache.h"
+#include "ProgramBinaryCache.h"
+#include "ProgramReflection.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+
+namespace
+{
+    GLuint createShader(GLenum type, const std::string& source)
+    {
+        GLuint shader = glCreateShader(type);
+        const char* text = source.c_str();
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    //GL_COMPLETION_STATUS_KHR never blocks, GL_COMPILE_STATUS and GL_LINK_STATUS do
+    bool shaderDone(GLuint shader)
+    {
+        GLint done = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    bool programDone(GLuint program)
+    {
+        GLint done = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+}
+
+void ShaderManager::init()
+{
+    mParallel = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+
+    // Let the driver pick how many compiler threads to use
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+
+    if (!mParallel)
+        SDL_Log("Parallel shader compile unavailable, programs finish one stage per frame.\n");
+}
+
+void ShaderManager::shutdown()
+{
+    for (Entry& entry : mEntries)
+    {
+        if (entry.vertexShader)
+            glDeleteShader(entry.vertexShader);
+        if (entry.fragmentShader)
+            glDeleteShader(entry.fragmentShader);
+        if (entry.program)
+        {
+            gStateCache.forgetProgram(entry.program);
+            gProgramReflection.forget(entry.program);
+            glDeleteProgram(entry.program);
+        }
+    }
+    std::vector<Entry>().swap(mEntries);
+}
+
+ShaderManager::Entry ShaderManager::build(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource, GLuint fallback)
+{
+    Entry entry;
+    entry.name = name;
+    entry.fallback = fallback;
+
+    const char* sources[2] = { vertexSource.c_str(), fragmentSource.c_str() };
+    entry.cacheKey = gProgramCache.key(sources, 2);
+    entry.program = gProgramCache.load(entry.cacheKey);
+    if (entry.program)
+    {
+        gProgramReflection.reflect(entry.program);
+        entry.stage = Stage::Ready;
+    }
+    else
+    {
+        entry.vertexShader = createShader(GL_VERTEX_SHADER, vertexSource);
+        entry.fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentSource);
+    }
+    return entry;
+}
+
+ProgramHandle ShaderManager::request(const char* name, const std::string& vertexSource, const std::string& fragmentSource, GLuint fallback)
+{
+    PROFILE_ZONE("ShaderManager::request");
+    MemoryTagScope memoryTag(MemoryTag::Shaders);
+
+    // Requests that expand to the same permutation share one program
+    const char* sources[2] = { vertexSource.c_str(), fragmentSource.c_str() };
+    Uint64 cacheKey = gProgramCache.key(sources, 2);
+    for (size_t i = 0; i < mEntries.size(); ++i)
+    {
+        const Entry& entry = mEntries[i];
+        if (entry.cacheKey == cacheKey && entry.replaces == kInvalidProgram && entry.stage != Stage::Failed)
+            return (ProgramHandle)i;
+    }
+
+    mEntries.push_back(build(name, vertexSource, fragmentSource, fallback));
+    return (ProgramHandle)(mEntries.size() - 1);
+}
+
+void ShaderManager::reload(ProgramHandle handle, const std::string& vertexSource, const std::string& fragmentSource)
+{
+    PROFILE_ZONE("ShaderManager::reload");
+    MemoryTagScope memoryTag(MemoryTag::Shaders);
+
+    if (handle >= mEntries.size() || mEntries[handle].replaces != kInvalidProgram)
+        return;
+
+    // A newer edit supersedes a reload still in flight
+    for (Entry& pending : mEntries)
+    {
+        if (pending.replaces == handle && (pending.stage == Stage::Compiling || pending.stage == Stage::Linking))
+        {
+            glDeleteShader(pending.vertexShader);
+            glDeleteShader(pending.fragmentShader);
+            if (pending.program)
+                glDeleteProgram(pending.program);
+            pending.vertexShader = 0;
+            pending.fragmentShader = 0;
+            pending.program = 0;
+            pending.stage = Stage::Retired;
+        }
+    }
+
+    Entry entry = build(mEntries[handle].name + " (reload)", vertexSource, fragmentSource, 0);
+    entry.replaces = handle;
+    mEntries.push_back(entry);
+}
+
+void ShaderManager::swapIn(Entry& entry)
+{
+    Entry& target = mEntries[entry.replaces];
+    if (entry.stage == Stage::Ready)
+    {
+        if (target.program)
+        {
+            gStateCache.forgetProgram(target.program);
+            gProgramReflection.forget(target.program);
+            glDeleteProgram(target.program);
+        }
+        target.program = entry.program;
+        target.cacheKey = entry.cacheKey;
+        target.stage = Stage::Ready;
+        SDL_Log("Reloaded shader program %s.\n", target.name.c_str());
+    }
+    else
+    {
+        SDL_Log("Keeping the previous build of %s.\n", target.name.c_str());
+    }
+
+    entry.program = 0;
+    entry.stage = Stage::Retired;
+}
+
+bool ShaderManager::advance(Entry& entry, bool block)
+{
+    if (entry.stage == Stage::Compiling)
+    {
+        if (!block && !(shaderDone(entry.vertexShader) && shaderDone(entry.fragmentShader)))
+            return false;
+
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(entry.vertexShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled)
+        {
+            printShaderLog(entry.vertexShader);
+            fail(entry);
+            return true;
+        }
+        glGetShaderiv(entry.fragmentShader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled)
+        {
+            printShaderLog(entry.fragmentShader);
+            fail(entry);
+            return true;
+        }
+
+        entry.program = glCreateProgram();
+        glAttachShader(entry.program, entry.vertexShader);
+        glAttachShader(entry.program, entry.fragmentShader);
+        glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(entry.program);
+        entry.stage = Stage::Linking;
+        return true;
+    }
+
+    if (entry.stage == Stage::Linking)
+    {
+        if (!block && !programDone(entry.program))
+            return false;
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(entry.program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            printProgramLog(entry.program);
+            fail(entry);
+            return true;
+        }
+
+        glDetachShader(entry.program, entry.vertexShader);
+        glDetachShader(entry.program, entry.fragmentShader);
+        glDeleteShader(entry.vertexShader);
+        glDeleteShader(entry.fragmentShader);
+        entry.vertexShader = 0;
+        entry.fragmentShader = 0;
+
+        gProgramCache.store(entry.cacheKey, entry.program);
+        gProgramReflection.reflect(entry.program);
+        entry.stage = Stage::Ready;
+        return true;
+    }
+
+    return false;
+}
+
+void ShaderManager::fail(Entry& entry)
+{
+    SDL_Log("Failed to build shader program %s.\n", entry.name.c_str());
+
+    if (entry.vertexShader)
+        glDeleteShader(entry.vertexShader);
+    if (entry.fragmentShader)
+        glDeleteShader(entry.fragmentShader);
+    if (entry.program)
+        glDeleteProgram(entry.program);
+
+    entry.vertexShader = 0;
+    entry.fragmentShader = 0;
+    entry.program = 0;
+    entry.stage = Stage::Failed;
+}
+
+bool ShaderManager::update()
+{
+    PROFILE_ZONE("ShaderManager::update");
+    MemoryTagScope memoryTag(MemoryTag::Shaders);
+
+    bool finished = false;
+    bool advanced = false;
+    for (Entry& entry : mEntries)
+    {
+        if (entry.stage == Stage::Compiling || entry.stage == Stage::Linking)
+        {
+            if (advanced && !mParallel)
+                continue;
+            advanced = true;
+
+            if (mParallel)
+            {
+                // Completion queries are free, advance everything the driver is done with
+                while (advance(entry, false))
+                    ;
+            }
+            else
+            {
+                // One blocking stage per frame
+                advance(entry, true);
+            }
+
+            finished = finished || entry.stage == Stage::Ready || entry.stage == Stage::Failed;
+        }
+
+        // Reloads swap in at the frame boundary, including ones served from the binary cache
+        if (entry.replaces != kInvalidProgram && (entry.stage == Stage::Ready || entry.stage == Stage::Failed))
+        {
+            swapIn(entry);
+            finished = true;
+        }
+    }
+    return finished;
+}
+
+void ShaderManager::wait(ProgramHandle handle)
+{
+    if (handle >= mEntries.size())
+        return;
+
+    Entry& entry = mEntries[handle];
+    while (advance(entry, true))
+        ;
+}
+
+GLuint ShaderManager::program(ProgramHandle handle) const
+{
+    if (handle >= mEntries.size())
+        return 0;
+
+    const Entry& entry = mEntries[handle];
+    return entry.stage == Stage::Ready ? entry.program : entry.fallback;
+}
+
+bool ShaderManager::ready(ProgramHandle handle) const
+{
+    return handle < mEntries.size() && mEntries[handle].stage == Stage::Ready;
+}
+
+bool ShaderManager::failed(ProgramHandle handle) const
+{
+    return handle < mEntries.size() && mEntries[handle].stage == Stage::Failed;
+}
+
+size_t ShaderManager::pendingCount() const
+{
+    size_t pending = 0;
+    for (const Entry& entry : mEntries)
+    {
+        if (entry.stage == Stage::Compiling || entry.stage == Stage::Linking)
+            pending++;
+    }
+    return pending;
+}
+
+void printProgramLog(GLuint program)
+{
+    if (glIsProgram(program))
+    {
+        int infoLogLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+        if (infoLogLength > 0)
+        {
+            std::vector<char> infoLog(infoLogLength);
+            glGetProgramInfoLog(program, infoLogLength, nullptr, infoLog.data());
+            SDL_Log("Program Log: %s\n", infoLog.data());
+        }
+    }
+    else
+    {
+        SDL_Log("Name %d is not a program\n", program);
+    }
+}
+
+void printShaderLog(GLuint shader)
+{
+    if (glIsShader(shader))
+    {
+        int infoLogLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+        if (infoLogLength > 0)
+        {
+            std::vector<char> infoLog(infoLogLength);
+            glGetShaderInfoLog(shader, infoLogLength, nullptr, infoLog.data());
+            SDL_Log("Shader Log: %s\n", infoLog.data());
+        }
+    }
+    else
+    {
+        SDL_Log("Name %d is not a shader\n", shader);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+//Index of a program in a ShaderManager
+typedef Uint32 ProgramHandle;
+
+const ProgramHandle kInvalidProgram = 0xFFFFFFFFu;
+
+/**
+ * Builds shader programs without stalling the frame.
+ *
+ * request() submits the compile of both stages right away and returns.
+ * With GL_KHR_parallel_shader_compile (or the ARB variant) update() polls
+ * GL_COMPLETION_STATUS_KHR and only queries compile/link status once the
+ * driver reports the work done. Without it update() advances a single
+ * program by one stage per call, so the blocking status queries are spread
+ * over frames instead of all landing in one. Until a program is ready,
+ * program() returns the fallback given to request().
+ *
+ * Programs are looked up in gProgramCache first; a cache hit is ready
+ * immediately. Every program is reflected into gProgramReflection as soon
+ * as it is ready and dropped from it when deleted.
+ *
+ * reload() builds the new sources in a hidden entry the same way. Only
+ * when it links does update() swap it into the original handle, so a
+ * broken edit leaves the last good program in place.
+ */
+class ShaderManager
+{
+public:
+    //Needs a current GL context
+    void init();
+
+    //Deletes every program the manager built
+    void shutdown();
+
+    bool parallel() const { return mParallel; }
+
+    //name is only used in log messages, fallback may be 0. Identical sources return the existing handle
+    ProgramHandle request(const char* name, const std::string& vertexSource, const std::string& fragmentSource, GLuint fallback = 0);
+
+    //Rebuilds a program from new sources, the old one stays in use until the new one links
+    void reload(ProgramHandle handle, const std::string& vertexSource, const std::string& fragmentSource);
+
+    //Polls pending programs, returns true when any of them became ready or failed
+    bool update();
+
+    //Blocks until the program is ready or failed
+    void wait(ProgramHandle handle);
+
+    //The built program once ready, the fallback until then or after a failure
+    GLuint program(ProgramHandle handle) const;
+
+    bool ready(ProgramHandle handle) const;
+    bool failed(ProgramHandle handle) const;
+    size_t pendingCount() const;
+
+private:
+    enum class Stage
+    {
+        Compiling,
+        Linking,
+        Ready,
+        Failed,
+        Retired
+    };
+
+    struct Entry
+    {
+        std::string name;
+        GLuint vertexShader = 0;
+        GLuint fragmentShader = 0;
+        GLuint program = 0;
+        GLuint fallback = 0;
+        Uint64 cacheKey = 0;
+        ProgramHandle replaces = kInvalidProgram;
+        Stage stage = Stage::Compiling;
+    };
+
+    //Moves an entry one stage on, returns false when it has to wait for the driver
+    bool advance(Entry& entry, bool block);
+    void fail(Entry& entry);
+    Entry build(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource, GLuint fallback);
+    void swapIn(Entry& entry);
+
+    std::vector<Entry> mEntries;
+    bool mParallel = false;
+};
+
+//Shader loading utility programs
+void printProgramLog(GLuint program);
+void printShaderLog(GLuint shader);
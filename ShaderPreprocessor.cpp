@@ -0,0 +1,242 @@
+#include "ShaderPreprocessor.h"
+#include "AssetArchive.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+namespace
+{
+    const int kMaxIncludeDepth = 16;
+
+    std::string normalizedPath(const std::filesystem::path& path)
+    {
+        return path.lexically_normal().generic_string();
+    }
+
+    //Returns the directive name of a preprocessor line ("version", "include", ...) and where its arguments start
+    std::string_view directive(std::string_view line, size_t& argument)
+    {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string_view::npos || line[i] != '#')
+            return std::string_view();
+
+        i = line.find_first_not_of(" \t", i + 1);
+        if (i == std::string_view::npos)
+            return std::string_view();
+
+        size_t end = i;
+        while (end < line.size() && isalpha((unsigned char)line[end]))
+            end++;
+        argument = end;
+        return line.substr(i, end - i);
+    }
+
+    //Splits off the next line without copying, false at the end of the text
+    bool nextLine(std::string_view text, size_t& position, std::string_view& line)
+    {
+        if (position >= text.size())
+            return false;
+
+        size_t end = text.find('\n', position);
+        if (end == std::string_view::npos)
+            end = text.size();
+        line = text.substr(position, end - position);
+        position = end + 1;
+        return true;
+    }
+
+    void appendLine(std::string& text, int line, size_t file)
+    {
+        text += "#line " + std::to_string(line) + " " + std::to_string(file) + "\n";
+    }
+}
+
+std::string ShaderPreprocessor::permutationKey(const std::string& path, const ShaderDefines& defines)
+{
+    std::vector<std::string> names;
+    for (const ShaderDefine& define : defines)
+        names.push_back(define.name + "=" + define.value);
+    std::sort(names.begin(), names.end());
+
+    std::string key = normalizedPath(path);
+    for (const std::string& name : names)
+        key += "\n" + name;
+    return key;
+}
+
+const ShaderSource* ShaderPreprocessor::expand(const std::string& path, const ShaderDefines& defines)
+{
+    std::string key = permutationKey(path, defines);
+    auto cached = mPermutations.find(key);
+    if (cached != mPermutations.end())
+    {
+        mCounters.hits++;
+        return &cached->second;
+    }
+
+    PROFILE_ZONE("ShaderPreprocessor::expand");
+
+    std::string defineBlock;
+    for (const ShaderDefine& define : defines)
+        defineBlock += "#define " + define.name + (define.value.empty() ? "" : " " + define.value) + "\n";
+
+    ShaderSource source;
+    bool expanded = expandFile(normalizedPath(path), defineBlock, source, 0);
+
+    // Mappings are only held during an expansion, an open mapping would stop editors truncating the file on Windows
+    for (auto it = mFiles.begin(); it != mFiles.end();)
+    {
+        if (it->second.edited)
+            ++it;
+        else
+            it = mFiles.erase(it);
+    }
+    if (!expanded)
+        return nullptr;
+
+    mCounters.expansions++;
+    return &mPermutations.emplace(key, std::move(source)).first->second;
+}
+
+bool ShaderPreprocessor::expandFile(const std::string& path, const std::string& defineBlock, ShaderSource& source, int depth)
+{
+    // Every file is pasted once, repeated includes are dropped like #pragma once
+    if (std::find(source.files.begin(), source.files.end(), path) != source.files.end())
+        return true;
+
+    if (depth > kMaxIncludeDepth)
+        return false;
+
+    std::string_view contents;
+    if (!readFile(path, contents))
+        return false;
+
+    size_t index = source.files.size();
+    source.files.push_back(path);
+    if (depth > 0)
+        appendLine(source.text, 1, index);
+
+    // Only the root file takes the defines, right after its #version or first if it has none
+    bool definesPlaced = depth > 0 || defineBlock.empty();
+    std::string_view line;
+    size_t position = 0;
+    int lineNumber = 0;
+    while (nextLine(contents, position, line))
+    {
+        lineNumber++;
+        size_t argument = 0;
+        std::string_view name = directive(line, argument);
+
+        if (name == "version")
+        {
+            if (depth == 0)
+            {
+                source.text.append(line);
+                source.text += "\n" + defineBlock;
+                appendLine(source.text, lineNumber + 1, index);
+                definesPlaced = true;
+            }
+            else
+            {
+                // Only the root file decides the version
+                source.text += "\n";
+            }
+            continue;
+        }
+
+        if (!definesPlaced)
+        {
+            source.text += defineBlock;
+            appendLine(source.text, lineNumber, index);
+            definesPlaced = true;
+        }
+
+        if (name == "include")
+        {
+            size_t open = line.find('"', argument);
+            size_t close = open == std::string_view::npos ? std::string_view::npos : line.find('"', open + 1);
+            if (close == std::string_view::npos)
+            {
+                SDL_Log("%s(%d): malformed #include.\n", path.c_str(), lineNumber);
+                return false;
+            }
+
+            std::string included = normalizedPath(std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1));
+            if (!expandFile(included, defineBlock, source, depth + 1))
+            {
+                SDL_Log("%s(%d): cannot include %s.\n", path.c_str(), lineNumber, included.c_str());
+                return false;
+            }
+            appendLine(source.text, lineNumber + 1, index);
+            continue;
+        }
+
+        source.text.append(line);
+        source.text += "\n";
+    }
+    return true;
+}
+
+bool ShaderPreprocessor::readFile(const std::string& path, std::string_view& contents)
+{
+    auto cached = mFiles.find(path);
+    if (cached == mFiles.end())
+    {
+        CachedFile file;
+        const ArchiveEntry* entry = gAssets.isOpen() ? gAssets.find(path) : nullptr;
+        if (entry)
+        {
+            // Stored entries are a view into the archive mapping
+            std::span<const Uint8> bytes;
+            if (!gAssets.read(*entry, bytes, file.unpacked))
+                return false;
+            file.text = std::string_view((const char*)bytes.data(), bytes.size());
+        }
+        else
+        {
+            // Expansion reads straight from the mapping, the file is never copied whole
+            if (!file.file.open(path.c_str()))
+                return false;
+            file.text = file.file.text();
+        }
+        cached = mFiles.emplace(path, std::move(file)).first;
+    }
+
+    contents = cached->second.text;
+    return true;
+}
+
+bool ShaderPreprocessor::updateFile(const std::string& path, const std::string& contents)
+{
+    std::string file = normalizedPath(path);
+    CachedFile& cached = mFiles[file];
+    cached.file.close();
+    cached.unpacked.clear();
+    cached.contents = contents;
+    cached.text = cached.contents;
+    cached.edited = true;
+
+    bool used = false;
+    for (auto it = mPermutations.begin(); it != mPermutations.end();)
+    {
+        const std::vector<std::string>& files = it->second.files;
+        if (std::find(files.begin(), files.end(), file) != files.end())
+        {
+            it = mPermutations.erase(it);
+            used = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return used;
+}
+
+void ShaderPreprocessor::clear()
+{
+    mFiles.clear();
+    mPermutations.clear();
+    mCounters = ShaderPreprocessorCounters();
+}
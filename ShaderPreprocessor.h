@@ -0,0 +1,79 @@
+#pragma once
+#include "MappedFile.h"
+#include <SDL3/SDL.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//A #define injected into an expanded shader, an empty value defines the name only
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
+typedef std::vector<ShaderDefine> ShaderDefines;
+
+//One expanded permutation of a shader file
+struct ShaderSource
+{
+    std::string text;
+
+    //The file and everything it includes, #line source numbers index this list
+    std::vector<std::string> files;
+};
+
+//Expansions since the last clear()
+struct ShaderPreprocessorCounters
+{
+    Uint32 expansions = 0;
+    Uint32 hits = 0;
+};
+
+/**
+ * Expands #include directives and injects #defines into GLSL files.
+ *
+ * #include "file" is resolved relative to the including file and every
+ * file is included at most once per expansion. The defines go right after
+ * the #version line, so a feature is compiled in or out instead of being
+ * branched on at runtime. Each expansion is cached under its file and
+ * define set; the define order does not matter. Files come from gAssets
+ * when it is open and holds them, otherwise they are read through
+ * MappedFile and only stay mapped while an expansion runs. updateFile()
+ * pins new contents for a file and drops every permutation that used it.
+ */
+class ShaderPreprocessor
+{
+public:
+    //nullptr when the file or one of its includes cannot be read
+    const ShaderSource* expand(const std::string& path, const ShaderDefines& defines = ShaderDefines());
+
+    //Returns true when a cached permutation depended on the file
+    bool updateFile(const std::string& path, const std::string& contents);
+
+    void clear();
+
+    //Cache key of a permutation
+    static std::string permutationKey(const std::string& path, const ShaderDefines& defines);
+
+    const ShaderPreprocessorCounters& counters() const { return mCounters; }
+
+private:
+    //Mapped or unpacked for the current expansion, or pinned by updateFile()
+    struct CachedFile
+    {
+        MappedFile file;
+        std::vector<Uint8> unpacked;
+        std::string contents;
+        std::string_view text;
+        bool edited = false;
+    };
+
+    bool readFile(const std::string& path, std::string_view& contents);
+    bool expandFile(const std::string& path, const std::string& defineBlock, ShaderSource& source, int depth);
+
+    std::unordered_map<std::string, CachedFile> mFiles;
+    std::unordered_map<std::string, ShaderSource> mPermutations;
+    ShaderPreprocessorCounters mCounters;
+};
@@ -0,0 +1,124 @@
+#include "BenchmarkCommon.h"
+#include "SDLEngine.h"
+#include "TextureManager.h"
+#include <filesystem>
+#include <string>
+
+using namespace bench;
+
+namespace
+{
+    //Noise keeps the BMPs from being trivially cheap for the decoder to skip through
+    bool writeTestImage(const std::string& path, int size, Uint32 seed)
+    {
+        SDL_Surface* surface = SDL_CreateSurface(size, size, SDL_PIXELFORMAT_RGBA32);
+        if (!surface)
+            return false;
+
+        Uint32 state = seed * 2654435761u + 1;
+        for (int y = 0; y < size; ++y)
+        {
+            Uint32* row = (Uint32*)((Uint8*)surface->pixels + (size_t)surface->pitch * y);
+            for (int x = 0; x < size; ++x)
+            {
+                state = state * 1664525u + 1013904223u;
+                row[x] = state | 0xFF000000u;
+            }
+        }
+
+        bool ok = SDL_SaveBMP(surface, path.c_str());
+        SDL_DestroySurface(surface);
+        return ok;
+    }
+}
+
+int runTextureBenchmark(int argc, char* args[])
+{
+    const char* outPath = findArg(argc, args, "--out");
+    const int count = std::max(1, intArg(argc, args, "--count", 64));
+    const int size = std::max(1, intArg(argc, args, "--size", 1024));
+    const int threads = std::max(0, intArg(argc, args, "--threads", 0));
+    const GLsizeiptr budget = (GLsizeiptr)std::max(1, intArg(argc, args, "--budget", 8)) << 20;
+
+    const std::filesystem::path directory = "bench_textures.tmp";
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < count; ++i)
+    {
+        paths.push_back((directory / ("image" + std::to_string(i) + ".bmp")).generic_string());
+        if (!writeTestImage(paths.back(), size, (Uint32)i))
+        {
+            SDL_Log("Unable to write benchmark image %s: %s\n", paths.back().c_str(), SDL_GetError());
+            std::filesystem::remove_all(directory, error);
+            return 1;
+        }
+    }
+
+    InitOptions options;
+    options.headless = true;
+    options.swapInterval = 0;
+    if (!init(options))
+    {
+        SDL_Log("Failed to initialize benchmark!\n");
+        std::filesystem::remove_all(directory, error);
+        return 1;
+    }
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out)
+    {
+        SDL_Log("Unable to open benchmark output %s\n", outPath);
+        close();
+        std::filesystem::remove_all(directory, error);
+        return 1;
+    }
+
+    // A manager of its own so the scene texture does not count towards the totals
+    TextureManager textures;
+    textures.init(threads, budget);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (const std::string& path : paths)
+        textures.load(path.c_str());
+
+    // Each iteration stands in for a frame, update() is what the render thread would pay
+    std::vector<double> updateMs;
+    while (textures.pendingCount() > 0)
+    {
+        Uint64 updateStart = SDL_GetPerformanceCounter();
+        textures.update();
+        updateMs.push_back(elapsedMs(updateStart, SDL_GetPerformanceCounter()));
+        SDL_GL_SwapWindow(gWindow);
+    }
+    glFinish();
+    const double totalMs = elapsedMs(start, SDL_GetPerformanceCounter());
+
+    const TextureLoadCounters& counters = textures.counters();
+    const double decodedMb = (double)counters.bytesDecoded / (1 << 20);
+    const double uploadedMb = (double)counters.bytesUploaded / (1 << 20);
+    Stats stats = computeStats(updateMs);
+
+    fprintf(out, "{\n  \"benchmark\": \"textures\",\n  \"count\": %d,\n  \"size\": %d,\n  \"workers\": %d,\n  \"upload_budget_mb\": %.1f,\n",
+        count, size, textures.workerCount(), (double)budget / (1 << 20));
+    fprintf(out, "  \"resident\": %u,\n  \"failed\": %u,\n  \"frames\": %zu,\n  \"total_ms\": %.3f,\n",
+        counters.resident, counters.failed, updateMs.size(), totalMs);
+    // Decode throughput is per worker-second, wall throughput counts the whole pipeline
+    fprintf(out, "  \"decode_mb_per_sec\": %.1f,\n  \"upload_mb_per_sec\": %.1f,\n  \"wall_mb_per_sec\": %.1f,\n",
+        counters.decodeMs > 0.0 ? decodedMb / (counters.decodeMs / 1000.0) : 0.0,
+        counters.uploadMs > 0.0 ? uploadedMb / (counters.uploadMs / 1000.0) : 0.0,
+        totalMs > 0.0 ? uploadedMb / (totalMs / 1000.0) : 0.0);
+    writeStats(out, "update_ms", stats);
+    fprintf(out, "  \"compressed\": %u,\n  \"decode_ms\": %.3f,\n  \"mip_ms\": %.3f,\n  \"compress_ms\": %.3f,\n  \"upload_ms\": %.3f\n}\n",
+        counters.compressed, counters.decodeMs, counters.mipMs, counters.compressMs, counters.uploadMs);
+
+    if (out != stdout)
+        fclose(out);
+
+    const bool ok = counters.resident == (Uint32)count;
+    textures.shutdown();
+    close();
+    std::filesystem::remove_all(directory, error);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+#include "TextureContainer.h"
+#include "TextureManager.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    const Uint32 kMagic = 0x58455442; // "BTEX"
+    const Uint32 kVersion = 1;
+    const Uint32 kMaxLevels = 32;
+    const Uint64 kLevelAlignment = 16;
+
+    struct ContainerHeader
+    {
+        Uint32 magic;
+        Uint32 version;
+        BlockFormat format;
+        Uint32 levelCount;
+    };
+
+    struct ContainerLevel
+    {
+        Uint32 width;
+        Uint32 height;
+        Uint64 offset;
+        Uint64 size;
+    };
+
+    static_assert(sizeof(ContainerHeader) == 16, "ContainerHeader is written to disk as is");
+    static_assert(sizeof(ContainerLevel) == 24, "ContainerLevel is written to disk as is");
+
+    Uint64 alignUp(Uint64 value, Uint64 alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool readTextureContainer(std::span<const Uint8> bytes, BlockChain& chain)
+{
+    ContainerHeader header;
+    if (bytes.size() < sizeof(header))
+        return false;
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion || (Uint32)header.format > (Uint32)BlockFormat::BC7
+        || header.levelCount == 0 || header.levelCount > kMaxLevels
+        || sizeof(header) + (size_t)header.levelCount * sizeof(ContainerLevel) > bytes.size())
+        return false;
+
+    chain.format = header.format;
+    chain.levels.clear();
+    chain.blocks.clear();
+    for (Uint32 i = 0; i < header.levelCount; ++i)
+    {
+        ContainerLevel entry;
+        memcpy(&entry, bytes.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+
+        // Each level has to be half the one before and hold exactly its blocks
+        bool valid = entry.width > 0 && entry.height > 0 && entry.width <= 16384 && entry.height <= 16384
+            && entry.size == blockImageSize(header.format, (int)entry.width, (int)entry.height)
+            && entry.offset <= bytes.size() && entry.size <= bytes.size() - entry.offset;
+        if (valid && i > 0)
+        {
+            const MipLevel& above = chain.levels.back();
+            valid = (int)entry.width == std::max(1, above.width / 2) && (int)entry.height == std::max(1, above.height / 2);
+        }
+        if (!valid)
+            return false;
+
+        MipLevel level;
+        level.width = (int)entry.width;
+        level.height = (int)entry.height;
+        level.offset = chain.blocks.size();
+        chain.levels.push_back(level);
+        chain.blocks.insert(chain.blocks.end(), bytes.data() + entry.offset, bytes.data() + entry.offset + entry.size);
+    }
+    return true;
+}
+
+bool writeTextureContainer(const char* path, const BlockChain& chain)
+{
+    ContainerHeader header;
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.format = chain.format;
+    header.levelCount = (Uint32)chain.levels.size();
+
+    std::vector<ContainerLevel> entries(chain.levels.size());
+    Uint64 offset = alignUp(sizeof(header) + entries.size() * sizeof(ContainerLevel), kLevelAlignment);
+    for (size_t i = 0; i < chain.levels.size(); ++i)
+    {
+        entries[i].width = (Uint32)chain.levels[i].width;
+        entries[i].height = (Uint32)chain.levels[i].height;
+        entries[i].offset = offset;
+        entries[i].size = chain.levelSize(i);
+        offset = alignUp(offset + entries[i].size, kLevelAlignment);
+    }
+
+    std::string tempPath = std::string(path) + ".tmp";
+    FILE* out = fopen(tempPath.c_str(), "wb");
+    if (!out)
+    {
+        SDL_Log("Unable to open texture output %s\n", tempPath.c_str());
+        return false;
+    }
+
+    static const Uint8 padding[kLevelAlignment] = {};
+    Uint64 position = 0;
+    auto write = [&](const void* data, size_t size)
+    {
+        position += size;
+        return size == 0 || fwrite(data, 1, size, out) == size;
+    };
+    bool ok = write(&header, sizeof(header)) && write(entries.data(), entries.size() * sizeof(ContainerLevel));
+    for (size_t i = 0; i < entries.size() && ok; ++i)
+        ok = write(padding, (size_t)(entries[i].offset - position)) && write(chain.level(i), (size_t)entries[i].size);
+    ok = fclose(out) == 0 && ok;
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(tempPath, path, error);
+    if (!ok || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        SDL_Log("Unable to write texture %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+std::string textureContainerPath(const std::string& imagePath)
+{
+    return std::filesystem::path(imagePath).replace_extension(".btex").generic_string();
+}
+
+bool runTextureCompressorFromArgs(int argc, char* args[], int& exitCode)
+{
+    bool requested = false;
+    for (int i = 1; i < argc; ++i)
+        requested = requested || strcmp(args[i], "--compress-textures") == 0;
+    if (!requested)
+        return false;
+
+    bool autoFormat = true;
+    BlockOptions options;
+    MipOptions mipOptions;
+    std::vector<std::string> files;
+    exitCode = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* value = i + 1 < argc ? args[i + 1] : "";
+        if (strcmp(args[i], "--format") == 0)
+        {
+            autoFormat = strcmp(value, "auto") == 0;
+            if (!autoFormat && !parseBlockFormat(value, options.format))
+            {
+                SDL_Log("Unknown block format %s\n", value);
+                return true;
+            }
+            ++i;
+        }
+        else if (strcmp(args[i], "--quality") == 0)
+        {
+            if (strcmp(value, "fast") == 0)
+                options.quality = BlockQuality::Fast;
+            else if (strcmp(value, "high") == 0)
+                options.quality = BlockQuality::High;
+            else
+            {
+                SDL_Log("Unknown compression quality %s\n", value);
+                return true;
+            }
+            ++i;
+        }
+        else if (strcmp(args[i], "--filter") == 0)
+        {
+            if (strcmp(value, "box") == 0)
+                mipOptions.filter = MipFilter::Box;
+            else if (strcmp(value, "kaiser") == 0)
+                mipOptions.filter = MipFilter::Kaiser;
+            else
+            {
+                SDL_Log("Unknown mip filter %s\n", value);
+                return true;
+            }
+            ++i;
+        }
+        else if (strcmp(args[i], "--threads") == 0)
+        {
+            options.threads = atoi(value);
+            ++i;
+        }
+        else if (args[i][0] != '-')
+        {
+            files.push_back(args[i]);
+        }
+    }
+
+    if (files.empty())
+    {
+        std::error_code error;
+        for (const auto& item : std::filesystem::directory_iterator(".", error))
+        {
+            std::string extension = item.path().extension().string();
+            if (item.is_regular_file() && (extension == ".bmp" || extension == ".png"))
+                files.push_back(item.path().filename().string());
+        }
+    }
+
+    for (const std::string& file : files)
+    {
+        int width, height;
+        std::vector<Uint8> pixels;
+        if (!decodeImageFile(file, width, height, pixels))
+        {
+            SDL_Log("Unable to read %s\n", file.c_str());
+            return true;
+        }
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        MipChain mips;
+        generateMipChain(pixels.data(), width, height, mipOptions, mips);
+        if (autoFormat)
+            options.format = chooseBlockFormat(pixels.data(), (size_t)width * height);
+        BlockChain chain;
+        compressMipChain(mips, options, chain);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+        std::string outputPath = textureContainerPath(file);
+        if (!writeTextureContainer(outputPath.c_str(), chain))
+            return true;
+        printf("%-32s %5dx%-5d %s %2d levels %10zu -> %10zu bytes %8.1f ms\n", outputPath.c_str(), width, height,
+            blockFormatName(chain.format), (int)chain.levels.size(), mips.pixels.size(), chain.blocks.size(), ms);
+    }
+
+    exitCode = 0;
+    return true;
+}
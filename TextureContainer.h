@@ -0,0 +1,34 @@
+#pragma once
+#include "BlockCompressor.h"
+#include <span>
+#include <string>
+
+/**
+ * Precompressed textures on disk (.btex).
+ *
+ * A header, one entry per mip level, then the blocks of every level at
+ * 16-byte aligned offsets, with rows bottom-up like TextureManager uploads
+ * them, so loading is a bounds check and a copy per level. TextureManager
+ * looks for the .btex of an image before decoding the image itself.
+ */
+bool readTextureContainer(std::span<const Uint8> bytes, BlockChain& chain);
+
+//Written through a temporary file like packArchive, so a running app never reads half a texture
+bool writeTextureContainer(const char* path, const BlockChain& chain);
+
+//The image path with its extension replaced by .btex
+std::string textureContainerPath(const std::string& imagePath);
+
+/**
+ * Runs the texture compressor when the command line asks for it.
+ *
+ *   --compress-textures [--format auto|bc1|bc3|bc5|bc7] [--quality fast|high]
+ *                       [--filter box|kaiser] [--threads N] [file ...]
+ *
+ * Builds the mip chain of every image (by default the .bmp and .png files
+ * in the working directory), compresses it and writes a .btex beside it. auto
+ * picks BC1 for opaque images and BC3 otherwise. Returns false when no
+ * compression was requested, otherwise stores the process exit code in
+ * exitCode.
+ */
+bool runTextureCompressorFromArgs(int argc, char* args[], int& exitCode);
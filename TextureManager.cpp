@@ -0,0 +1,524 @@
+#include "TextureManager.h"
+#include "AssetArchive.h"
+#include "GLStateCache.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "TextureContainer.h"
+#include <SDL3_image/SDL_image.h>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const int kBytesPerPixel = 4;
+
+    //Contents of a file from gAssets when it holds it, else from disk
+    bool readAsset(const std::string& path, MappedFile& file, std::vector<Uint8>& scratch, std::span<const Uint8>& bytes)
+    {
+        const ArchiveEntry* entry = gAssets.isOpen() ? gAssets.find(path) : nullptr;
+        if (entry)
+            return gAssets.read(*entry, bytes, scratch);
+        if (!file.open(path.c_str()))
+            return false;
+        bytes = file.bytes();
+        return true;
+    }
+
+    bool readContainer(const std::string& path, BlockChain& chain)
+    {
+        std::vector<Uint8> scratch;
+        std::span<const Uint8> bytes;
+        MappedFile file;
+        if (!readAsset(path, file, scratch, bytes))
+            return false;
+        if (readTextureContainer(bytes, chain))
+            return true;
+        SDL_Log("%s is not a valid texture, loading the image instead.\n", path.c_str());
+        return false;
+    }
+
+    GLenum compressedFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        default:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    //BC1 and BC3 need EXT_texture_compression_s3tc, BC5 and BC7 are core in GL 4.3
+    bool needsS3tc(BlockFormat format)
+    {
+        return format == BlockFormat::BC1 || format == BlockFormat::BC3;
+    }
+}
+
+bool decodeImageFile(const std::string& path, int& width, int& height, std::vector<Uint8>& pixels)
+{
+    std::vector<Uint8> scratch;
+    std::span<const Uint8> bytes;
+    MappedFile file;
+    if (!readAsset(path, file, scratch, bytes))
+        return false;
+
+    SDL_IOStream* stream = SDL_IOFromConstMem(bytes.data(), bytes.size());
+    SDL_Surface* decoded = stream ? IMG_Load_IO(stream, true) : nullptr;
+    if (!decoded)
+    {
+        SDL_Log("Unable to decode %s: %s\n", path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    SDL_Surface* rgba = SDL_ConvertSurface(decoded, SDL_PIXELFORMAT_RGBA32);
+    SDL_DestroySurface(decoded);
+    if (!rgba)
+        return false;
+
+    width = rgba->w;
+    height = rgba->h;
+    const size_t rowBytes = (size_t)width * kBytesPerPixel;
+    pixels.resize(rowBytes * height);
+    for (int y = 0; y < height; ++y)
+        memcpy(pixels.data() + rowBytes * (height - 1 - y), (const Uint8*)rgba->pixels + (size_t)rgba->pitch * y, rowBytes);
+
+    SDL_DestroySurface(rgba);
+    return true;
+}
+
+TextureManager::~TextureManager()
+{
+    // GL objects need the context, shutdown() must have run before; only the threads are stopped here
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers)
+        worker.join();
+}
+
+bool TextureManager::init(int workerCount, GLsizeiptr uploadBudget)
+{
+    shutdown();
+    MemoryTagScope memoryTag(MemoryTag::Textures);
+    mCounters = TextureLoadCounters();
+    mFrame = 0;
+
+    // Magenta and black checkers stand out as "not loaded yet"
+    const Uint32 magenta = 0xFFFF00FFu, black = 0xFF000000u;
+    Uint32 checker[8 * 8];
+    for (int i = 0; i < 8 * 8; ++i)
+        checker[i] = ((i / 8 + i % 8) & 1) ? magenta : black;
+
+    glGenTextures(1, &mPlaceholder);
+    gStateCache.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    gStateCache.bindTexture(0, GL_TEXTURE_2D, mPlaceholder);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 8, 8);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 8, 8, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+    trackGpuMemory(MemoryDomain::GpuTexture, mPlaceholder, sizeof(checker), MemoryTag::Textures, GL_RGBA8);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    mS3tc = GLEW_EXT_texture_compression_s3tc != 0;
+
+    if (!mUploadRing.create(uploadBudget, 3, MemoryTag::Textures))
+    {
+        SDL_Log("Failed to create the texture upload ring.\n");
+        return false;
+    }
+
+    if (workerCount <= 0)
+        workerCount = std::clamp(SDL_GetNumLogicalCPUCores() - 1, 1, 8);
+
+    mStopping = false;
+    for (int i = 0; i < workerCount; ++i)
+        mWorkers.emplace_back(&TextureManager::workerLoop, this);
+    return true;
+}
+
+void TextureManager::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        std::deque<DecodeJob>().swap(mJobs);
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers)
+        worker.join();
+    std::vector<std::thread>().swap(mWorkers);
+    std::vector<DecodeResult>().swap(mResults);
+    std::deque<TextureHandle>().swap(mUploads);
+
+    for (Texture& texture : mTextures)
+        releaseTexture(texture);
+    std::vector<Texture>().swap(mTextures);
+
+    if (mPlaceholder)
+    {
+        gStateCache.forgetTexture(mPlaceholder);
+        untrackGpuMemory(MemoryDomain::GpuTexture, mPlaceholder);
+        glDeleteTextures(1, &mPlaceholder);
+        mPlaceholder = 0;
+    }
+    mUploadRing.destroy();
+    if (mBudget)
+        setBudget(0);
+}
+
+void TextureManager::releaseTexture(Texture& texture)
+{
+    if (!texture.texture)
+        return;
+    gStateCache.forgetTexture(texture.texture);
+    untrackGpuMemory(MemoryDomain::GpuTexture, texture.texture);
+    glDeleteTextures(1, &texture.texture);
+    texture.texture = 0;
+}
+
+TextureHandle TextureManager::load(const char* path)
+{
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        if (mTextures[i].path == path)
+            return (TextureHandle)i;
+    }
+
+    MemoryTagScope memoryTag(MemoryTag::Textures);
+    Texture texture;
+    texture.path = path;
+    mTextures.push_back(texture);
+    TextureHandle handle = (TextureHandle)(mTextures.size() - 1);
+    mCounters.requested++;
+    queueDecode(handle);
+    return handle;
+}
+
+void TextureManager::queueDecode(TextureHandle handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back({ handle, mTextures[handle].path, mMipOptions, mCompress, mCompressQuality, mS3tc });
+    }
+    mWake.notify_one();
+}
+
+void TextureManager::setMipOptions(const MipOptions& options)
+{
+    mMipOptions = options;
+}
+
+void TextureManager::setCompression(bool enabled, BlockQuality quality)
+{
+    mCompress = enabled;
+    mCompressQuality = quality;
+}
+
+void TextureManager::workerLoop()
+{
+    profilerSetThreadName("TextureDecode");
+    MemoryTagScope memoryTag(MemoryTag::Textures);
+
+    for (;;)
+    {
+        DecodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+            if (mStopping)
+                return;
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+
+        DecodeResult result;
+        result.handle = job.handle;
+        decodeJob(job, result);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mResults.push_back(std::move(result));
+    }
+}
+
+void TextureManager::decodeJob(const DecodeJob& job, DecodeResult& result)
+{
+    const double msPerTick = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // A precompressed .btex already holds every level, only S3TC blocks without driver support need expanding
+    bool loaded;
+    {
+        PROFILE_ZONE("Read compressed texture");
+        loaded = readContainer(textureContainerPath(job.path), result.blocks);
+    }
+    if (loaded)
+    {
+        result.compressed = job.s3tc || !needsS3tc(result.blocks.format);
+        if (!result.compressed)
+        {
+            decompressBlockChain(result.blocks, result.mips);
+            result.blocks = BlockChain();
+        }
+        result.decodeMs = (double)(SDL_GetPerformanceCounter() - start) * msPerTick;
+        return;
+    }
+
+    int width = 0, height = 0;
+    std::vector<Uint8> pixels;
+    bool decoded;
+    {
+        PROFILE_ZONE("Decode texture");
+        decoded = decodeImageFile(job.path, width, height, pixels);
+    }
+    Uint64 decodeEnd = SDL_GetPerformanceCounter();
+    result.decodeMs = (double)(decodeEnd - start) * msPerTick;
+    if (!decoded)
+        return;
+
+    {
+        PROFILE_ZONE("Generate mips");
+        generateMipChain(pixels.data(), width, height, job.mipOptions, result.mips);
+    }
+    Uint64 mipEnd = SDL_GetPerformanceCounter();
+    result.mipMs = (double)(mipEnd - decodeEnd) * msPerTick;
+    if (!job.compress)
+        return;
+
+    // Each worker already has a texture of its own, so one thread per image; BC7 stands in where S3TC is missing
+    BlockOptions options;
+    options.format = chooseBlockFormat(pixels.data(), (size_t)width * height);
+    if (!job.s3tc)
+        options.format = BlockFormat::BC7;
+    options.quality = job.quality;
+    options.threads = 1;
+    compressMipChain(result.mips, options, result.blocks);
+    result.mips = MipChain();
+    result.compressed = true;
+    result.compressMs = (double)(SDL_GetPerformanceCounter() - mipEnd) * msPerTick;
+}
+
+void TextureManager::update()
+{
+    PROFILE_ZONE("TextureManager::update");
+    MemoryTagScope memoryTag(MemoryTag::Textures);
+    Uint64 start = SDL_GetPerformanceCounter();
+    mFrame++;
+
+    // Evicted textures come back once something draws them again
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        Texture& texture = mTextures[i];
+        if (texture.state == State::Evicted && texture.wanted)
+        {
+            texture.state = State::Decoding;
+            texture.wanted = false;
+            queueDecode((TextureHandle)i);
+        }
+    }
+
+    std::vector<DecodeResult> results;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        results.swap(mResults);
+    }
+    for (DecodeResult& result : results)
+        startUpload(result);
+
+    if (!mUploads.empty())
+    {
+        mUploadRing.beginFrame();
+        GLsizeiptr budget = mUploadRing.frameSize();
+        uploadRows(budget);
+        mUploadRing.endFrame();
+    }
+
+    mCounters.uploadMs += (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+void TextureManager::startUpload(DecodeResult& result)
+{
+    Texture& texture = mTextures[result.handle];
+    mCounters.decodeMs += result.decodeMs;
+    mCounters.mipMs += result.mipMs;
+    mCounters.compressMs += result.compressMs;
+    if (result.mips.levels.empty() && result.blocks.levels.empty())
+    {
+        SDL_Log("Failed to load texture %s.\n", texture.path.c_str());
+        texture.state = State::Failed;
+        mCounters.failed++;
+        return;
+    }
+
+    mCounters.decoded++;
+    texture.compressed = result.compressed;
+    texture.mips = std::move(result.mips);
+    texture.blocks = std::move(result.blocks);
+    const std::vector<MipLevel>& levels = texture.compressed ? texture.blocks.levels : texture.mips.levels;
+    mCounters.bytesDecoded += texture.compressed ? texture.blocks.levelSize(0) : texture.mips.levelSize(0);
+    if (texture.compressed)
+        mCounters.compressed++;
+
+    texture.width = levels[0].width;
+    texture.height = levels[0].height;
+    texture.uploadLevel = 0;
+    texture.uploadedRows = 0;
+    texture.state = State::Uploading;
+
+    // Immutable storage for every level is allocated now, the rows follow as the budget allows
+    const GLenum internalFormat = texture.compressed ? compressedFormat(texture.blocks.format) : GL_RGBA8;
+    texture.gpuBytes = 0;
+    for (size_t level = 0; level < levels.size(); ++level)
+        texture.gpuBytes += texture.compressed ? texture.blocks.levelSize(level) : texture.mips.levelSize(level);
+    glGenTextures(1, &texture.texture);
+    gStateCache.bindTexture(0, GL_TEXTURE_2D, texture.texture);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)levels.size(), internalFormat, texture.width, texture.height);
+    trackGpuMemory(MemoryDomain::GpuTexture, texture.texture, texture.gpuBytes, MemoryTag::Textures, internalFormat);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    mUploads.push_back(result.handle);
+}
+
+void TextureManager::uploadRows(GLsizeiptr& budget)
+{
+    gStateCache.bindBuffer(GL_PIXEL_UNPACK_BUFFER, mUploadRing.buffer());
+
+    while (!mUploads.empty())
+    {
+        // Compressed levels go up in rows of 4x4 blocks, the smallest unit glCompressedTexSubImage2D takes
+        Texture& texture = mTextures[mUploads.front()];
+        const std::vector<MipLevel>& levels = texture.compressed ? texture.blocks.levels : texture.mips.levels;
+        const MipLevel& level = levels[texture.uploadLevel];
+        const Uint8* source = texture.compressed ? texture.blocks.level(texture.uploadLevel) : texture.mips.level(texture.uploadLevel);
+        const int rowHeight = texture.compressed ? 4 : 1;
+        const int levelRows = (level.height + rowHeight - 1) / rowHeight;
+        const GLsizeiptr rowBytes = texture.compressed ? (GLsizeiptr)((level.width + 3) / 4 * blockSize(texture.blocks.format))
+            : (GLsizeiptr)level.width * kBytesPerPixel;
+
+        int rows = (int)std::min<GLsizeiptr>(levelRows - texture.uploadedRows, budget / rowBytes);
+        if (rows <= 0)
+        {
+            if (rowBytes > mUploadRing.frameSize())
+            {
+                SDL_Log("Texture %s is wider than the upload budget.\n", texture.path.c_str());
+                releaseTexture(texture);
+                texture.mips = MipChain();
+                texture.blocks = BlockChain();
+                texture.state = State::Failed;
+                mCounters.failed++;
+                mUploads.pop_front();
+                continue;
+            }
+            break;
+        }
+
+        RingAllocation allocation = mUploadRing.allocate(rowBytes * rows, texture.compressed ? (GLsizeiptr)blockSize(texture.blocks.format) : kBytesPerPixel);
+        if (!allocation.data)
+            break;
+        memcpy(allocation.data, source + rowBytes * texture.uploadedRows, (size_t)allocation.size);
+        mUploadRing.commit(allocation);
+
+        // commit() may bind GL_COPY_WRITE_BUFFER, the unpack binding is untouched
+        gStateCache.bindTexture(0, GL_TEXTURE_2D, texture.texture);
+        const int y = texture.uploadedRows * rowHeight;
+        const int height = std::min(rows * rowHeight, level.height - y);
+        if (texture.compressed)
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)texture.uploadLevel, 0, y, level.width, height,
+                compressedFormat(texture.blocks.format), (GLsizei)allocation.size, (const void*)allocation.offset);
+        }
+        else
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, (GLint)texture.uploadLevel, 0, y, level.width, height, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)allocation.offset);
+        }
+
+        budget -= allocation.size;
+        texture.uploadedRows += rows;
+        mCounters.bytesUploaded += allocation.size;
+
+        if (texture.uploadedRows == levelRows)
+        {
+            texture.uploadedRows = 0;
+            texture.uploadLevel++;
+        }
+        if (texture.uploadLevel == levels.size())
+        {
+            texture.mips = MipChain();
+            texture.blocks = BlockChain();
+            texture.state = State::Resident;
+            mCounters.resident++;
+            mUploads.pop_front();
+        }
+    }
+
+    gStateCache.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+GLuint TextureManager::texture(TextureHandle handle) const
+{
+    if (handle >= mTextures.size())
+        return mPlaceholder;
+    const Texture& texture = mTextures[handle];
+    texture.lastUsed = mFrame;
+    texture.wanted = texture.state == State::Evicted;
+    return texture.state == State::Resident ? texture.texture : mPlaceholder;
+}
+
+void TextureManager::setBudget(Uint64 bytes)
+{
+    MemoryEvictor evictor = [](Uint64 over, void* manager) { return ((TextureManager*)manager)->evict(over); };
+    mBudget = bytes;
+    setMemoryBudget(MemoryTag::Textures, MemoryDomain::GpuTexture, bytes, BudgetAction::Evict, evictor, this);
+}
+
+Uint64 TextureManager::evict(Uint64 bytes)
+{
+    std::vector<TextureHandle> candidates;
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        if (mTextures[i].state == State::Resident && mTextures[i].lastUsed + 1 < mFrame)
+            candidates.push_back((TextureHandle)i);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [this](TextureHandle a, TextureHandle b) { return mTextures[a].lastUsed < mTextures[b].lastUsed; });
+
+    Uint64 freed = 0;
+    for (TextureHandle handle : candidates)
+    {
+        if (freed >= bytes)
+            break;
+        Texture& texture = mTextures[handle];
+        releaseTexture(texture);
+        texture.state = State::Evicted;
+        freed += texture.gpuBytes;
+        mCounters.evicted++;
+        mCounters.bytesEvicted += texture.gpuBytes;
+    }
+    return freed;
+}
+
+bool TextureManager::resident(TextureHandle handle) const
+{
+    return handle < mTextures.size() && mTextures[handle].state == State::Resident;
+}
+
+bool TextureManager::failed(TextureHandle handle) const
+{
+    return handle < mTextures.size() && mTextures[handle].state == State::Failed;
+}
+
+size_t TextureManager::pendingCount() const
+{
+    size_t pending = 0;
+    for (const Texture& texture : mTextures)
+    {
+        if (texture.state == State::Decoding || texture.state == State::Uploading)
+            pending++;
+    }
+    return pending;
+}
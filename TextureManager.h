@@ -0,0 +1,186 @@
+#pragma once
+#include "BlockCompressor.h"
+#include "FrameRingBuffer.h"
+#include "MemoryTracker.h"
+#include "MipGenerator.h"
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Index of a texture in a TextureManager
+typedef Uint32 TextureHandle;
+
+const TextureHandle kInvalidTexture = 0xFFFFFFFFu;
+
+//Totals since init()
+struct TextureLoadCounters
+{
+    Uint32 requested = 0;
+    Uint32 decoded = 0;
+    Uint32 resident = 0;
+    Uint32 failed = 0;
+
+    //Textures stored block-compressed, loaded from a .btex or compressed by a worker
+    Uint32 compressed = 0;
+    Uint64 bytesDecoded = 0;
+
+    //Every level of every texture, which is also what the textures take in video memory
+    Uint64 bytesUploaded = 0;
+
+    //Resident textures dropped to meet the budget, and the bytes that freed
+    Uint32 evicted = 0;
+    Uint64 bytesEvicted = 0;
+
+    //Worker time summed over the workers, upload time spent in update()
+    double decodeMs = 0.0;
+    double mipMs = 0.0;
+    double compressMs = 0.0;
+    double uploadMs = 0.0;
+};
+
+//Reads an image (from gAssets when it holds the file) and converts it to bottom-up RGBA8 rows
+bool decodeImageFile(const std::string& path, int& width, int& height, std::vector<Uint8>& pixels);
+
+/**
+ * Loads textures without blocking the render thread.
+ *
+ * load() queues the file for a pool of worker threads, which read it (from
+ * gAssets when it holds the file), decode it with SDL_image and convert it
+ * to bottom-up RGBA8, then build its mip chain with generateMipChain and
+ * block-compress it (BC1, or BC3 when it has alpha). A .btex written by
+ * --compress-textures next to the image is used instead when it exists.
+ * update() runs once per frame on the render thread: it allocates storage
+ * for newly decoded images and streams the rows of every level through a
+ * FrameRingBuffer bound as GL_PIXEL_UNPACK_BUFFER, with glTexSubImage2D or,
+ * for compressed levels, glCompressedTexSubImage2D in rows of 4x4 blocks,
+ * at most uploadBudget bytes per frame, so a large image is spread over
+ * several frames instead of causing a hitch. Until a
+ * texture is complete, texture() returns a checkerboard placeholder.
+ * Texture storage is charged to MemoryTag::Textures; over setBudget() the
+ * least recently drawn textures are evicted and load again the next time
+ * texture() asks for them.
+ */
+class TextureManager
+{
+public:
+    ~TextureManager();
+
+    //Needs a current GL context, workerCount 0 picks one per spare core
+    bool init(int workerCount = 0, GLsizeiptr uploadBudget = 8 << 20);
+    void shutdown();
+
+    //Requests of the same path share one texture
+    TextureHandle load(const char* path);
+
+    //Filter used for the mip chains of textures loaded from now on
+    void setMipOptions(const MipOptions& options);
+
+    //Whether workers block-compress images that have no .btex, on by default
+    void setCompression(bool enabled, BlockQuality quality = BlockQuality::Fast);
+
+    //Creates and uploads what the workers finished and reloads evicted textures asked for since, call once per frame
+    void update();
+
+    //Video memory the textures may take before enforceMemoryBudgets() evicts some, 0 for no limit
+    void setBudget(Uint64 bytes);
+
+    //Deletes resident textures not drawn in the last frame, least recently drawn first, until bytes are freed; returns the bytes freed
+    Uint64 evict(Uint64 bytes);
+
+    //The texture once fully uploaded, the placeholder until then or after a failure
+    GLuint texture(TextureHandle handle) const;
+
+    bool resident(TextureHandle handle) const;
+    bool failed(TextureHandle handle) const;
+    size_t pendingCount() const;
+
+    GLuint placeholder() const { return mPlaceholder; }
+    int workerCount() const { return (int)mWorkers.size(); }
+    const TextureLoadCounters& counters() const { return mCounters; }
+
+private:
+    enum class State
+    {
+        Decoding,
+        Uploading,
+        Resident,
+        Evicted,
+        Failed
+    };
+
+    struct Texture
+    {
+        std::string path;
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+
+        //Next level and row to upload, rows of blocks when compressed; the chain is dropped once resident
+        size_t uploadLevel = 0;
+        int uploadedRows = 0;
+        bool compressed = false;
+        MipChain mips;
+        BlockChain blocks;
+        State state = State::Decoding;
+
+        //Size of the storage, and the last frame texture() returned it or was asked for it while evicted
+        Uint64 gpuBytes = 0;
+        mutable Uint64 lastUsed = 0;
+        mutable bool wanted = false;
+    };
+
+    struct DecodeJob
+    {
+        TextureHandle handle;
+        std::string path;
+        MipOptions mipOptions;
+        bool compress;
+        BlockQuality quality;
+        bool s3tc;
+    };
+
+    struct DecodeResult
+    {
+        TextureHandle handle;
+        bool compressed = false;
+        MipChain mips;
+        BlockChain blocks;
+        double decodeMs = 0.0;
+        double mipMs = 0.0;
+        double compressMs = 0.0;
+    };
+
+    void queueDecode(TextureHandle handle);
+    void releaseTexture(Texture& texture);
+    void workerLoop();
+    void decodeJob(const DecodeJob& job, DecodeResult& result);
+    void startUpload(DecodeResult& result);
+    void uploadRows(GLsizeiptr& budget);
+
+    std::vector<Texture> mTextures;
+    GLuint mPlaceholder = 0;
+    Uint64 mFrame = 0;
+    Uint64 mBudget = 0;
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<DecodeJob> mJobs;
+    std::vector<DecodeResult> mResults;
+    bool mStopping = false;
+    MipOptions mMipOptions;
+    bool mCompress = true;
+    BlockQuality mCompressQuality = BlockQuality::Fast;
+    bool mS3tc = false;
+
+    //Textures with rows left to upload, oldest first
+    std::deque<TextureHandle> mUploads;
+    FrameRingBuffer mUploadRing;
+
+    TextureLoadCounters mCounters;
+};
@@ -0,0 +1,272 @@
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    //Objects blended on the stack at a time, a multiple of the SIMD width
+    const size_t kBlendBlock = 512;
+}
+
+void TransformStore::reserve(size_t count)
+{
+    MemoryTagScope memoryTag(MemoryTag::Transforms);
+    for (std::vector<float>& component : mComponents)
+        component.reserve(count);
+    mDirty.reserve(count);
+    mWorld.reserve(count);
+    if (mInterpolate)
+    {
+        for (std::vector<float>& component : mPrevious)
+            component.reserve(count);
+        mMoved.reserve(count);
+    }
+}
+
+void TransformStore::clear()
+{
+    for (std::vector<float>& component : mComponents)
+        component.clear();
+    mDirty.clear();
+    mWorld.clear();
+    mDirtyCount = 0;
+    for (std::vector<float>& component : mPrevious)
+        component.clear();
+    mMoved.clear();
+    mMovedCount = 0;
+}
+
+void TransformStore::release()
+{
+    clear();
+    for (std::vector<float>& component : mComponents)
+        std::vector<float>().swap(component);
+    std::vector<Uint8>().swap(mDirty);
+    std::vector<Affine>().swap(mWorld);
+    for (std::vector<float>& component : mPrevious)
+        std::vector<float>().swap(component);
+    std::vector<Uint8>().swap(mMoved);
+}
+
+void TransformStore::setInterpolation(bool enabled)
+{
+    MemoryTagScope memoryTag(MemoryTag::Transforms);
+    if (enabled == mInterpolate)
+        return;
+
+    // Objects caught between two ticks get one last rebuild from their current state
+    for (size_t i = mMovedFirst; mMovedCount > 0 && i <= mMovedLast; ++i)
+    {
+        if (mMoved[i])
+            markDirty((TransformId)i);
+    }
+
+    mInterpolate = enabled;
+    for (int c = 0; c < ComponentCount; ++c)
+    {
+        if (enabled)
+            mPrevious[c] = mComponents[c];
+        else
+            std::vector<float>().swap(mPrevious[c]);
+    }
+    mMoved.assign(enabled ? mWorld.size() : 0, 0);
+    mMovedCount = 0;
+}
+
+void TransformStore::beginTick()
+{
+    if (!mInterpolate || mMovedCount == 0)
+        return;
+
+    // Unmoved objects inside the range already hold equal states, so the whole range is copied
+    const size_t first = mMovedFirst;
+    const size_t count = (size_t)mMovedLast - first + 1;
+    for (int c = 0; c < ComponentCount; ++c)
+        memcpy(mPrevious[c].data() + first, mComponents[c].data() + first, count * sizeof(float));
+
+    // Their matrices still hold a blend, the next update rebuilds them at the state they stopped in
+    for (size_t i = first; i < first + count; ++i)
+    {
+        if (mMoved[i])
+            markDirty((TransformId)i);
+    }
+    memset(mMoved.data() + first, 0, count);
+    mMovedCount = 0;
+}
+
+TransformId TransformStore::create(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    MemoryTagScope memoryTag(MemoryTag::Transforms);
+    TransformId id = (TransformId)mWorld.size();
+    const float values[ComponentCount] = { position.x, position.y, position.z, rotation.x, rotation.y, rotation.z, scale.x, scale.y, scale.z };
+    for (int c = 0; c < ComponentCount; ++c)
+        mComponents[c].push_back(values[c]);
+    if (mInterpolate)
+    {
+        for (int c = 0; c < ComponentCount; ++c)
+            mPrevious[c].push_back(values[c]);
+        mMoved.push_back(0);
+    }
+
+    mDirty.push_back(0);
+    mWorld.push_back(affineIdentity());
+    markDirty(id);
+    return id;
+}
+
+void TransformStore::setPosition(TransformId id, const glm::vec3& position)
+{
+    mComponents[PX][id] = position.x;
+    mComponents[PY][id] = position.y;
+    mComponents[PZ][id] = position.z;
+    markChanged(id);
+}
+
+void TransformStore::setRotation(TransformId id, const glm::vec3& rotation)
+{
+    mComponents[RX][id] = rotation.x;
+    mComponents[RY][id] = rotation.y;
+    mComponents[RZ][id] = rotation.z;
+    markChanged(id);
+}
+
+void TransformStore::setScale(TransformId id, const glm::vec3& scale)
+{
+    mComponents[SX][id] = scale.x;
+    mComponents[SY][id] = scale.y;
+    mComponents[SZ][id] = scale.z;
+    markChanged(id);
+}
+
+glm::vec3 TransformStore::position(TransformId id) const
+{
+    return glm::vec3(mComponents[PX][id], mComponents[PY][id], mComponents[PZ][id]);
+}
+
+glm::vec3 TransformStore::rotation(TransformId id) const
+{
+    return glm::vec3(mComponents[RX][id], mComponents[RY][id], mComponents[RZ][id]);
+}
+
+glm::vec3 TransformStore::scale(TransformId id) const
+{
+    return glm::vec3(mComponents[SX][id], mComponents[SY][id], mComponents[SZ][id]);
+}
+
+void TransformStore::markChanged(TransformId id)
+{
+    markDirty(id);
+    if (!mInterpolate || mMoved[id])
+        return;
+
+    mMoved[id] = 1;
+    if (mMovedCount == 0)
+    {
+        mMovedFirst = id;
+        mMovedLast = id;
+    }
+    else
+    {
+        mMovedFirst = std::min(mMovedFirst, id);
+        mMovedLast = std::max(mMovedLast, id);
+    }
+    mMovedCount++;
+}
+
+void TransformStore::markDirty(TransformId id)
+{
+    if (mDirty[id])
+        return;
+
+    mDirty[id] = 1;
+    if (mDirtyCount == 0)
+    {
+        mDirtyFirst = id;
+        mDirtyLast = id;
+    }
+    else
+    {
+        mDirtyFirst = std::min(mDirtyFirst, id);
+        mDirtyLast = std::max(mDirtyLast, id);
+    }
+    mDirtyCount++;
+}
+
+void TransformStore::composeRange(size_t first, size_t count, float alpha)
+{
+    if (alpha >= 1.0f)
+    {
+        TRSArrays in = {
+            mComponents[PX].data() + first, mComponents[PY].data() + first, mComponents[PZ].data() + first,
+            mComponents[RX].data() + first, mComponents[RY].data() + first, mComponents[RZ].data() + first,
+            mComponents[SX].data() + first, mComponents[SY].data() + first, mComponents[SZ].data() + first };
+        composeTRSBatch(in, mWorld.data() + first, count);
+        return;
+    }
+
+    // Objects that did not move hold equal states, blending leaves them exact
+    float blended[ComponentCount][kBlendBlock];
+    for (size_t done = 0; done < count; done += kBlendBlock)
+    {
+        const size_t n = std::min(kBlendBlock, count - done);
+        for (int c = 0; c < ComponentCount; ++c)
+        {
+            const float* from = mPrevious[c].data() + first + done;
+            const float* to = mComponents[c].data() + first + done;
+            for (size_t k = 0; k < n; ++k)
+                blended[c][k] = from[k] + (to[k] - from[k]) * alpha;
+        }
+        TRSArrays in = {
+            blended[PX], blended[PY], blended[PZ],
+            blended[RX], blended[RY], blended[RZ],
+            blended[SX], blended[SY], blended[SZ] };
+        composeTRSBatch(in, mWorld.data() + first + done, n);
+    }
+}
+
+TransformUpdate TransformStore::updateWorldMatrices(float alpha)
+{
+    // Objects that moved during the tick change with alpha, they are rebuilt every update until the next tick
+    if (!mInterpolate || mMovedCount == 0)
+        alpha = 1.0f;
+    for (size_t i = mMovedFirst; mInterpolate && mMovedCount > 0 && i <= mMovedLast; ++i)
+    {
+        if (mMoved[i])
+            markDirty((TransformId)i);
+    }
+
+    TransformUpdate update;
+    if (mDirtyCount == 0)
+        return update;
+
+    update.rebuilt = mDirtyCount;
+    update.first = mDirtyFirst;
+    update.last = mDirtyLast;
+
+    //Each run of consecutive dirty objects is one batch call
+    const size_t end = (size_t)mDirtyLast + 1;
+    size_t i = mDirtyFirst;
+    while (i < end)
+    {
+        const void* next = memchr(mDirty.data() + i, 1, end - i);
+        if (!next)
+            break;
+
+        i = (const Uint8*)next - mDirty.data();
+        size_t runEnd = i + 1;
+        while (runEnd < end && mDirty[runEnd])
+            ++runEnd;
+
+        gJobs.parallelFor(runEnd - i, kTransformGrain, [&](size_t from, size_t to)
+        {
+            composeRange(i + from, to - from, alpha);
+        });
+        memset(mDirty.data() + i, 0, runEnd - i);
+        i = runEnd;
+    }
+
+    mDirtyCount = 0;
+    return update;
+}
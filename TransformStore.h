@@ -0,0 +1,95 @@
+#pragma once
+#include "AffineMath.h"
+#include <SDL3/SDL.h>
+#include <vector>
+
+//Index of an object in a TransformStore
+typedef Uint32 TransformId;
+
+//Objects per job when transform batches are split across gJobs, a multiple of the SIMD width
+const size_t kTransformGrain = 4096;
+
+//Range of world matrices rebuilt by TransformStore::updateWorldMatrices
+struct TransformUpdate
+{
+    size_t rebuilt = 0;
+    TransformId first = 0;
+    TransformId last = 0;
+};
+
+/**
+ * Scene transforms kept as structure-of-arrays.
+ *
+ * Positions, Euler rotations and scales live in one contiguous float array
+ * per component so updateWorldMatrices() can hand runs of dirty objects
+ * straight to composeTRSBatch. Setters only write the component and set a
+ * dirty flag; world matrices are rebuilt once per update, long runs split
+ * across gJobs.
+ *
+ * With interpolation on, the components as they were at the start of the
+ * current simulation tick are kept too, and updateWorldMatrices(alpha)
+ * builds the objects that moved during that tick from a blend of both, so
+ * a fixed tick rate can be rendered at any frame rate. Euler angles are
+ * blended as they are, which assumes they change little per tick.
+ */
+class TransformStore
+{
+public:
+    void reserve(size_t count);
+    void clear();
+
+    //Removes every object like clear() and frees the storage
+    void release();
+
+    size_t size() const { return mWorld.size(); }
+
+    //Rotation is XYZ Euler angles in radians
+    TransformId create(const glm::vec3& position, const glm::vec3& rotation = glm::vec3(0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+
+    void setPosition(TransformId id, const glm::vec3& position);
+    void setRotation(TransformId id, const glm::vec3& rotation);
+    void setScale(TransformId id, const glm::vec3& scale);
+
+    glm::vec3 position(TransformId id) const;
+    glm::vec3 rotation(TransformId id) const;
+    glm::vec3 scale(TransformId id) const;
+
+    //Keep the state of the previous tick, turning it on starts with both states equal
+    void setInterpolation(bool enabled);
+    bool interpolating() const { return mInterpolate; }
+
+    //Call before simulating a tick, the current state becomes the previous one
+    void beginTick();
+
+    //Rebuilds the world matrix of every dirty object; when interpolating, moved objects at alpha between the last two ticks
+    TransformUpdate updateWorldMatrices(float alpha = 1.0f);
+
+    //World matrices are only current after updateWorldMatrices()
+    const Affine& world(TransformId id) const { return mWorld[id]; }
+    const Affine* worldData() const { return mWorld.data(); }
+
+private:
+    enum Component { PX, PY, PZ, RX, RY, RZ, SX, SY, SZ, ComponentCount };
+
+    //A setter wrote the object, it needs a rebuild and has moved during this tick
+    void markChanged(TransformId id);
+    void markDirty(TransformId id);
+
+    //World matrices of [first, first + count) from components blended alpha of the way to the current ones
+    void composeRange(size_t first, size_t count, float alpha);
+
+    std::vector<float> mComponents[ComponentCount];
+    std::vector<Uint8> mDirty;
+    std::vector<Affine> mWorld;
+    size_t mDirtyCount = 0;
+    TransformId mDirtyFirst = 0;
+    TransformId mDirtyLast = 0;
+
+    //Components at the start of the tick and the objects written since, only kept while interpolating
+    bool mInterpolate = false;
+    std::vector<float> mPrevious[ComponentCount];
+    std::vector<Uint8> mMoved;
+    size_t mMovedCount = 0;
+    TransformId mMovedFirst = 0;
+    TransformId mMovedLast = 0;
+};
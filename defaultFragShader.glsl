@@ -1,12 +1,20 @@
-#version 410 
-
-uniform vec4 uColor;
+#version 430
 
 in vec4 misturaColor;
+flat in vec4 drawColor;
 
 out vec4 outColor;
 
+// Position doubles as texture coordinate, the meshes carry no UVs
+uniform sampler2D baseTexture;
+
 void main(){
+	vec4 texel = texture(baseTexture, misturaColor.xy * 0.5 + 0.5);
 
-	outColor = misturaColor;
+	// DRAW_COLOR selects the per-draw color at compile time instead of branching per fragment
+#ifdef DRAW_COLOR
+	outColor = drawColor * texel;
+#else
+	outColor = misturaColor * texel;
+#endif
 }
\ No newline at end of file
@@ -1,15 +1,19 @@
-#version 410
+#version 430
 layout (location=0) in vec3 position;
 
 out vec4 misturaColor;
+flat out vec4 drawColor;
+
+#include "drawData.glsl"
 
-uniform mat4 mv_matrix;
 uniform mat4 p_matrix;
 
 void main(void){
 	
-	gl_Position = p_matrix * mv_matrix * vec4(position, 1.0);
+	DrawData draw = draws[gl_InstanceID];
+	gl_Position = p_matrix * draw.mv_matrix * vec4(position, 1.0);
 	misturaColor = vec4(position, 1.0);
+	drawColor = draw.color;
 	
 
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+// per-draw data written by the render queue, one entry per instance,
+// must match DrawData in RenderQueue.h
+struct DrawData
+{
+	mat4 mv_matrix;
+	vec4 color;
+};
+
+layout (std430, binding=0) readonly buffer DrawBlock
+{
+	DrawData draws[];
+};
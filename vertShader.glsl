@@ -2,6 +2,9 @@
 
 
 layout (location=0) in vec3 position;  // coord
+layout (location=1) in vec4 instance_row0;  // per-instance model matrix rows, the
+layout (location=2) in vec4 instance_row1;  // fourth row is always (0, 0, 0, 1)
+layout (location=3) in vec4 instance_row2;
 
 uniform mat4 v_matrix;
 uniform mat4 proj_matrix;
@@ -9,65 +12,22 @@ uniform float tf;
 
 out vec4 varyingColor;  // be interpolated by the rasterizer
 
-mat4 buildRotateX(float rad);
-mat4 buildRotateY(float rad);
-mat4 buildRotateZ(float rad);
-mat4 buildTranslate(float x, float y, float z);
+#include "transforms.glsl"
 
 void main(void) {
     float i= 0.0;
     i = gl_InstanceID + tf;  // value based on time factor, but different fo each cube instance
     
-    float a = sin(203.0 *i/800.0) * 403.0;
-    float b = sin(301.0 * i/4001.0) * 401.0;
-    float c = sin(400.0 * i/6003.0) * 405.0;
-    
     mat4 localRotX = buildRotateX(1000 * i);
     mat4 localRotY = buildRotateY(1000 * i);
     mat4 localRotZ = buildRotateZ(1000 * i);
-    mat4 localTrans = buildTranslate(a, b, c);
     
-    // build the maodel matrix and then the model-view matrix
-    mat4 newM_matrix = localTrans * localRotX * localRotY * localRotZ;
+    // the instance matrix places the cube, the local rotation spins it
+    mat4 instance_matrix = transpose(mat4(instance_row0, instance_row1, instance_row2, vec4(0.0, 0.0, 0.0, 1.0)));
+    mat4 newM_matrix = instance_matrix * localRotX * localRotY * localRotZ;
     mat4 mv_matrix = v_matrix * newM_matrix;
     
     
     gl_Position = proj_matrix * mv_matrix * vec4(position, 1.0);  // right-to-left
     varyingColor = vec4(position, 1.0) * 1.0 + vec4(0.2, 0.1, 0.3, 0.1);
 }
-
-// builds and returns a matrix that performs a rotation around the X axis
-mat4 buildRotateX(float rad) {
-    mat4 xrot = mat4(1.0, 0.0,      0.0,       0.0,
-                     0.0, cos(rad), -sin(rad), 0.0,
-                     0.0, sin(rad), cos(rad),  0.0,
-                     0.0, 0.0,      0.0,       1.0);
-    return xrot;
-}
-
-// builds and returns a matrix that performs a rotation around the Y axis
-mat4 buildRotateY(float rad) {
-    mat4 yrot = mat4(cos(rad),  0.0, sin(rad), 0.0,
-                     0.0,       1.0, 0.0,      0.0,
-                     -sin(rad), 0.0, cos(rad), 0.0,
-                     0.0,       0.0, 0.0,      1.0);
-    return yrot;
-}
-
-// builds and returns a matrix that performs a rotation around the Z axis
-mat4 buildRotateZ(float rad) {
-    mat4 zrot = mat4(cos(rad), -sin(rad), 0.0, 0.0,
-                     sin(rad), cos(rad),  0.0, 0.0,
-                     0.0,      0.0,       1.0, 0.0,
-                     0.0,      0.0,       0.0, 1.0);
-    return zrot;
-}
-
-// builds and returns a translation matrix
-mat4 buildTranslate(float x, float y, float z) {
-    mat4 trans = mat4(1.0, 0.0, 0.0, 0.0,
-                      0.0, 1.0, 0.0, 0.0,
-                      0.0, 0.0, 1.0, 0.0,
-                      x,   y,   z,   1.0);
-    return trans;
-}
\ No newline at end of file